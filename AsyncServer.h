@@ -0,0 +1,319 @@
+#pragma once
+#include "Server.h"
+
+// The coroutine front end needs C++20 (build with -std=c++20); without it only lmsServer is available
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#include <exception>
+
+// Coroutine type for one client session. It starts at once, runs until it first waits on its
+// socket, and frees its own frame when it finishes.
+struct sessionTask {
+	struct promise_type {
+		sessionTask get_return_object() { return sessionTask(); }
+		suspend_never initial_suspend() noexcept { return suspend_never(); }
+		suspend_never final_suspend() noexcept { return suspend_never(); }
+		void return_void() {}
+		void unhandled_exception() { terminate(); }
+	};
+};
+
+// Event loop on one thread: sessions park on a socket with co_await and are resumed
+// on this same thread once epoll says the socket is ready
+class asyncLoop {
+private:
+	int epfd;                      // epoll instance
+	int wakeFd;                    // eventfd that makes run() look at the running flag and the finished queue
+	int listenFd;                  // Shared listening socket (-1 until run)
+	atomic<bool> running;          // Cleared by stop()
+	unordered_map<int, coroutine_handle<>> parked; // Socket -> session waiting on it
+	mutex finishedLock;            // Guards finished
+	vector<coroutine_handle<>> finished; // Sessions whose durable wait is over, to resume on this thread
+	atomic<int> syncing;           // Sessions waiting for their changes to be durable
+
+	void arm(int fd, uint32_t events, coroutine_handle<> h); // Method to park a session until fd is ready
+	void post(coroutine_handle<> h); // Method to hand a session back to this loop (safe from any thread)
+	void resumeFinished();         // Method to resume the sessions handed back
+
+public:
+	// Awaitable that suspends the calling session until its socket is ready
+	struct ioWait {
+		asyncLoop* loop;           // Loop the session belongs to
+		int fd;                    // Socket being waited on
+		uint32_t events;           // EPOLLIN or EPOLLOUT
+
+		bool await_ready() { return false; }
+		void await_suspend(coroutine_handle<> h) { loop->arm(fd, events, h); }
+		void await_resume() {}
+	};
+
+	// Awaitable that suspends the calling session until the changes its requests made are
+	// durable; the log's writer thread hands it back, so the loop serves others meanwhile
+	struct durableWait {
+		asyncLoop* loop;           // Loop the session belongs to
+		requestHandler* handler;   // Handler whose changes must be durable
+		int fd;                    // The session's socket (it stays parked under it meanwhile)
+
+		bool await_ready() { return false; }
+		bool await_suspend(coroutine_handle<> h); // Suspends only if something is still being written
+		void await_resume() {}
+	};
+
+	asyncLoop();                   // Constructor for an empty loop
+	~asyncLoop();                  // Destructor that ends any sessions still parked
+	ioWait readable(int fd);       // Method to wait until a socket has input
+	ioWait writable(int fd);       // Method to wait until a socket has room for output
+	durableWait durable(int fd, requestHandler& handler); // Method to wait until this thread's changes are durable
+	void adopt(int fd);            // Method to start tracking a new session's socket
+	void release(int fd);          // Method to stop tracking and close a finished session's socket
+	void run(int listener, const function<void(int)>& start); // Method to accept and resume sessions until stop()
+	void stop();                   // Method to make run() return (safe from any thread)
+};
+
+// Constructor for the event loop
+asyncLoop::asyncLoop() : listenFd(-1), running(false), syncing(0) {
+	epfd = epoll_create1(0);
+	wakeFd = eventfd(0, EFD_NONBLOCK);
+	epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.fd = wakeFd;
+	epoll_ctl(epfd, EPOLL_CTL_ADD, wakeFd, &ev);
+}
+
+// Destructor that ends sessions that are still waiting and closes their sockets. Sessions
+// waiting on the log are handed back within one group commit, so wait for those first.
+asyncLoop::~asyncLoop() {
+	while (syncing > 0) this_thread::sleep_for(chrono::milliseconds(1));
+	for (pair<const int, coroutine_handle<>>& p : parked) {
+		p.second.destroy();        // Frees the session's buffers
+		close(p.first);
+	}
+	close(wakeFd);
+	close(epfd);
+}
+
+// Method to park a session until its socket is ready (one-shot, so it is resumed exactly once)
+void asyncLoop::arm(int fd, uint32_t events, coroutine_handle<> h) {
+	parked[fd] = h;
+	epoll_event ev;
+	ev.events = events | EPOLLONESHOT;
+	ev.data.fd = fd;
+	epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+// Method to hand a session whose durable wait is over back to the loop's thread
+void asyncLoop::post(coroutine_handle<> h) {
+	{
+		lock_guard<mutex> guard(finishedLock);
+		finished.push_back(h);
+	}
+	syncing--;
+	uint64_t one = 1;
+	if (write(wakeFd, &one, sizeof(one)) < 0) {} // Wake the loop to resume it
+}
+
+// Method to resume every session handed back since the last wake-up
+void asyncLoop::resumeFinished() {
+	vector<coroutine_handle<>> ready;
+	{
+		lock_guard<mutex> guard(finishedLock);
+		ready.swap(finished);
+	}
+	for (coroutine_handle<> h : ready) h.resume(); // Runs until the session waits again or finishes
+}
+
+// Method to suspend a session until its changes are durable; the handler calls back on the
+// log's writer thread, which posts the session to this loop. Returning false resumes it at once.
+bool asyncLoop::durableWait::await_suspend(coroutine_handle<> h) {
+	asyncLoop* l = loop;
+	l->parked[fd] = h;             // So the destructor ends it if the loop stops first (no events are armed)
+	l->syncing++;
+	if (handler->syncLater([l, h] { l->post(h); })) return true;
+	l->syncing--;                  // Already durable (or nothing logged)
+	l->parked.erase(fd);
+	return false;
+}
+
+// Method to wait until the changes this thread's requests made are durable
+asyncLoop::durableWait asyncLoop::durable(int fd, requestHandler& handler) {
+	durableWait w = { this, &handler, fd };
+	return w;
+}
+
+// Method to wait until a socket has input (or the client hung up)
+asyncLoop::ioWait asyncLoop::readable(int fd) {
+	ioWait w = { this, fd, EPOLLIN };
+	return w;
+}
+
+// Method to wait until a socket can take more output
+asyncLoop::ioWait asyncLoop::writable(int fd) {
+	ioWait w = { this, fd, EPOLLOUT };
+	return w;
+}
+
+// Method to start tracking a new session's socket (disarmed until the session waits on it)
+void asyncLoop::adopt(int fd) {
+	epoll_event ev;
+	ev.events = EPOLLONESHOT;
+	ev.data.fd = fd;
+	epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+// Method to stop tracking and close a finished session's socket
+void asyncLoop::release(int fd) {
+	epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+	parked.erase(fd);
+	close(fd);
+}
+
+// Method to accept new clients (each loop takes its turn on the shared listener) and resume
+// parked sessions until stop() is called; start begins a session for each accepted socket
+void asyncLoop::run(int listener, const function<void(int)>& start) {
+	listenFd = listener;
+	epoll_event ev;
+	ev.events = EPOLLIN | EPOLLEXCLUSIVE; // Only one loop is woken per new client
+	ev.data.fd = listenFd;
+	epoll_ctl(epfd, EPOLL_CTL_ADD, listenFd, &ev);
+
+	epoll_event events[64];        // Ready sockets per wake-up
+	running = true;
+	while (running) {
+		int n = epoll_wait(epfd, events, 64, -1);
+		if (n < 0 && errno != EINTR) break; // epoll itself failed
+		for (int i = 0; i < n; i++) {
+			int fd = events[i].data.fd;
+			if (fd == wakeFd) {
+				uint64_t count;
+				if (read(wakeFd, &count, sizeof(count)) < 0) {} // Reset the eventfd
+				resumeFinished();
+			}
+			else if (fd == listenFd) {
+				int client;
+				while ((client = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK)) >= 0) start(client);
+			}
+			else {
+				unordered_map<int, coroutine_handle<>>::iterator it = parked.find(fd);
+				if (it == parked.end()) continue; // Session is not waiting on this socket
+				coroutine_handle<> h = it->second;
+				parked.erase(it);
+				h.resume();        // Runs until the session waits again or finishes
+			}
+		}
+	}
+	epoll_ctl(epfd, EPOLL_CTL_DEL, listenFd, nullptr);
+}
+
+// Method to make run() return
+void asyncLoop::stop() {
+	running = false;
+	uint64_t one = 1;
+	if (write(wakeFd, &one, sizeof(one)) < 0) {} // Wake the loop so it sees the flag
+}
+
+// Request server built from coroutines: every client is a session coroutine that reads
+// request lines, answers them, and writes the responses, suspending whenever its socket
+// would block. A few event loop threads multiplex any number of sessions.
+class asyncServer {
+private:
+	static const size_t MAX_PENDING = 1 << 20; // Most unanswered bytes buffered per session
+
+	requestHandler& handler;       // Answers the requests
+	vector<asyncLoop*> loops;      // One event loop per thread
+	int listenFd;                  // Listening socket
+
+	sessionTask session(asyncLoop& loop, int fd); // Coroutine serving one client
+
+public:
+	asyncServer(requestHandler& handler, int threads); // Constructor with the handler and event loop count
+	~asyncServer();                // Destructor to close every socket
+	bool listenOn(const char* addr); // Method to listen on a Unix socket path or a TCP port
+	void run();                    // Method to serve until stop() is called
+	void stop();                   // Method to make run() return (safe from any thread)
+};
+
+// Constructor for the server
+asyncServer::asyncServer(requestHandler& handler, int threads) : handler(handler), listenFd(-1) {
+	for (int i = 0; i < (threads > 0 ? threads : 1); i++) loops.push_back(new asyncLoop);
+}
+
+// Destructor to end every session and close the listener
+asyncServer::~asyncServer() {
+	for (asyncLoop* l : loops) delete l;
+	if (listenFd >= 0) close(listenFd);
+}
+
+// Method to listen on a Unix socket path or a TCP port
+bool asyncServer::listenOn(const char* addr) {
+	listenFd = listenAddress(addr);
+	return listenFd >= 0;
+}
+
+// Method to serve on every loop (the calling thread runs the first) until stop() is called
+void asyncServer::run() {
+	function<void(asyncLoop*)> serve = [this](asyncLoop* l) {
+		l->run(listenFd, [this, l](int fd) {
+			l->adopt(fd);
+			session(*l, fd);       // Runs until it first has to wait
+		});
+	};
+	vector<thread> threads;
+	for (size_t i = 1; i < loops.size(); i++) threads.push_back(thread(serve, loops[i]));
+	serve(loops[0]);
+	for (thread& t : threads) t.join();
+}
+
+// Method to stop every loop
+void asyncServer::stop() {
+	for (asyncLoop* l : loops) l->stop();
+}
+
+// Coroutine serving one client: parse each complete line, answer it, and send the answers,
+// suspending (instead of blocking a thread) whenever the socket has nothing to read or no room
+sessionTask asyncServer::session(asyncLoop& loop, int fd) {
+	string in, out;                // Bytes received but not answered, answers not yet sent
+	char buf[16384];               // Read buffer (lives in the coroutine frame)
+	bool open = true;              // Client is still sending
+	while (open) {
+		ssize_t n = recv(fd, buf, sizeof(buf), 0);
+		if (n > 0) in.append(buf, n);
+		else if (n == 0) open = false; // Client finished sending; answer what is left
+		else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			co_await loop.readable(fd);
+			continue;
+		}
+		else if (errno == EINTR) continue;
+		else break;                // Connection is broken
+
+		size_t start = 0, nl;      // Answer every complete line
+		while ((nl = in.find('\n', start)) != string::npos) {
+			size_t len = nl - start;
+			if (len && in[nl - 1] == '\r') len--; // Accept CRLF clients
+			if (len) {             // Ignore blank lines
+				string line = in.substr(start, len);
+				handler.handle(line.c_str(), out);
+				out += '\n';       // Blank line ends each response
+			}
+			start = nl + 1;
+		}
+		in.erase(0, start);
+		if (in.size() > MAX_PENDING) break; // Refuse to buffer without limit
+		if (!out.empty()) co_await loop.durable(fd, handler); // Nothing is acknowledged before it is durable
+
+		size_t sent = 0;           // Send the answers before reading more
+		while (sent < out.size()) {
+			ssize_t w = send(fd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+			if (w > 0) sent += w;
+			else if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) co_await loop.writable(fd);
+			else if (w < 0 && errno == EINTR) continue;
+			else {                 // Client went away
+				open = false;
+				break;
+			}
+		}
+		out.clear();
+	}
+	loop.release(fd);
+}
+
+#endif
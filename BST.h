@@ -1,28 +1,61 @@
 #ifndef _AVL_H_
 #define _AVL_H_
-#include <cstring>  // for strcmp
 #include <algorithm> // for std::max
-#include "bookInfo.h"
-
-// Node structure for an AVL tree
-struct tNode {
-	tNode* left;                    // Pointer to the left child of the node
-	tNode* right;                   // Pointer to the right child of the node
-	bookInfo* val;                  // Pointer to the book information stored in the node
-	int height;                     // Integer representing the height of the node
-
-	// Constructor to initialize a tree node with bookInfo
-	tNode(bookInfo* b) : left(nullptr), right(nullptr), val(b), height(1) {}
+#include <functional>
+#include <type_traits>
+#include "Policies.h"
+#include "Bloom.h"
+#include "Trace.h"
+
+// Values stored under one key, in the order they were inserted; valid until that key's values change
+template <class value>
+struct valueRange {
+	const value* first = nullptr;   // First value
+	const value* last = nullptr;    // Just past the last value
+
+	const value* begin() const { return first; }
+	const value* end() const { return last; }
+	size_t size() const { return last - first; }
+	bool empty() const { return first == last; }
+	const value& operator[](size_t i) const { return first[i]; }
 };
 
-// AVL tree class definition (self-balancing binary search tree)
-class AVL {
+// AVL tree class definition (self-balancing binary search tree); see Policies.h for the parameters,
+// and Bloom.h for filter, which turns away lookups for absent keys before they descend.
+// A key may hold any number of values (a title has all its editions): the first sits in the key's
+// node, and once there are more they all move to one array the node points to, grown and shrunk
+// in powers of two, so a title with many editions costs one node and one dense array.
+template <class key, class value, class keyOf, class compare = threeWay<key>, class trace = noTrace, class alloc = allocator<value>,
+	class filter = noFilter<key>>
+class basicAVL {
 private:
+	// Node structure for an AVL tree
+	struct tNode {
+		tNode* left;                // Pointer to the left child of the node
+		tNode* right;               // Pointer to the right child of the node
+		key k;                      // Key of the values, kept here so a descent never touches them
+		int height;                 // Integer representing the height of the node
+		int count;                  // Values stored under the key
+		union postings {
+			value one;              // The value, while there is only one
+			value* many;            // The values, once there are more (capacity: count rounded up to a power of two)
+		} vals;
+
+		// Constructor to initialize a tree node with its first value
+		tNode(const key& k, const value& v) : left(nullptr), right(nullptr), k(k), height(1), count(1) { vals.one = v; }
+	};
+	static_assert(is_trivially_copyable<value>::value, "values are moved between a node and its array by copying");
+	typedef typename allocator_traits<alloc>::template rebind_alloc<value> valueAlloc; // Allocator for value arrays
+	typedef allocator_traits<valueAlloc> valueTraits;
+
 	tNode* head;                    // Pointer to the root node of the AVL tree
+	nodeAllocator<tNode, alloc> nodes; // Where nodes come from
+	valueAlloc arrays;              // Where the arrays of keys with several values come from
+	filter bloom;                   // Keys that may be in the tree
 
-	tNode* insertRec(tNode* node, bookInfo* v);  // Recursive method to insert and balance the tree
-	bookInfo* retrieveRec(tNode* node, char* t); // Recursive method to retrieve a book by title
-	tNode* removeRec(tNode* node, char* t);      // Recursive method to remove a book and balance the tree
+	tNode* insertRec(tNode* node, const key& k, const value& v, bool& grew); // Recursive method to insert and balance the tree
+	tNode* findRec(tNode* node, const key& k); // Recursive method to find the node holding a key
+	tNode* removeRec(tNode* node, const key& k, bool& removed); // Recursive method to remove a value and balance the tree (sets removed if the key was there)
 	tNode* rotateRight(tNode* y);    // Method to perform a right rotation
 	tNode* rotateLeft(tNode* x);     // Method to perform a left rotation
 	tNode* balance(tNode* node);     // Method to balance the AVL tree
@@ -30,49 +63,81 @@ private:
 	int getBalance(tNode* node);     // Method to get the balance factor of a node
 	tNode* findMin(tNode* node);     // Method to find the minimum value node in the tree
 	void deleteTree(tNode* node);    // Recursive method to delete the entire tree
+	bool fromRec(tNode* node, const key& low, const function<bool(const value&)>& visit); // Recursive method to visit keys from low on
+	static int capacity(int count); // Method to size the array for a key's values
+	static const value* valuesOf(tNode* node); // Method to find a node's values
+	void addValue(tNode* node, const value& v); // Method to add a value to a key already in the tree
+	bool dropValue(tNode* node, const value& v); // Method to remove one of several values from a key
+	void freeValues(tNode* node);   // Method to release a node's array, if it has one
+	long long countRec(tNode* node); // Recursive method to count the nodes in a subtree
+	void addKeysRec(tNode* node);   // Recursive method to add a subtree's keys to the filter
+	void rebuildFilter();           // Method to size the filter for what is stored and add every key again
 
 public:
-	AVL();                          // Constructor to initialize the AVL tree
-	~AVL();                         // Destructor to clean up the AVL tree
-	void insert(bookInfo* v);        // Method to insert a book into the AVL tree
-	bookInfo* retrieve(char* t);     // Method to retrieve a book by title
-	void remove(char* t);            // Method to remove a book by title
+	typedef valueRange<value> range; // Every value stored under a key
+
+	basicAVL();                     // Constructor to initialize the AVL tree
+	~basicAVL();                    // Destructor to clean up the AVL tree
+	void insert(const value& v);     // Method to insert a value into the AVL tree (ignored if it is already there)
+	value retrieve(const key& k);    // Method to retrieve the first value stored under a key (value() if absent)
+	range retrieveAll(const key& k); // Method to retrieve every value stored under a key (empty if absent)
+	void remove(const key& k);       // Method to remove a key and every value under it
+	bool remove(const key& k, const value& v); // Method to remove one value, false if it was not there
+	void forEachFrom(const key& low, const function<bool(const value&)>& visit); // Method to visit values in key order from low until visit returns false
 };
 
 // Constructor for the AVL tree
-AVL::AVL() : head(nullptr) {}       // Initialize the head of the tree to nullptr
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class filter>
+basicAVL<key, value, keyOf, compare, trace, alloc, filter>::basicAVL() : head(nullptr) { // Initialize the head of the tree to nullptr
+	bloom.reset(0);                 // Smallest filter; it doubles as the tree grows
+}
 
 // Destructor for the AVL tree
-AVL::~AVL() {
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class filter>
+basicAVL<key, value, keyOf, compare, trace, alloc, filter>::~basicAVL() {
 	deleteTree(head);               // Call the recursive deleteTree method to clean up
 }
 
 // Recursive method to delete the entire AVL tree
-void AVL::deleteTree(tNode* node) {
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class filter>
+void basicAVL<key, value, keyOf, compare, trace, alloc, filter>::deleteTree(tNode* node) {
 	if (node) {                     // If the node is not null
 		deleteTree(node->left);      // Recursively delete the left subtree
 		deleteTree(node->right);     // Recursively delete the right subtree
-		delete node;                 // Delete the current node
+		freeValues(node);            // Release its values' array
+		nodes.free(node);            // Delete the current node
 	}
 }
 
-// Public method to insert a book into the AVL tree
-void AVL::insert(bookInfo* v) {
-	head = insertRec(head, v);      // Call the recursive insert method, starting from the root
+// Public method to insert a value into the AVL tree
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class filter>
+void basicAVL<key, value, keyOf, compare, trace, alloc, filter>::insert(const value& v) {
+	traceSpan s = trace::begin();
+	key k = keyOf::of(v);
+	bool grew = false;              // Set if the key is new
+	head = insertRec(head, k, v, grew); // Call the recursive insert method, starting from the root
+	trace::end(TRACE_TREE_INSERT, s, height(head));
+	if (grew && !bloom.add(k)) rebuildFilter(); // More than the filter was sized for
 }
 
 // Recursive method to insert a node into the AVL tree and balance it
-tNode* AVL::insertRec(tNode* node, bookInfo* v) {
-	if (!node) return new tNode(v); // If the node is null, create a new node with the book info
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class filter>
+typename basicAVL<key, value, keyOf, compare, trace, alloc, filter>::tNode* basicAVL<key, value, keyOf, compare, trace, alloc, filter>::insertRec(tNode* node, const key& k, const value& v, bool& grew) {
+	if (!node) {                    // If the node is null, a new node goes here
+		grew = true;
+		return nodes.make(k, v);
+	}
+	trace::step();
 
-	int cmp = strcmp(v->title, node->val->title); // Compare the titles of the books
-	if (cmp < 0) {                  // If the new book's title is less than the current node's
-		node->left = insertRec(node->left, v); // Insert into the left subtree
+	int cmp = compare::compare(k, node->k); // Compare the keys
+	if (cmp < 0) {                  // If the new key is less than the current node's
+		node->left = insertRec(node->left, k, v, grew); // Insert into the left subtree
 	}
-	else if (cmp > 0) {             // If the new book's title is greater than the current node's
-		node->right = insertRec(node->right, v); // Insert into the right subtree
+	else if (cmp > 0) {             // If the new key is greater than the current node's
+		node->right = insertRec(node->right, k, v, grew); // Insert into the right subtree
 	}
-	else {                          // If the book already exists, do nothing
+	else {                          // If the key already exists, the value joins its others
+		addValue(node, v);
 		return node;
 	}
 
@@ -83,44 +148,94 @@ tNode* AVL::insertRec(tNode* node, bookInfo* v) {
 	return balance(node);
 }
 
-// Public method to retrieve a book by title
-bookInfo* AVL::retrieve(char* t) {
-	return retrieveRec(head, t);    // Call the recursive retrieve method, starting from the root
+// Public method to retrieve a value by key
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class filter>
+value basicAVL<key, value, keyOf, compare, trace, alloc, filter>::retrieve(const key& k) {
+	traceSpan s = trace::begin();
+	if (!bloom.mayContain(k)) {     // Definitely absent: skip the descent
+		trace::end(TRACE_TREE_RETRIEVE, s, 0);
+		return value();
+	}
+	tNode* found = findRec(head, k); // Call the recursive find method, starting from the root
+	trace::end(TRACE_TREE_RETRIEVE, s, height(head));
+	return found ? valuesOf(found)[0] : value();
 }
 
-// Recursive method to retrieve a book by title
-bookInfo* AVL::retrieveRec(tNode* node, char* t) {
-	if (!node) return nullptr;      // If the node is null, return nullptr (book not found)
+// Public method to retrieve every value stored under a key, in the order they were inserted
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class filter>
+typename basicAVL<key, value, keyOf, compare, trace, alloc, filter>::range basicAVL<key, value, keyOf, compare, trace, alloc, filter>::retrieveAll(const key& k) {
+	range all;
+	traceSpan s = trace::begin();
+	if (!bloom.mayContain(k)) {     // Definitely absent: skip the descent
+		trace::end(TRACE_TREE_RETRIEVE, s, 0);
+		return all;
+	}
+	tNode* found = findRec(head, k);
+	trace::end(TRACE_TREE_RETRIEVE, s, height(head));
+	if (found) {
+		all.first = valuesOf(found);
+		all.last = all.first + found->count;
+	}
+	return all;
+}
 
-	int cmp = strcmp(t, node->val->title); // Compare the target title with the current node's title
-	if (cmp == 0) {                // If the titles match, return the book info
-		return node->val;
+// Recursive method to find the node holding a key
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class filter>
+typename basicAVL<key, value, keyOf, compare, trace, alloc, filter>::tNode* basicAVL<key, value, keyOf, compare, trace, alloc, filter>::findRec(tNode* node, const key& k) {
+	if (!node) return nullptr;      // If the node is null, the key is not in the tree
+	trace::step();
+
+	int cmp = compare::compare(k, node->k); // Compare the target key with the current node's key
+	if (cmp == 0) {                // If the keys match, this is the node
+		return node;
 	}
-	else if (cmp < 0) {            // If the target title is less, search the left subtree
-		return retrieveRec(node->left, t);
+	else if (cmp < 0) {            // If the target key is less, search the left subtree
+		return findRec(node->left, k);
 	}
-	else {                         // If the target title is greater, search the right subtree
-		return retrieveRec(node->right, t);
+	else {                         // If the target key is greater, search the right subtree
+		return findRec(node->right, k);
 	}
 }
 
-// Public method to remove a book by title
-void AVL::remove(char* t) {
-	head = removeRec(head, t);     // Call the recursive remove method, starting from the root
+// Public method to remove a key and every value stored under it
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class filter>
+void basicAVL<key, value, keyOf, compare, trace, alloc, filter>::remove(const key& k) {
+	if (!bloom.mayContain(k)) return; // Definitely absent: nothing to remove
+	traceSpan s = trace::begin();
+	bool removed = false;          // Whether the key was really there (the filter may have been wrong)
+	head = removeRec(head, k, removed); // Call the recursive remove method, starting from the root
+	trace::end(TRACE_TREE_REMOVE, s, height(head));
+	if (removed && !bloom.removed(k)) rebuildFilter(); // Too many of its bits belong to removed keys
 }
 
-// Recursive method to remove a node by title and balance the tree
-tNode* AVL::removeRec(tNode* node, char* t) {
-	if (!node) return nullptr;      // If the node is null, return null (book not found)
+// Public method to remove one value from under its key (the key goes too if it was the last one)
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class filter>
+bool basicAVL<key, value, keyOf, compare, trace, alloc, filter>::remove(const key& k, const value& v) {
+	if (!bloom.mayContain(k)) return false; // Definitely absent: nothing to remove
+	tNode* node = findRec(head, k);
+	if (!node) return false;
+	if (node->count > 1) return dropValue(node, v); // The key stays for its other values
+	if (!(node->vals.one == v)) return false;
+	remove(k);
+	return true;
+}
+
+// Recursive method to remove a node by key and balance the tree; removed is set if it was found
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class filter>
+typename basicAVL<key, value, keyOf, compare, trace, alloc, filter>::tNode* basicAVL<key, value, keyOf, compare, trace, alloc, filter>::removeRec(tNode* node, const key& k, bool& removed) {
+	if (!node) return nullptr;      // If the node is null, return null (key not found)
+	trace::step();
 
-	int cmp = strcmp(t, node->val->title); // Compare the target title with the current node's title
-	if (cmp < 0) {                 // If the target title is less, search the left subtree
-		node->left = removeRec(node->left, t);
+	int cmp = compare::compare(k, node->k); // Compare the target key with the current node's key
+	if (cmp < 0) {                 // If the target key is less, search the left subtree
+		node->left = removeRec(node->left, k, removed);
 	}
-	else if (cmp > 0) {            // If the target title is greater, search the right subtree
-		node->right = removeRec(node->right, t);
+	else if (cmp > 0) {            // If the target key is greater, search the right subtree
+		node->right = removeRec(node->right, k, removed);
 	}
-	else {                         // If the book is found
+	else {                         // If the key is found
+		removed = true;
+		freeValues(node);          // Its values go with it (they belong to the caller, as in the hash table)
 		if (!node->left || !node->right) { // If the node has one or no children
 			tNode* temp = node->left ? node->left : node->right; // Choose the non-null child
 			if (!temp) {             // If there are no children
@@ -130,13 +245,15 @@ tNode* AVL::removeRec(tNode* node, char* t) {
 			else {
 				*node = *temp;       // Copy the non-null child to the current node
 			}
-			delete temp->val;        // Delete the book info in the node
-			delete temp;             // Delete the node
+			nodes.free(temp);        // Delete the node
 		}
 		else {                      // If the node has two children
 			tNode* temp = findMin(node->right); // Find the in-order successor
-			node->val = temp->val;   // Replace the current node's value with the successor's value
-			node->right = removeRec(node->right, temp->val->title); // Remove the successor
+			node->k = temp->k;       // Replace the current node's key and values with the successor's
+			node->count = temp->count;
+			node->vals = temp->vals;
+			temp->count = 1;         // Its array now belongs to node, so removing it must not free one
+			node->right = removeRec(node->right, temp->k, removed); // Remove the successor
 		}
 	}
 
@@ -149,8 +266,117 @@ tNode* AVL::removeRec(tNode* node, char* t) {
 	return balance(node);
 }
 
+// Public method to visit values in key order, starting at the first key not below low, until visit returns false
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class filter>
+void basicAVL<key, value, keyOf, compare, trace, alloc, filter>::forEachFrom(const key& low, const function<bool(const value&)>& visit) {
+	fromRec(head, low, visit);
+}
+
+// Recursive method to visit this subtree's keys from low on; returns false once visit has asked to stop.
+// Subtrees wholly below low are skipped, so a range scan costs one descent plus what it visits.
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class filter>
+bool basicAVL<key, value, keyOf, compare, trace, alloc, filter>::fromRec(tNode* node, const key& low, const function<bool(const value&)>& visit) {
+	if (!node) return true;         // Nothing here
+	int cmp = compare::compare(node->k, low);
+	if (cmp >= 0) {                 // This node, and maybe some of its left subtree, are in range
+		if (!fromRec(node->left, low, visit)) return false;
+		const value* v = valuesOf(node);
+		for (int i = 0; i < node->count; i++) {
+			if (!visit(v[i])) return false;
+		}
+	}
+	return fromRec(node->right, low, visit); // Keys to the right may be in range either way
+}
+
+// Method to size the array for a key with count values: count rounded up to a power of two,
+// so an array is full only when count is a power of two and grows or shrinks only there
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class filter>
+int basicAVL<key, value, keyOf, compare, trace, alloc, filter>::capacity(int count) {
+	int cap = 2;
+	while (cap < count) cap *= 2;
+	return cap;
+}
+
+// Method to find a node's values: the one in the node, or its array
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class filter>
+const value* basicAVL<key, value, keyOf, compare, trace, alloc, filter>::valuesOf(tNode* node) {
+	return node->count == 1 ? &node->vals.one : node->vals.many;
+}
+
+// Method to add a value to a key already in the tree, unless it is already one of the key's values
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class filter>
+void basicAVL<key, value, keyOf, compare, trace, alloc, filter>::addValue(tNode* node, const value& v) {
+	const value* have = valuesOf(node);
+	if (find(have, have + node->count, v) != have + node->count) return; // Already there
+	if (node->count == 1) {         // Second value: both move to an array
+		value* a = valueTraits::allocate(arrays, 2);
+		a[0] = node->vals.one;
+		node->vals.many = a;
+	}
+	else if (node->count == capacity(node->count)) { // Full: double it
+		value* a = valueTraits::allocate(arrays, 2 * node->count);
+		copy(node->vals.many, node->vals.many + node->count, a);
+		valueTraits::deallocate(arrays, node->vals.many, node->count);
+		node->vals.many = a;
+	}
+	node->vals.many[node->count++] = v;
+}
+
+// Method to remove one value from a key that has several, keeping the rest in order; false if v is not one of them
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class filter>
+bool basicAVL<key, value, keyOf, compare, trace, alloc, filter>::dropValue(tNode* node, const value& v) {
+	value* a = node->vals.many;
+	value* at = find(a, a + node->count, v);
+	if (at == a + node->count) return false;
+	int cap = capacity(node->count);
+	copy(at + 1, a + node->count, at); // Close the gap
+	node->count--;
+	if (node->count == 1) {         // One left: it moves back into the node
+		node->vals.one = a[0];
+		valueTraits::deallocate(arrays, a, cap);
+	}
+	else if (capacity(node->count) < cap) { // Half empty: halve it, so the array stays dense
+		value* smaller = valueTraits::allocate(arrays, capacity(node->count));
+		copy(a, a + node->count, smaller);
+		valueTraits::deallocate(arrays, a, cap);
+		node->vals.many = smaller;
+	}
+	return true;
+}
+
+// Method to release a node's array, if it has more than one value
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class filter>
+void basicAVL<key, value, keyOf, compare, trace, alloc, filter>::freeValues(tNode* node) {
+	if (node->count > 1) valueTraits::deallocate(arrays, node->vals.many, capacity(node->count));
+	node->count = 1;
+}
+
+// Recursive method to count the nodes in a subtree
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class filter>
+long long basicAVL<key, value, keyOf, compare, trace, alloc, filter>::countRec(tNode* node) {
+	return node ? 1 + countRec(node->left) + countRec(node->right) : 0;
+}
+
+// Recursive method to add every key in a subtree to the filter
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class filter>
+void basicAVL<key, value, keyOf, compare, trace, alloc, filter>::addKeysRec(tNode* node) {
+	if (!node) return;
+	bloom.add(node->k);
+	addKeysRec(node->left);
+	addKeysRec(node->right);
+}
+
+// Method to resize the filter to twice what is stored and add every key again (amortized over the
+// inserts or removes that filled it)
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class filter>
+void basicAVL<key, value, keyOf, compare, trace, alloc, filter>::rebuildFilter() {
+	bloom.reset(2 * countRec(head));
+	addKeysRec(head);
+}
+
 // Helper method to find the minimum value node in the tree (used in deletion)
-tNode* AVL::findMin(tNode* node) {
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class filter>
+typename basicAVL<key, value, keyOf, compare, trace, alloc, filter>::tNode* basicAVL<key, value, keyOf, compare, trace, alloc, filter>::findMin(tNode* node) {
 	while (node->left) {            // Traverse the left subtree to find the minimum
 		node = node->left;
 	}
@@ -158,7 +384,9 @@ tNode* AVL::findMin(tNode* node) {
 }
 
 // Method to perform a right rotation to balance the tree
-tNode* AVL::rotateRight(tNode* y) {
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class filter>
+typename basicAVL<key, value, keyOf, compare, trace, alloc, filter>::tNode* basicAVL<key, value, keyOf, compare, trace, alloc, filter>::rotateRight(tNode* y) {
+	trace::mark(TRACE_ROTATE_RIGHT, y->height);
 	tNode* x = y->left;             // Set x as the left child of y
 	tNode* T2 = x->right;           // Store the right subtree of x
 
@@ -173,7 +401,9 @@ tNode* AVL::rotateRight(tNode* y) {
 }
 
 // Method to perform a left rotation to balance the tree
-tNode* AVL::rotateLeft(tNode* x) {
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class filter>
+typename basicAVL<key, value, keyOf, compare, trace, alloc, filter>::tNode* basicAVL<key, value, keyOf, compare, trace, alloc, filter>::rotateLeft(tNode* x) {
+	trace::mark(TRACE_ROTATE_LEFT, x->height);
 	tNode* y = x->right;            // Set y as the right child of x
 	tNode* T2 = y->left;            // Store the left subtree of y
 
@@ -188,7 +418,8 @@ tNode* AVL::rotateLeft(tNode* x) {
 }
 
 // Method to balance the AVL tree after insertion or deletion
-tNode* AVL::balance(tNode* node) {
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class filter>
+typename basicAVL<key, value, keyOf, compare, trace, alloc, filter>::tNode* basicAVL<key, value, keyOf, compare, trace, alloc, filter>::balance(tNode* node) {
 	int balanceFactor = getBalance(node); // Get the balance factor of the current node
 
 	// Left heavy case
@@ -217,24 +448,18 @@ tNode* AVL::balance(tNode* node) {
 }
 
 // Method to get the height of a node (helper for balancing)
-int AVL::height(tNode* node) {
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class filter>
+int basicAVL<key, value, keyOf, compare, trace, alloc, filter>::height(tNode* node) {
 	if (!node) return 0;            // If the node is null, return height 0
 	return node->height;            // Otherwise, return the height of the node
 }
 
 // Method to get the balance factor of a node
-int AVL::getBalance(tNode* node) {
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class filter>
+int basicAVL<key, value, keyOf, compare, trace, alloc, filter>::getBalance(tNode* node) {
 	if (!node) return 0;            // If the node is null, return balance factor 0
 	return height(node->left) - height(node->right); // Return the difference in heights
 }
-// Node structure for a stack (Doubly linked list structure)
-struct sNode {
-	sNode* above;                 // Pointer to the node above in the stack
-	sNode* below;                 // Pointer to the node below in the stack
-	bookInfo* val;                // Pointer to the book information stored in the node
-
-	// Constructor to initialize the stack node with bookInfo
-	sNode(bookInfo* v) : val(v), above(nullptr), below(nullptr) {}
-};
+typedef basicAVL<titlePrefix, bookInfo*, titleOf, prefixOrder, libraryTrace, allocator<bookInfo*>, blockedBloom<titlePrefix, titleMix>> AVL; // AVL tree as the library builds it
 
 #endif
\ No newline at end of file
@@ -0,0 +1,113 @@
+#pragma once
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <istream>
+#include <vector>
+#include "Protocol.h"
+#include "Executor.h"
+using namespace std;
+
+const int BATCH_READ_AHEAD = 4096; // Requests read ahead, so runs of queries can be answered in parallel
+const int BATCH_GRAIN = 16;        // Fewest queries handed to one thread at a time
+
+// Output buffer that only touches the file once it has collected a large block
+class bufferedWriter {
+private:
+	static const size_t SIZE = 1 << 20; // Bytes collected before each write
+
+	FILE* file;                    // Where the output goes
+	char* buf;                     // Collected output
+	size_t used;                   // Bytes of buf in use
+
+public:
+	bufferedWriter(FILE* f);       // Constructor with the output file
+	~bufferedWriter();             // Destructor that writes whatever is left
+	void write(const char* data, size_t n); // Method to add bytes to the output
+	void write(const string& s);   // Method to add a string to the output
+	void flush();                  // Method to write everything collected so far
+};
+
+// Constructor for the buffered writer
+bufferedWriter::bufferedWriter(FILE* f) : file(f), used(0) {
+	buf = new char[SIZE];          // One large block for the whole run
+}
+
+// Destructor that writes any remaining output
+bufferedWriter::~bufferedWriter() {
+	flush();
+	delete[] buf;
+}
+
+// Method to add bytes to the output, writing full blocks as they fill
+void bufferedWriter::write(const char* data, size_t n) {
+	if (used + n > SIZE) flush(); // Make room
+	if (n > SIZE) {                // Too big to buffer at all
+		fwrite(data, 1, n, file);
+		return;
+	}
+	memcpy(buf + used, data, n);
+	used += n;
+}
+
+// Method to add a string to the output
+void bufferedWriter::write(const string& s) {
+	write(s.data(), s.size());
+}
+
+// Method to write everything collected so far
+void bufferedWriter::flush() {
+	if (used) fwrite(buf, 1, used, file);
+	fflush(file);
+	used = 0;
+}
+
+// Function to run every request line in a stream without prompts, writing each response
+// followed by a blank line (the same framing as the server). Returns the number of requests.
+// With a pool, each unbroken run of queries (see isQuery) is answered in parallel; requests that
+// change anything still run one at a time in file order. The little a query changes on the way
+// (deadlines that have passed) is done first for the whole run, in file order
+// (requestHandler::prepare), so the output is the same either way. A recorder (--record)
+// still gets a parallel run's queries in the order they were answered.
+// Responses are written only once the changes behind them are durable (requestHandler::sync).
+long long runBatch(requestHandler& handler, istream& in, FILE* out, workStealingPool* pool = nullptr) {
+	bufferedWriter writer(out);    // All output goes through one buffer
+	vector<string> lines(BATCH_READ_AHEAD), responses(BATCH_READ_AHEAD); // Reused to avoid reallocating
+	long long count = 0;
+	while (in) {
+		int n = 0;                 // Requests read this round
+		while (n < BATCH_READ_AHEAD && getline(in, lines[n])) {
+			string& line = lines[n];
+			if (!line.empty() && line.back() == '\r') line.pop_back(); // Accept CRLF files
+			if (line.empty() || line[0] == '#') continue; // Skip blank lines and comments
+			n++;
+		}
+
+		for (int i = 0; i < n; ) {
+			int j = i + 1;         // End of the run starting at i
+			if (pool && isQuery(lines[i].c_str())) {
+				while (j < n && isQuery(lines[j].c_str())) j++;
+			}
+			function<void(long long, long long)> answer = [&](long long first, long long last) {
+				for (long long k = first; k < last; k++) {
+					responses[k].clear();
+					handler.handle(lines[k].c_str(), responses[k]);
+				}
+			};
+			if (j - i > BATCH_GRAIN) {
+				for (int k = i; k < j; k++) handler.prepare(lines[k].c_str()); // Side effects in file order
+				pool->parallelFor(i, j, BATCH_GRAIN, answer);
+			}
+			else answer(i, j);
+			i = j;
+		}
+
+		handler.sync();            // One durable point per read-ahead, before any of it is reported
+		for (int i = 0; i < n; i++) {
+			responses[i] += '\n';  // Blank line ends each response
+			writer.write(responses[i]);
+		}
+		count += n;
+	}
+	return count;
+}
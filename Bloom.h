@@ -0,0 +1,139 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include "Policies.h"
+using namespace std;
+
+/*
+Filters that sit in front of AVL so a lookup for a key that is not there can return without a
+root-to-leaf descent. (hashTable does not need one: each slot keeps a summary of its keys in the
+cache line a lookup reads anyway, see Hash.h.) A filter policy is a member of the container with
+	void reset(long long expected)   Empty it, sized for about expected keys
+	bool add(const key&)             Note a key; false once it holds more than it was sized for
+	bool removed(const key&)         Note a removal; false once enough are stale that it should be rebuilt
+	bool mayContain(const key&)      false only if the key was never added (true may be a false positive)
+When add or removed says so, the container resets the filter bigger and adds every key again,
+so the filter's cost stays amortized O(1) per insert or remove.
+noFilter does nothing and compiles away. blockedBloom keeps every key's bits in one 64-byte
+cache line (a split block Bloom filter), so a miss costs one hash and one line.
+*/
+
+const int BLOOM_BITS_PER_KEY = 12;  // About 0.5% false positives with 8 bits set per key
+const int BLOOM_STALE_FRACTION = 2; // Rebuild once half the keys added have been removed
+
+// Hash for integer keys (the murmur3 finalizer)
+struct intMix {
+	static uint64_t hash(long long k) {
+		uint64_t h = (uint64_t)k;
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ULL;
+		h ^= h >> 33;
+		return h;
+	}
+};
+
+// Hash for titles (FNV-1a over the whole title, then mixed)
+struct titleMix {
+	static uint64_t hash(const titlePrefix& t) {
+		uint64_t h = 0xcbf29ce484222325ULL;
+		for (const char* c = t.s; *c; c++) h = (h ^ (unsigned char)*c) * 0x100000001b3ULL;
+		return intMix::hash((long long)h);
+	}
+};
+
+// Filter policy that filters nothing; every lookup goes to the index
+template <class key>
+struct noFilter {
+	void reset(long long) {}
+	bool add(const key&) { return true; }
+	bool removed(const key&) { return true; }
+	bool mayContain(const key&) { return true; }
+};
+
+// One cache line of a blocked Bloom filter
+struct alignas(64) bloomBlock {
+	uint64_t words[8];            // A key sets one bit in each word
+};
+
+// Split block Bloom filter: a key's hash picks one block, then one bit in each of its 8 words
+template <class key, class keyHash>
+class blockedBloom {
+private:
+	bloomBlock* blocks;           // The filter (nullptr until reset)
+	long long count;              // Blocks
+	long long capacity;           // Keys it was sized for
+	long long added;              // Keys added since the last reset
+	long long stale;              // Keys removed since the last reset (their bits stay set)
+
+	static uint64_t bitOf(uint64_t h, int word); // Method to pick the bit a hash sets in a word
+
+public:
+	blockedBloom();               // Constructor for a filter that passes everything until reset
+	~blockedBloom();              // Destructor to free the blocks
+	void reset(long long expected); // Method to empty the filter, sized for about expected keys
+	bool add(const key& k);       // Method to add a key, false once over capacity
+	bool removed(const key& k);   // Method to note a removal, false once too many bits are stale
+	bool mayContain(const key& k); // Method to check a key (false means definitely absent)
+};
+
+// Constructor for a filter with no blocks yet (mayContain says yes to everything)
+template <class key, class keyHash>
+blockedBloom<key, keyHash>::blockedBloom() : blocks(nullptr), count(0), capacity(0), added(0), stale(0) {}
+
+// Destructor to free the blocks
+template <class key, class keyHash>
+blockedBloom<key, keyHash>::~blockedBloom() {
+	delete[] blocks;
+}
+
+// Method to pick the bit (as a mask) a hash sets in one word; each word multiplies by its own odd salt
+template <class key, class keyHash>
+uint64_t blockedBloom<key, keyHash>::bitOf(uint64_t h, int word) {
+	static const uint32_t salts[8] = { 0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU, 0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U };
+	return 1ULL << (((uint32_t)h * salts[word]) >> 26); // Top 6 bits of the product
+}
+
+// Method to empty the filter and size it for about expected keys
+template <class key, class keyHash>
+void blockedBloom<key, keyHash>::reset(long long expected) {
+	if (expected < 64) expected = 64;
+	long long want = (expected * BLOOM_BITS_PER_KEY + 511) / 512;
+	if (want != count) {
+		delete[] blocks;
+		blocks = new bloomBlock[want];
+		count = want;
+	}
+	memset(blocks, 0, count * sizeof(bloomBlock));
+	capacity = expected;
+	added = 0;
+	stale = 0;
+}
+
+// Method to set a key's 8 bits; false once more keys are in it than it was sized for
+template <class key, class keyHash>
+bool blockedBloom<key, keyHash>::add(const key& k) {
+	if (!blocks) return false;    // Never sized: have the container size it
+	uint64_t h = keyHash::hash(k);
+	bloomBlock& b = blocks[(long long)(((h >> 32) * (uint64_t)count) >> 32)]; // High half picks the block
+	for (int i = 0; i < 8; i++) b.words[i] |= bitOf(h, i);
+	return ++added <= capacity;
+}
+
+// Method to note that a key left the index; its bits cannot be cleared (other keys may share them)
+template <class key, class keyHash>
+bool blockedBloom<key, keyHash>::removed(const key&) {
+	return ++stale * BLOOM_STALE_FRACTION <= added;
+}
+
+// Method to check whether a key may be in the index: one block, 8 words
+template <class key, class keyHash>
+bool blockedBloom<key, keyHash>::mayContain(const key& k) {
+	if (!blocks) return true;
+	uint64_t h = keyHash::hash(k);
+	const bloomBlock& b = blocks[(long long)(((h >> 32) * (uint64_t)count) >> 32)];
+	uint64_t missing = 0;         // Bits the key needs that are clear (no early exit, so the loop vectorizes)
+	for (int i = 0; i < 8; i++) missing |= bitOf(h, i) & ~b.words[i];
+	return missing == 0;
+}
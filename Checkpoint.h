@@ -0,0 +1,102 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cstdlib>
+#include <dirent.h>
+using namespace std;
+
+// Gate every change to the library passes through. Changes go through side by side; close()
+// waits for the ones in progress and holds new ones back until open(), so whoever closed the
+// gate sees a state that no change is half way through.
+class changeGate {
+private:
+	atomic<int> inside;            // Changes in progress
+	atomic<bool> closed;           // Set while new changes must wait
+	mutex lock;                    // Guards waiting on changed
+	condition_variable changed;    // Signals the closer that the gate emptied, and changes that it opened
+	mutex closer;                  // Held from close() to open(), so one closer at a time
+
+public:
+	changeGate();                  // Constructor for an open gate
+	void enter();                  // Method to start a change (waits while the gate is closed)
+	void leave();                  // Method to finish a change
+	void close();                  // Method to hold back new changes and wait for the ones in progress
+	void open();                   // Method to let changes through again
+};
+
+// Pass through the gate for the lifetime of one change
+struct gatePass {
+	changeGate& gate;              // Gate being passed
+
+	gatePass(changeGate& g) : gate(g) { gate.enter(); } // Constructor that enters the gate
+	~gatePass() { gate.leave(); }  // Destructor that leaves it
+};
+
+// Constructor for an open, empty gate
+changeGate::changeGate() : inside(0), closed(false) {}
+
+// Method to start a change; a plain counter bump unless a checkpoint is being taken
+void changeGate::enter() {
+	while (true) {
+		inside.fetch_add(1);       // Announce ourselves before looking at closed (the closer does the reverse)
+		if (!closed.load()) return;
+		leave();                   // Back out and wait for the gate to open
+		unique_lock<mutex> guard(lock);
+		changed.wait(guard, [this] { return !closed.load(); });
+	}
+}
+
+// Method to finish a change, waking the closer if it was the last one inside
+void changeGate::leave() {
+	if (inside.fetch_sub(1) == 1 && closed.load()) {
+		lock_guard<mutex> guard(lock);
+		changed.notify_all();
+	}
+}
+
+// Method to hold back new changes and wait until none is in progress (one closer at a time)
+void changeGate::close() {
+	closer.lock();                 // Wait for any other closer to open it again
+	closed.store(true);
+	unique_lock<mutex> guard(lock);
+	changed.wait(guard, [this] { return inside.load() == 0; });
+}
+
+// Method to let changes through again
+void changeGate::open() {
+	{
+		lock_guard<mutex> guard(lock);
+		closed.store(false);
+	}
+	changed.notify_all();
+	closer.unlock();
+}
+
+// Helper function to name a closed-off log segment (the log's path plus its generation)
+string segmentPath(const string& log, long long generation) {
+	return log + "." + to_string(generation);
+}
+
+// Helper function to list the generations of every closed-off segment of a log, oldest first
+vector<long long> closedSegments(const string& log) {
+	size_t slash = log.find_last_of('/');
+	string dir = slash == string::npos ? "." : log.substr(0, slash + 1);
+	string base = (slash == string::npos ? log : log.substr(slash + 1)) + ".";
+	vector<long long> found;       // Generations seen
+	DIR* d = opendir(dir.c_str());
+	if (!d) return found;
+	while (dirent* e = readdir(d)) {
+		string name = e->d_name;   // Segments are "<log>.<digits>"
+		if (name.size() <= base.size() || name.compare(0, base.size(), base) != 0) continue;
+		string digits = name.substr(base.size());
+		if (digits.find_first_not_of("0123456789") != string::npos) continue; // Not a segment (e.g. the snapshot)
+		found.push_back(atoll(digits.c_str()));
+	}
+	closedir(d);
+	sort(found.begin(), found.end());
+	return found;
+}
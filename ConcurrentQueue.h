@@ -0,0 +1,263 @@
+#ifndef _CONCURRENT_QUEUE_H_
+#define _CONCURRENT_QUEUE_H_
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <stdexcept>
+#include <functional>
+#include "Users.h"
+using namespace std;
+
+const int CQ_FIRST_RING = 4;              // Slots in a queue's first ring (most books never get reserved)
+const long long CQ_CLOSED = 1LL << 62;    // Set in a ring's tail once it is full; producers move on to the next ring
+
+// Slot in the concurrent queue; seq tells producers and consumers whose turn it is
+struct cqCell {
+	atomic<long long> seq;    // Ring ticket that may use this slot next
+	atomic<int> val;          // User id stored in the slot
+};
+
+// Bounded ring of slots; a queue is a chain of them, each twice the size of the one before
+struct cqRing {
+	long long base;           // Queue ticket of this ring's ticket 0
+	long long mask;           // Slots - 1 (slots is a power of two)
+	cqCell* cells;            // The slots
+	atomic<long long> tail;   // Next ring ticket handed to a producer (CQ_CLOSED set once full)
+	atomic<long long> head;   // Next ring ticket handed to a consumer
+	atomic<cqRing*> next;     // Larger ring that takes over once this one is closed
+
+	cqRing(long long base, int slots); // Constructor for an empty ring whose tickets start at base
+	~cqRing();                // Destructor to free the slots
+};
+
+// Unbounded multi-producer/multi-consumer queue of user ids, ordered by tickets rather than a lock.
+// Slots are claimed with compare-and-swap on a chain of rings: producers fill the newest ring; when
+// it is full they close it and carry on in one twice the size, while consumers finish the old ring
+// before following them, so order is kept across rings. Drained rings stay allocated until the
+// queue goes, which keeps stale readers safe and bounds memory by twice the longest the queue has
+// been; once the newest ring is big enough it is reused forever.
+// It is not lock-free. Each producer, and each consumer, waits (yielding) until the one with the
+// ticket before it has finished, then runs its inOrder step and publishes; so inOrder steps, such
+// as writing a log record, happen one at a time in queue order, and reservations stay first-come
+// first-served. That makes it a ticket lock per book: a thread preempted between claiming its
+// ticket and finishing holds up every later producer, and the consumers waiting on its slot,
+// until it runs again. It only beats the book lock while every waiting thread has a core.
+class cQ {
+private:
+	cqRing* rings;            // First ring (allocated on first enqueue); the chain is freed from here
+	atomic<cqRing*> headRing; // Ring consumers are taking from
+	atomic<cqRing*> tailRing; // Ring producers are filling (a hint: it may lag behind)
+	atomic<long long> enqTurn; // Queue ticket whose producer may publish next
+	atomic<long long> deqTurn; // Queue ticket whose consumer may finish next (every earlier one has left)
+	atomic<int> len;          // Number of published, not yet dequeued ids
+
+	cqRing* start();          // Method to get the ring to fill, allocating the first one once
+	cqRing* successor(cqRing* r, long long closedTail); // Method to get the ring after a closed one, adding it if needed
+	static void waitTurn(atomic<long long>& turn, long long ticket); // Method to wait until a ticket's turn comes
+
+public:
+	static const bool selfOrdered = true; // Callers need no lock around it (it orders entries by ticket)
+
+	cQ();                     // Constructor for initializing the queue
+	~cQ();                    // Destructor for cleaning up the queue
+
+	long long enqueue(int id); // Method to add a user id, returns its ticket
+	long long enqueue(int id, const function<void()>& inOrder); // Method to add a user id, running inOrder before it is visible
+	int dequeue();             // Method to remove and return the front user id (-1 if empty)
+	int dequeue(const function<void(int)>& inOrder); // Method to remove the front user id, running inOrder on it
+	int front();               // Method to get the front user id without removing it
+	bool isEmpty();            // Method to check if the queue is empty
+	int length();              // Method to get the length of the queue
+	int ahead(long long ticket); // Method to get how many are ahead of an entry (-1 if it has left the queue)
+	void displayAll(const userRegistry& users); // Method to display all names in the queue
+	void forEach(const function<void(int)>& visit); // Method to visit every user id, front to back
+};
+
+// Constructor for an empty ring, every slot numbered for its first lap
+cqRing::cqRing(long long base, int slots) : base(base), mask(slots - 1), tail(0), head(0), next(nullptr) {
+	cells = new cqCell[slots];
+	for (int i = 0; i < slots; i++) cells[i].seq.store(i, memory_order_relaxed);
+}
+
+// Destructor to free the ring's slots
+cqRing::~cqRing() {
+	delete[] cells;
+}
+
+// Constructor definition to initialize the queue
+cQ::cQ() : rings(nullptr), headRing(nullptr), tailRing(nullptr), enqTurn(0), deqTurn(0), len(0) {}
+
+// Destructor to clean up memory for the queue
+cQ::~cQ() {
+	while (rings) {           // Free the whole chain, drained rings included
+		cqRing* next = rings->next.load();
+		delete rings;
+		rings = next;
+	}
+}
+
+// Method to return the ring producers fill, racing producers agree on one first ring
+cqRing* cQ::start() {
+	cqRing* r = tailRing.load(memory_order_acquire);
+	if (r && headRing.load(memory_order_acquire)) return r; // Fast path: already allocated
+
+	if (!r) {
+		cqRing* fresh = new cqRing(0, CQ_FIRST_RING);
+		if (tailRing.compare_exchange_strong(r, fresh, memory_order_acq_rel)) r = rings = fresh; // We won the race
+		else delete fresh;    // Someone else installed theirs first (r now holds it)
+	}
+	cqRing* none = nullptr;
+	headRing.compare_exchange_strong(none, r, memory_order_acq_rel); // Consumers must see it before anything is queued
+	return r;
+}
+
+// Method to return the ring after a closed one, adding one twice the size if nobody has yet;
+// closedTail is the closed ring's tail, which says where the next ring's tickets start
+cqRing* cQ::successor(cqRing* r, long long closedTail) {
+	cqRing* n = r->next.load(memory_order_acquire);
+	if (!n) {
+		cqRing* fresh = new cqRing(r->base + (closedTail & ~CQ_CLOSED), (int)(r->mask + 1) * 2);
+		if (r->next.compare_exchange_strong(n, fresh, memory_order_acq_rel)) n = fresh;
+		else delete fresh;    // Another producer added it first
+	}
+	tailRing.compare_exchange_strong(r, n, memory_order_acq_rel); // Move the hint along (fine if someone already did)
+	return n;
+}
+
+// Method to wait until every ticket before this one has had its turn
+void cQ::waitTurn(atomic<long long>& turn, long long ticket) {
+	while (turn.load(memory_order_acquire) != ticket) this_thread::yield();
+}
+
+// Method to add a user id to the end of the queue, returns its ticket
+long long cQ::enqueue(int id) {
+	return enqueue(id, function<void()>());
+}
+
+// Method to add a user id to the end of the queue, returns its ticket (ahead(ticket) is how many
+// were queued before it). inOrder runs after every earlier producer's and before the id is visible.
+long long cQ::enqueue(int id, const function<void()>& inOrder) {
+	cqRing* r = start();       // Get (or create) the ring to fill
+	cqCell* cell;
+	long long pos;             // Ring ticket we took
+	while (true) {
+		long long t = r->tail.load(memory_order_acquire); // Ticket we would like to take
+		if (t & CQ_CLOSED) {   // Full: carry on in the next ring
+			r = successor(r, t);
+			continue;
+		}
+		cell = &r->cells[t & r->mask]; // Slot for that ticket
+		long long diff = cell->seq.load(memory_order_acquire) - t;
+		if (diff == 0) {       // Slot is free for this ticket
+			if (r->tail.compare_exchange_weak(t, t + 1, memory_order_acq_rel)) {
+				pos = t;       // Claimed it
+				break;
+			}
+		}
+		else if (diff < 0) r->tail.compare_exchange_strong(t, t | CQ_CLOSED, memory_order_acq_rel); // Slot still holds an id from a lap ago: close the ring
+		// Otherwise another producer took it; retry
+	}
+
+	long long ticket = r->base + pos; // Its place in the whole queue
+	waitTurn(enqTurn, ticket);
+	if (inOrder) inOrder();
+	cell->val.store(id, memory_order_relaxed); // Store the id
+	cell->seq.store(pos + 1, memory_order_release); // Publish it to consumers
+	len.fetch_add(1);          // Count it once it is visible (ordered before the caller's next look at stock)
+	enqTurn.store(ticket + 1, memory_order_release);
+	return ticket;
+}
+
+// Method to remove and return the front user id of the queue
+int cQ::dequeue() {
+	return dequeue(function<void(int)>());
+}
+
+// Method to remove and return the front user id of the queue (-1 if empty); inOrder gets the id
+// after every earlier consumer's has run, and ahead() counts the entry until it returns
+int cQ::dequeue(const function<void(int)>& inOrder) {
+	cqRing* r = headRing.load(memory_order_acquire);
+	if (!r) return -1;         // Nothing was ever queued
+
+	long long pos;             // Ring ticket we took
+	int id;
+	while (true) {
+		long long h = r->head.load(memory_order_acquire); // Ticket we would like to take
+		cqCell* cell = &r->cells[h & r->mask]; // Slot for that ticket
+		long long diff = cell->seq.load(memory_order_acquire) - (h + 1);
+		if (diff == 0) {       // Slot holds a published id for this ticket
+			if (r->head.compare_exchange_weak(h, h + 1, memory_order_acq_rel)) { // Claimed it
+				pos = h;
+				id = cell->val.load(memory_order_relaxed); // Read the id
+				cell->seq.store(h + r->mask + 1, memory_order_release); // Hand the slot to the next lap
+				break;
+			}
+		}
+		else if (diff < 0) {   // Nothing published for this ticket
+			long long t = r->tail.load(memory_order_acquire);
+			if (!(t & CQ_CLOSED) || h < (t & ~CQ_CLOSED)) return -1; // Empty (or the front is still being written)
+			cqRing* n = r->next.load(memory_order_acquire); // Closed and drained: the queue goes on in the next ring
+			if (!n) return -1; // Nobody has queued there yet
+			headRing.compare_exchange_strong(r, n, memory_order_acq_rel);
+			r = headRing.load(memory_order_acquire);
+		}
+		// Otherwise another consumer took it; retry
+	}
+
+	long long ticket = r->base + pos;
+	waitTurn(deqTurn, ticket);
+	if (inOrder) inOrder(id);
+	len.fetch_sub(1);          // One fewer queued id
+	deqTurn.store(ticket + 1, memory_order_release);
+	return id;                 // Return the dequeued id
+}
+
+// Method to return the front user id without removing it
+int cQ::front() {
+	int id = -1;
+	forEach([&](int v) { if (id < 0) id = v; });
+	if (id < 0) throw runtime_error("Queue is empty, no front element.");
+	return id;
+}
+
+// Method to check if the queue is empty
+bool cQ::isEmpty() {
+	return len.load() == 0;    // Return true if nothing is published
+}
+
+// Method to return the length of the queue
+int cQ::length() {
+	return len.load(memory_order_acquire); // Published ids not yet dequeued
+}
+
+// Method to return how many reservations are ahead of the one with this ticket; ids only leave
+// from the front, so that is the distance from the next ticket to finish leaving
+int cQ::ahead(long long ticket) {
+	long long first = deqTurn.load(memory_order_acquire);
+	return ticket < first ? -1 : (int)(ticket - first);
+}
+
+// Method to visit every user id in the queue, front to back (a snapshot; entries may change meanwhile)
+void cQ::forEach(const function<void(int)>& visit) {
+	for (cqRing* r = headRing.load(memory_order_acquire); r; r = r->next.load(memory_order_acquire)) {
+		long long end = r->tail.load(memory_order_acquire) & ~CQ_CLOSED;
+		for (long long pos = r->head.load(memory_order_acquire); pos < end; pos++) {
+			cqCell* cell = &r->cells[pos & r->mask];
+			if (cell->seq.load(memory_order_acquire) != pos + 1) continue; // Not published or already taken
+			visit(cell->val.load(memory_order_relaxed));
+		}
+	}
+}
+
+// Method to display all names in the queue (a snapshot; entries may change meanwhile)
+void cQ::displayAll(const userRegistry& users) {
+	bool first = true;
+	forEach([&](int id) {
+		if (!first) cout << ", "; // Print a comma between names
+		cout << users.name(id);   // Print the name for the current id
+		first = false;
+	});
+	cout << '\n';              // End the line after printing all values
+}
+
+#endif
@@ -0,0 +1,244 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <functional>
+#include <algorithm>
+using namespace std;
+
+const int POOL_MAX_NESTING = 32; // Most tasks a thread runs inside one another while joining (bounds its stack)
+
+// One piece of forked work; it lives on the stack of the frame that forked it until that frame joins it
+struct forkTask {
+	function<void()> run;          // Work to do
+	atomic<bool> done;             // Set once run has returned
+
+	forkTask(const function<void()>& f) : run(f), done(false) {} // Constructor with the work to do
+};
+
+// Deque of forked tasks: its owner pushes and pops at the back (newest, still warm in cache),
+// idle workers steal from the front (oldest, usually the biggest pieces of work)
+struct workDeque {
+	mutex lock;                    // Guards tasks
+	deque<forkTask*> tasks;        // Tasks waiting to run
+};
+
+// Fork-join pool: each worker thread owns a deque, and a worker with nothing to do steals from
+// the others. A thread waiting for a forked task runs other forked tasks instead of blocking, up to
+// POOL_MAX_NESTING deep; past that it only runs its own task (if nobody stole it) or waits. Work
+// submitted from outside (such as a server's requests) is run in arrival order by idle workers,
+// never by a thread that is joining, so the same threads serve requests and the scans they fork.
+class workStealingPool {
+private:
+	int workers;                   // Number of worker threads
+	workDeque* deques;             // One deque per worker, plus one shared by threads outside the pool
+	vector<thread> threads;        // The worker threads
+	mutex submittedLock;           // Guards submitted
+	deque<function<void()>> submitted; // Work submitted from outside, oldest first
+	atomic<int> queued;            // Tasks sitting in any deque, and submitted work
+	atomic<bool> stopping;         // Set when the pool is shutting down
+	mutex sleepLock;               // Guards sleeping on wake
+	condition_variable wake;       // Idle workers sleep here until work is pushed
+
+	static thread_local workStealingPool* currentPool; // Pool the calling thread works for (nullptr if none)
+	static thread_local int self;  // Index of the calling thread's deque in currentPool
+	static thread_local int nesting; // Tasks the calling thread is running inside one another
+
+	int myDeque();                 // Method to get the calling thread's deque
+	void push(forkTask* t);        // Method to make a task available to the pool
+	void signal();                 // Method to wake an idle worker for a new task
+	forkTask* take();              // Method to take a task, own deque first, then by stealing (nullptr if none)
+	void run(forkTask* t);         // Method to run a task taken off a deque
+	bool runOne();                 // Method to run one waiting task, returns false if there was none
+	bool runOwn(forkTask& t);      // Method to run t if it is still at the back of our deque
+	bool runSubmitted();           // Method to run the oldest submitted work, returns false if there was none
+	void join(forkTask& t);        // Method to wait for a forked task, running others meanwhile
+	void workerLoop(int id);       // Body of each worker thread
+
+public:
+	workStealingPool(int n = 0);   // Constructor with the number of workers (0 = one per core)
+	~workStealingPool();           // Destructor that finishes submitted work and stops the workers
+	int size();                    // Method to get the number of worker threads
+	void submit(const function<void()>& work); // Method to queue work for the next idle worker
+	void invoke(const function<void()>& a, const function<void()>& b); // Method to run two pieces of work in parallel and wait for both
+	void parallelFor(long long begin, long long end, long long grain,
+		const function<void(long long, long long)>& body); // Method to run body over [begin, end) split into ranges
+};
+
+thread_local workStealingPool* workStealingPool::currentPool = nullptr;
+thread_local int workStealingPool::self = 0;
+thread_local int workStealingPool::nesting = 0;
+
+// Constructor that starts the worker threads
+workStealingPool::workStealingPool(int n) : queued(0), stopping(false) {
+	workers = n > 0 ? n : (int)thread::hardware_concurrency(); // Default to one worker per core
+	if (workers < 1) workers = 1;
+	deques = new workDeque[workers + 1]; // The extra deque is for threads outside the pool
+	for (int i = 0; i < workers; i++) threads.push_back(thread(&workStealingPool::workerLoop, this, i));
+}
+
+// Destructor that lets the workers finish everything submitted and waits for them
+workStealingPool::~workStealingPool() {
+	{
+		lock_guard<mutex> guard(sleepLock);
+		stopping = true;
+	}
+	wake.notify_all();             // Wake everyone so they see stopping
+	for (thread& t : threads) t.join();
+	delete[] deques;
+}
+
+// Method to return the number of worker threads
+int workStealingPool::size() {
+	return workers;
+}
+
+// Method to return the deque the calling thread pushes to
+int workStealingPool::myDeque() {
+	return currentPool == this ? self : workers; // Outside threads share the last deque
+}
+
+// Method to make a task available to the pool and wake an idle worker
+void workStealingPool::push(forkTask* t) {
+	{
+		workDeque& d = deques[myDeque()];
+		lock_guard<mutex> guard(d.lock);
+		d.tasks.push_back(t);
+	}
+	signal();
+}
+
+// Method to queue work from outside the pool; it runs once a worker is idle, in submission order
+void workStealingPool::submit(const function<void()>& work) {
+	{
+		lock_guard<mutex> guard(submittedLock);
+		submitted.push_back(work);
+	}
+	signal();
+}
+
+// Method to count a new task and wake an idle worker for it
+void workStealingPool::signal() {
+	queued++;
+	{
+		lock_guard<mutex> guard(sleepLock); // A worker checking queued is either done or already waiting
+	}
+	wake.notify_one();
+}
+
+// Method to take a task: newest from our own deque, otherwise oldest from someone else's
+forkTask* workStealingPool::take() {
+	int mine = myDeque();
+	{
+		workDeque& d = deques[mine];
+		lock_guard<mutex> guard(d.lock);
+		if (!d.tasks.empty()) {
+			forkTask* t = d.tasks.back();
+			d.tasks.pop_back();
+			queued--;
+			return t;
+		}
+	}
+	for (int i = 1; i <= workers; i++) { // Try every other deque once, starting after our own
+		workDeque& d = deques[(mine + i) % (workers + 1)];
+		lock_guard<mutex> guard(d.lock);
+		if (!d.tasks.empty()) {
+			forkTask* t = d.tasks.front();
+			d.tasks.pop_front();
+			queued--;
+			return t;
+		}
+	}
+	return nullptr;                // Nothing to do anywhere
+}
+
+// Method to run a task taken off a deque, one level deeper than whatever the thread is running
+void workStealingPool::run(forkTask* t) {
+	nesting++;
+	t->run();
+	nesting--;
+	t->done.store(true, memory_order_release); // The forking frame may free t as soon as it sees this
+}
+
+// Method to run one waiting task, returns false if there was none
+bool workStealingPool::runOne() {
+	forkTask* t = take();
+	if (!t) return false;
+	run(t);
+	return true;
+}
+
+// Method to run t if it is still at the back of our deque (nobody stole it), returns false otherwise
+bool workStealingPool::runOwn(forkTask& t) {
+	{
+		workDeque& d = deques[myDeque()];
+		lock_guard<mutex> guard(d.lock);
+		if (d.tasks.empty() || d.tasks.back() != &t) return false;
+		d.tasks.pop_back();
+		queued--;
+	}
+	run(&t);
+	return true;
+}
+
+// Method to run the oldest submitted work, returns false if there was none
+bool workStealingPool::runSubmitted() {
+	function<void()> work;
+	{
+		lock_guard<mutex> guard(submittedLock);
+		if (submitted.empty()) return false;
+		work = submitted.front();
+		submitted.pop_front();
+		queued--;
+	}
+	work();                        // Outside the lock: it may fork tasks of its own
+	return true;
+}
+
+// Method to wait for a forked task; usually it is still on our deque and we simply run it ourselves.
+// Each task run meanwhile goes on top of this frame's stack, so past POOL_MAX_NESTING we stop
+// picking up others and only wait for ours.
+void workStealingPool::join(forkTask& t) {
+	while (!t.done.load(memory_order_acquire)) {
+		bool ran = nesting < POOL_MAX_NESTING ? runOne() : runOwn(t);
+		if (!ran) this_thread::yield(); // Someone stole it and is still running it
+	}
+}
+
+// Body of each worker thread: run forked tasks first, then submitted work, sleep when there is
+// neither; once stopping it leaves only when nothing is left
+void workStealingPool::workerLoop(int id) {
+	currentPool = this;
+	self = id;
+	while (true) {
+		if (runOne() || runSubmitted()) continue;
+		unique_lock<mutex> guard(sleepLock);
+		wake.wait(guard, [this] { return stopping || queued > 0; });
+		if (stopping && queued == 0) return;
+	}
+}
+
+// Method to run a and b in parallel and return once both are done (b may be stolen by another worker)
+void workStealingPool::invoke(const function<void()>& a, const function<void()>& b) {
+	forkTask t(b);                 // Offer b to the pool
+	push(&t);
+	a();                           // Do a ourselves
+	join(t);                       // Then run or wait for b
+}
+
+// Method to run body over [begin, end), recursively halving the range until pieces are at most
+// grain long (grain <= 0 picks about eight pieces per thread)
+void workStealingPool::parallelFor(long long begin, long long end, long long grain,
+	const function<void(long long, long long)>& body) {
+	if (grain <= 0) grain = max(1LL, (end - begin) / (8LL * (workers + 1)));
+	if (end - begin <= grain) {    // Small enough to do in one go
+		if (begin < end) body(begin, end);
+		return;
+	}
+	long long mid = begin + (end - begin) / 2;
+	invoke([&] { parallelFor(begin, mid, grain, body); },
+		[&] { parallelFor(mid, end, grain, body); });
+}
@@ -94,47 +94,119 @@ uint64_t intHash::hash(int64_t x) const {
 
 	return hash_value;                              // Return the final hash value
 }
-class hashTable {                  // Class for a hash table implementation
+// Class for a hash table implementation (chained, chains sorted by key); see Policies.h for the
+// parameters, hasher is anything with uint64_t hash(key) const. Each slot keeps a 32-bit summary of
+// its keys next to its chain, so most lookups for absent keys stop at the slot's cache line, which
+// a hit reads anyway; removals recompute their slot's summary, so it never goes stale.
+template <class key, class value, class keyOf, class compare = threeWay<key>, class trace = noTrace, class alloc = allocator<value>, class hasher = intHash>
+class basicHashTable {
 private:
-	intHash h;                      // An instance of the intHash class for hashing
-	sortedList* table;              // Pointer to an array of sortedList for collision resolution
+	typedef basicSortedList<key, value, keyOf, compare, trace, alloc> chain; // One slot's values
+
+	// One slot of the table
+	struct bucket {
+		chain list;                 // Values whose keys hash here
+		unsigned int tags;          // Bit tagOf() of every key in list
+	};
+
+	hasher h;                       // An instance of the hasher (intHash for integer keys)
+	bucket* table;                  // Pointer to an array of slots (sorted lists for collision resolution)
 	int tableLen;                   // Length of the hash table (number of slots)
 
+	static unsigned int tagOf(uint64_t hashed); // Method to pick a key's bit in its slot's summary
+
 public:
-	hashTable(int expNumBooks);     // Constructor to initialize the hash table
-	~hashTable();                   // Destructor to clean up the hash table
-	void insert(bookInfo* v);       // Method to insert a book into the hash table
-	bookInfo* get(int ISBN);        // Method to retrieve a book by ISBN
-	void remove(int ISBN);          // Method to remove a book by ISBN
+	basicHashTable(int expNumBooks); // Constructor to initialize the hash table
+	~basicHashTable();              // Destructor to clean up the hash table
+	void insert(const value& v);    // Method to insert a value into the hash table
+	value get(const key& k);        // Method to retrieve a value by key (value() if absent)
+	void remove(const key& k);      // Method to remove a value by key
+	void reserve(int expNumBooks);  // Method to grow the table for more values (not thread safe)
+	int slots();                    // Method to get the number of slots in the table
+	void forEachIn(int first, int last, const function<void(const value&)>& visit); // Method to visit every value in slots [first, last)
 };
 
 // Constructor definition for the hash table
-hashTable::hashTable(int expNumBooks) {
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class hasher>
+basicHashTable<key, value, keyOf, compare, trace, alloc, hasher>::basicHashTable(int expNumBooks) {
 	// Set tableLen to the next prime greater than expected number of books divided by 0.75
 	tableLen = next_prime(expNumBooks / 0.75 + 1);
-	table = new sortedList[tableLen];  // Dynamically allocate an array of sortedList for collision handling
+	table = new bucket[tableLen]();  // Dynamically allocate an array of slots for collision handling (no tags yet)
 }
 
 // Destructor to clean up the hash table
-hashTable::~hashTable() {
-	h.~intHash();                    // Explicitly call the intHash destructor
-	delete[] table;                  // Free the dynamically allocated sortedList array
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class hasher>
+basicHashTable<key, value, keyOf, compare, trace, alloc, hasher>::~basicHashTable() {
+	delete[] table;                  // Free the dynamically allocated slots (the hasher goes with the table)
 }
 
-// Insert a book into the hash table
-void hashTable::insert(bookInfo* v) {
-	// Hash the ISBN and mod by table length to find the correct slot, then insert the book into the sorted list at that slot
-	table[h.hash(v->ISBN) % tableLen].insert(v);
+// Insert a value into the hash table
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class hasher>
+void basicHashTable<key, value, keyOf, compare, trace, alloc, hasher>::insert(const value& v) {
+	// Hash the key and mod by table length to find the correct slot, then insert into the sorted list at that slot
+	traceSpan s = trace::begin();
+	uint64_t hashed = h.hash(keyOf::of(v));
+	int slot = hashed % tableLen;
+	table[slot].list.insert(v);
+	table[slot].tags |= tagOf(hashed);
+	trace::end(TRACE_HASH_INSERT, s, slot);
 }
 
-// Retrieve a book from the hash table by ISBN
-bookInfo* hashTable::get(int ISBN) {
-	// Hash the ISBN, mod by table length, then retrieve the book from the sorted list at that slot
-	return table[h.hash(ISBN) % tableLen].get(ISBN);
+// Retrieve a value from the hash table by key
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class hasher>
+value basicHashTable<key, value, keyOf, compare, trace, alloc, hasher>::get(const key& k) {
+	// Hash the key, mod by table length, then retrieve the value from the sorted list at that slot
+	traceSpan s = trace::begin();
+	uint64_t hashed = h.hash(k);
+	int slot = hashed % tableLen;
+	value found = table[slot].tags & tagOf(hashed) ? table[slot].list.get(k) : value(); // No tag: not in this chain
+	trace::end(TRACE_HASH_GET, s, slot);
+	return found;
 }
 
-// Remove a book from the hash table by ISBN
-void hashTable::remove(int ISBN) {
-	// Hash the ISBN, mod by table length, then remove the book from the sorted list at that slot
-	table[h.hash(ISBN) % tableLen].remove(ISBN);
+// Remove a value from the hash table by key
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class hasher>
+void basicHashTable<key, value, keyOf, compare, trace, alloc, hasher>::remove(const key& k) {
+	// Hash the key, mod by table length, then remove the value from the sorted list at that slot
+	traceSpan s = trace::begin();
+	int slot = h.hash(k) % tableLen;
+	if (table[slot].list.remove(k)) { // Recompute the slot's summary from the keys left
+		unsigned int tags = 0;
+		table[slot].list.forEach([&](const value& v) { tags |= tagOf(h.hash(keyOf::of(v))); });
+		table[slot].tags = tags;
+	}
+	trace::end(TRACE_HASH_REMOVE, s, slot);
 }
+
+// Method to grow the table so expNumBooks values keep chains short, moving the values already stored
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class hasher>
+void basicHashTable<key, value, keyOf, compare, trace, alloc, hasher>::reserve(int expNumBooks) {
+	int len = next_prime(expNumBooks / 0.75 + 1); // Same load factor as the constructor
+	if (len <= tableLen) return;    // Already big enough
+	bucket* old = table;            // Chains to move over
+	int oldLen = tableLen;
+	table = new bucket[len]();
+	tableLen = len;
+	for (int i = 0; i < oldLen; i++) old[i].list.forEach([this](const value& v) { insert(v); });
+	delete[] old;                   // Frees the old chains' nodes, not the values
+}
+
+// Method to return the number of slots, so callers can split a scan of the table into ranges
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class hasher>
+int basicHashTable<key, value, keyOf, compare, trace, alloc, hasher>::slots() {
+	return tableLen;
+}
+
+// Method to visit every value stored in slots [first, last)
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class hasher>
+void basicHashTable<key, value, keyOf, compare, trace, alloc, hasher>::forEachIn(int first, int last, const function<void(const value&)>& visit) {
+	for (int i = first; i < last; i++) table[i].list.forEach(visit);
+}
+
+// Method to pick the bit a key sets in its slot's summary, from hash bits the slot number barely depends on
+template <class key, class value, class keyOf, class compare, class trace, class alloc, class hasher>
+unsigned int basicHashTable<key, value, keyOf, compare, trace, alloc, hasher>::tagOf(uint64_t hashed) {
+	return 1u << ((hashed >> 35) & 31);
+}
+
+typedef basicHashTable<int, bookInfo*, isbnOf, threeWay<int>, libraryTrace> hashTable; // Hash table as the library builds it
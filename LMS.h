@@ -3,37 +3,202 @@
 #include "Queue.h"
 #include "BST.h"
 #include "Hash.h"
-#include "Stack.h"
+#include "PriceIndex.h"
+#include "Users.h"
+#include "TimerWheel.h"
+#include "UserIndex.h"
+#include "Ledger.h"
+#include "TopK.h"
+#include "Protocol.h"
+#include "Executor.h"
+#include "WAL.h"
+#include "Checkpoint.h"
+#include "Replication.h"
+#include "Stats.h"
+#include "Workload.h"
 #include <fstream>
 #include <sstream>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <cctype>
+#include <climits>
+#include <type_traits>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <condition_variable>
+#include <sys/wait.h>
 
-// Helper function to append one string to the end of another
-void addToEnd(char* beg, char* end) {
-	int i;                        // Integer for indexing
-	for (i = 0; beg[i]; i++);      // Move i to the end of the first string (beg)
-	beg[i++] = ',';					//This function gets called when a comma splits titles, so 
-	for (int j = 0; end[j]; i++, j++) { // Copy the second string (end) to the first string (beg)
-		beg[i] = end[j];
+const long long HOLD_PICKUP_SECONDS = 3 * 24 * 3600; // How long a returned copy is held for the next patron
+const long long LOAN_SECONDS = 21 * 24 * 3600;       // How long a patron may keep a borrowed copy
+const int MAX_LOANS = 10;                            // Most copies one patron may have out at once
+const int POPULAR_COUNTERS = 1000;                   // ISBNs monitored by each popularity tracker
+const long long POPULAR_DECAY_EVENTS = 100000;       // Events between halvings of popularity counts
+const int POPULAR_SHOWN = 10;                        // How many popular books are listed
+const int USER_SHARDS = 16;                          // Independently locked groups of patrons
+const int DEADLINE_TICK_SECONDS = 60;                // Resolution of hold and due date timers
+const unsigned long long CHECKPOINT_RECORDS = 100000; // Logged changes between background checkpoints
+const int CHECKPOINT_POLL_SECONDS = 1;               // How often the checkpointer looks at the log
+
+// Helper function to split one CSV line into fields; a quoted field may hold commas, and "" in it is a quote
+void splitCSV(const string& line, vector<string>& fields) {
+	fields.assign(1, string());
+	bool quoted = false;          // Inside a quoted field
+	for (size_t i = 0; i < line.size(); i++) {
+		char c = line[i];
+		if (quoted) {
+			if (c != '"') fields.back() += c;
+			else if (i + 1 < line.size() && line[i + 1] == '"') fields.back() += line[++i]; // Escaped quote
+			else quoted = false;  // Closing quote
+		}
+		else if (c == '"') quoted = true;
+		else if (c == ',') fields.push_back(string());
+		else if (c != '\r') fields.back() += c; // Files saved on Windows end lines with \r\n
 	}
-	beg[i] = 0;						// Add null to the end of the string to finish output
 }
 
+// Helper function to copy a string into a new C string
+char* newString(const string& s) {
+	char* copy = new char[s.size() + 1];
+	memcpy(copy, s.c_str(), s.size() + 1);
+	return copy;
+}
+
+// Outcomes of a borrow attempt
+enum borrowResult {
+	BORROWED,                     // A copy was taken off the shelf
+	PICKED_UP,                    // A copy held for the user was handed over
+	UNAVAILABLE,                  // No copies left
+	AT_LIMIT                      // The user already has MAX_LOANS books out
+};
+
+// Outcomes of a reservation attempt (non-negative results are the number ahead in line)
+enum reserveResult {
+	IN_STOCK = -2,                // A copy is on the shelf, so just borrow it
+	ALREADY_RESERVED = -3         // The user is already in line for this book
+};
+
+// One group of patrons (user id % USER_SHARDS) and everything they have out or on hold.
+// Requests for patrons in different shards never wait on each other.
+struct userShard {
+	mutex lock;                   // Guards everything below
+	timerWheel deadlines;         // Hold pickups and loan due dates of these patrons
+	unordered_map<uint64_t, timerNode*> holds; // (user, ISBN) -> pickup deadline of a held copy
+	loanLedger loans;             // Active loans by (user, ISBN), plus recent borrows per user
+	userIndex activity;           // Per-user index of holds and loans
+	spaceSaving mostBorrowed;     // Streaming top-K of ISBNs borrowed by these patrons
+	spaceSaving mostReserved;     // Streaming top-K of ISBNs reserved by these patrons
+
+	userShard() : deadlines(DEADLINE_TICK_SECONDS), mostBorrowed(POPULAR_COUNTERS, POPULAR_DECAY_EVENTS / USER_SHARDS),
+		mostReserved(POPULAR_COUNTERS, POPULAR_DECAY_EVENTS / USER_SHARDS) {} // Constructor with empty trackers
+};
+
 // Library Management System (LMS) class definition
-class LMS {
+class LMS : public requestHandler {
 private:
 	AVL byTitle;                  // AVL tree to store books by title
 	hashTable byISBN;             // Hash table to store books by ISBN
-	stack borrowed;               // Stack to track borrowed books
+	priceIndex byPrice;           // Books by price, for price range searches
 	garbage deleteWhenDone;       // Garbage collection to handle book deletions
+	userRegistry users;           // Registry mapping user names to compact ids
+	systemClock wallClock;        // Default clock (wall time)
+	clockSource* clock;           // Clock used for deadlines (injectable for testing)
+	userShard shards[USER_SHARDS]; // Patrons' loans, holds and deadlines, split by user id
+	atomic<long long> lastSweep;  // Deadline tick of the last expiry sweep
+	ostream* notices;             // Where hold and overdue notices are printed (nullptr = nowhere)
+	workStealingPool* workers;    // Threads for catalog-wide scans (nullptr = scan on the calling thread)
+	writeAheadLog journal;        // Log of every change to loans, holds, reservations and stock
+	writeAheadLog* wal;           // &journal once it is open (nullptr = changes are not logged)
+	static thread_local unsigned long long lastLogged; // Last record this thread appended
+	string logPath;               // Path of the write-ahead log ("" = none)
+	string tracePath;             // Where TRACE writes the containers' trace ("" = nowhere)
+	workloadRecorder* recorder;   // Writes every request to a workload trace (nullptr = not recording)
+	long long generation;         // Generation of the live log file (closed-off ones are logPath.<generation>)
+	changeGate gate;              // Every change passes through; closed for a moment while a checkpoint starts
+	mutex checkpointing;          // One checkpoint at a time
+	atomic<unsigned long long> checkpointedAt; // Log record count when the last checkpoint started
+	thread checkpointer;          // Background thread taking checkpoints
+	mutex stopLock;               // Guards stopping
+	condition_variable stopWake;  // Wakes the checkpointer (or the follower) early to stop
+	bool stopping;                // Set when the checkpointer (or the follower) must finish
+	logShipper* shipper;          // Streams every change to replicas (nullptr = not a primary)
+	atomic<bool> following;       // Set on a replica: changes only come from the primary
+	string primary;               // Replication address of the primary being followed
+	long long primaryEpoch;       // Run of the primary the replica's state came from
+	unsigned long long applied;   // Primary's records applied so far
+	atomic<long long> lastHeard;  // Steady clock second the primary was last heard from
+	atomic<int> followFd;         // Replication stream (-1 while reconnecting)
+	thread follower;              // Thread applying the primary's records
+
+	userShard& shardOf(int user);          // Method to get the shard a user belongs to
+	AVL::range lookUpTitle(char* title);   // Method to find every edition of a request's title (timed)
+	bookInfo* lookUpISBN(int ISBN);        // Method to find a request's book by ISBN (timed)
+	void lend(userShard& s, int user, bookInfo* b, long long now); // Method to hand a copy to a user and start its due date (shard locked)
+	bool takeHold(userShard& s, int user, bookInfo* b, long long now); // Method to turn a hold into a loan (shard locked)
+	bool dropHold(userShard& s, int user, bookInfo* b); // Method to cancel a hold without passing the copy on (shard locked)
+	void logChange(const char* kind, int ISBN, int user); // Method to append a record to the write-ahead log
+	void logChange(const char* kind, int ISBN, int user, long long when); // Method to append a record of a change made at a given time
+	void apply(const string& record);      // Method to redo one logged change
+	void restore(const string& record);    // Method to load one line of a snapshot
+	long long loadSnapshot(const string& path); // Method to load a snapshot file, returns its generation (0 if none, -1 if damaged)
+	bool writeSnapshot(const string& path, long long gen); // Method to write a snapshot file durably
+	void dumpState(FILE* f, long long gen); // Method to write every loan, hold, reservation and stock count
+	pid_t copyState(int fd, unsigned long long& seq); // Method to start writing a snapshot to a new replica
+	bool catchUp(int fd, lineReader& in); // Method to (re)join the primary's stream
+	void followLoop(lineReader in); // Body of the thread applying the primary's records
+	void checkpointLoop();                 // Body of the checkpointer thread
+	void offerCopy(bookInfo* b);           // Method to hold a freed copy for the next reservation or shelve it (no shard locked)
+	bool pickUp(int user, bookInfo* b);    // Method to turn a user's hold into a loan
+	void forfeit(int user, bookInfo* b);   // Method to give up a user's hold
+	bool hasHold(int user, int ISBN);      // Method to check whether a copy is being held for a user
+	int newestLoan(int user);              // Method to get the newest book a user still has out (0 if none)
+	int loanCount(int user);               // Method to get how many copies a user has out
+	bookInfo* endLoan(int user, int ISBN); // Method to end a user's loan of a book (nullptr if they have none)
+	void expireDeadlines();                // Method to process hold and due date timers that have passed
+	borrowResult borrow(int user, bookInfo* b); // Method to borrow (or pick up) a copy for a user
+	int reserve(int user, bookInfo* b);    // Method to queue a user for a book, returns how many are ahead (or a reserveResult)
+	bookInfo* giveBack(int user, int ISBN); // Method to return a user's copy and pass it along (nullptr if they have none)
+	void showAccount(int user, ostream& out); // Method to list a user's loans and holds
+	void showPopular(bool borrowed, ostream& out); // Method to list the most borrowed or most reserved books
+	void showInventory(ostream& out);      // Method to total up the whole catalog
+	void findPrefix(const string& p, ostream& out); // Method to list books whose title starts with p
+	void findAuthor(const string& name, ostream& out); // Method to list books by an author
+	void findPriced(double low, double high, bool inStock, ostream& out); // Method to list books in a price range
+	void describe(bookInfo* b, ostream& out); // Method to write a book as one tab separated line
 
 public:
-	LMS();                        // Constructor to initialize the LMS system
+	LMS(clockSource* clk = nullptr, int part = 0, int parts = 1); // Constructor to load the catalog (or the part a shard process owns)
 	~LMS();                       // Destructor to clean up the LMS system
 	void interface();             // Method to handle user interface for borrowing/returning books
+	void useWorkers(workStealingPool* pool); // Method to let catalog-wide scans run on a thread pool
+	void handle(const char* line, string& out); // Method to answer one protocol request (thread safe)
+	void prepare(const char* line); // Method to make a query's changes (expiries) ahead of answering it
+	bool openLog(const char* path); // Method to replay a write-ahead log and keep logging to it
+	void sync();                  // Method to wait until this thread's logged changes are durable
+	bool syncLater(const function<void()>& done); // Method to have done called once this thread's logged changes are durable, without waiting
+	bool checkpoint();            // Method to snapshot the library in the background and drop the log it covers
+	bool serveReplicas(const char* addr); // Method to stream every change to replicas connecting on addr
+	bool follow(const char* addr); // Method to copy a primary's state and keep applying its changes (read only from then on)
+	void traceTo(const char* path); // Method to set the file the containers' trace is dumped to
+	long long dumpTrace();        // Method to dump the containers' trace, returns the events written (-1 if none can be)
+	bool recordTo(const char* path); // Method to write the state and every request from now on to a workload trace
+	long long loadState(const function<bool(string&)>& next); // Method to load snapshot lines (a trace's starting state, say), returns the number in the header (-1 if damaged)
 };
 
+thread_local unsigned long long LMS::lastLogged = 0;
+
 // Constructor for the Library Management System (LMS)
-LMS::LMS() : byISBN(100) {        // Initialize the AVL tree, hash table, and other structures
+LMS::LMS(clockSource* clk, int part, int parts) : byISBN(100), clock(clk ? clk : &wallClock), notices(nullptr), workers(nullptr), wal(nullptr), recorder(nullptr),
+	generation(0), checkpointedAt(0), stopping(false), shipper(nullptr), following(false), primaryEpoch(0), applied(0),
+	lastHeard(0), followFd(-1) { // Initialize the AVL tree, hash table, and other structures
+	long long now = clock->now();  // Deadlines are measured from now
+	for (userShard& s : shards) s.deadlines.start(now);
+	lastSweep = now / DEADLINE_TICK_SECONDS;
+
 	ifstream file("Book Dataset.csv"); // Open the book dataset file
 
 	if (!file.is_open()) {         // If the file failed to open, display an error message
@@ -41,46 +206,984 @@ LMS::LMS() : byISBN(100) {        // Initialize the AVL tree, hash table, and ot
 		return;
 	}
 
-	char line[150];                // Buffer to store each line from the file
-	bookInfo* v;                   // Pointer to store book information
-	char num[10];                  // Buffer to store numbers as strings
-	while (file.getline(line, 1500) && line[0] != ',') { // Read each line of the CSV file
-		v = new bookInfo;          // Dynamically allocate memory for a new book
+	string line;                   // One line of the file
+	int rows = 0;                  // Size the ISBN table for the whole file up front
+	while (getline(file, line)) rows++;
+	byISBN.reserve(rows / parts + 1);
+	file.clear();
+	file.seekg(0);
 
-		stringstream ss(line);     // Create a stringstream from the line
+	vector<string> fields;         // Fields of one line
+	long long tooLong = 0;         // Books skipped because their ISBN does not fit
+	while (getline(file, line) && line[0] != ',') { // Read each line of the CSV file (a line of commas ends the data)
+		splitCSV(line, fields);
+		if (fields.size() < 5 || fields[0].empty() || !isdigit((unsigned char)fields[0][0])) continue; // Header or junk
+		long long ISBN = atoll(fields[0].c_str());
+		if (ISBN > INT_MAX) {      // ISBN-13s and the like are longer than the int ISBNs are kept in
+			tooLong++;
+			continue;
+		}
+		if (ownerShard((int)ISBN, parts) != part) continue; // Another shard process owns this book
+		latencyTimer timer(STAT_INGEST); // Only books that are loaded count as ingests
+
+		size_t a = 2;              // Author's names don't start with ' '; such pieces are an unquoted title's
+		string title = fields[1];
+		for (; a + 3 < fields.size() && fields[a][0] == ' '; a++) title += "," + fields[a];
+		string author = fields[a]; // Whatever is left before the price belongs to the author
+		for (a++; a + 2 < fields.size(); a++) author += "," + fields[a];
+
+		bookInfo* v = new bookInfo; // Dynamically allocate memory for a new book
+		v->ISBN = (int)ISBN;
+		v->title = newString(title);
+		v->author = newString(author);
+		v->price = atof(fields[a].c_str()); // Price and quantity are the last two fields
+		v->quantity = atoi(fields[a + 1].c_str());
+
+		deleteWhenDone.add(v);     // Add the book to the garbage collector
+		byTitle.insert(v);         // Insert the book into the AVL tree (by title)
+		byISBN.insert(v);          // Insert the book into the hash table (by ISBN)
+		byPrice.insert(v);         // Insert the book into the price index
+	}
+	if (tooLong) cerr << "Skipped " << tooLong << " books whose ISBN has more than 9 digits" << endl;
+}
+
+// Destructor for the LMS system
+LMS::~LMS() {
+	{
+		lock_guard<mutex> guard(stopLock);
+		stopping = true;
+	}
+	stopWake.notify_all();
+	if (checkpointer.joinable()) checkpointer.join();
+	int fd = followFd.load();
+	if (fd >= 0) shutdown(fd, SHUT_RDWR); // Ends the follower's read
+	if (follower.joinable()) follower.join();
+	delete shipper;
+	delete recorder;               // Writes out the last requests
+	deleteWhenDone.~garbage();     // Clean up the garbage collector
+	// Note: AVL and hashTable destructors are called automatically
+}
+
+// Method to return the shard a user's loans and holds live in
+userShard& LMS::shardOf(int user) {
+	return shards[user % USER_SHARDS];
+}
 
-		ss.getline(num, 10, ',');  // Get the ISBN from the string
-		if (num[0] >= '0' && num[0] <= '9') { // Check if the ISBN is valid
-			v->ISBN = stoi(num);   // Convert the string to an integer (ISBN)
+// Method to find every book with the title a request names, recording how long the search took
+AVL::range LMS::lookUpTitle(char* title) {
+	latencyTimer timer(STAT_TITLE_LOOKUP);
+	return byTitle.retrieveAll(title);
+}
+
+// Method to find the book a request names by ISBN, recording how long the search took
+bookInfo* LMS::lookUpISBN(int ISBN) {
+	latencyTimer timer(STAT_ISBN_LOOKUP);
+	return byISBN.get(ISBN);
+}
+
+// Method to hand a copy to a user and start its due date, counted from now (caller holds the
+// shard lock); replaying a change passes the time it happened instead of the clock's
+void LMS::lend(userShard& s, int user, bookInfo* b, long long now) {
+	s.loans.checkout(user, b, s.deadlines.schedule(now + LOAN_SECONDS, LOAN_DUE, user, b)); // Record the loan and start its due date
+	s.activity.addLoan(user, b->ISBN); // Count it against the user
+	s.mostBorrowed.add(b->ISBN);   // Feed the popularity tracker
+}
+
+// Method to turn a user's hold on a book into a loan (caller holds the shard lock), returns false if they have no hold
+bool LMS::takeHold(userShard& s, int user, bookInfo* b, long long now) {
+	unordered_map<uint64_t, timerNode*>::iterator it = s.holds.find(userBookKey(user, b->ISBN));
+	if (it == s.holds.end()) return false; // No copy is waiting for them
+	logChange("PICKUP", b->ISBN, user, now);
+	s.deadlines.cancel(it->second); // Stop the pickup deadline
+	s.holds.erase(it);
+	s.activity.removeHold(user, b->ISBN); // The hold is fulfilled
+	lend(s, user, b, now);         // The held copy becomes their loan
+	return true;
+}
+
+// Method to cancel a user's hold without passing the copy on (caller holds the shard lock)
+bool LMS::dropHold(userShard& s, int user, bookInfo* b) {
+	unordered_map<uint64_t, timerNode*>::iterator it = s.holds.find(userBookKey(user, b->ISBN));
+	if (it == s.holds.end()) return false; // No copy is waiting for them
+	s.deadlines.cancel(it->second); // Stop the pickup deadline
+	s.holds.erase(it);
+	s.activity.removeHold(user, b->ISBN); // The hold is gone
+	return true;
+}
+
+// Method to end a user's loan of one copy of a book, returns the book (nullptr if they have none)
+bookInfo* LMS::endLoan(int user, int ISBN) {
+	userShard& s = shardOf(user);
+	lock_guard<mutex> guard(s.lock);
+	bookInfo* b;                   // Book being returned
+	timerNode* due;                // Its due date timer
+	if (!s.loans.checkin(user, ISBN, b, due)) return nullptr; // They don't have it
+	logChange("RETURN", ISBN, user);
+	s.deadlines.cancel(due);       // Stop the due date (no-op if it already fired)
+	s.activity.removeLoan(user, ISBN); // The user no longer has this copy
+	return b;
+}
+
+// Method to pass a freed copy to the next reservation, or back on the shelf if nobody is waiting.
+// A copy is never left on the shelf while someone is in line: with the locked queue, taking the
+// next patron and shelving happen under the book's lock; the ticket-ordered queue has no lock, so after
+// shelving we look at the queue again, and reserve() looks at the shelf after queueing, and
+// whichever sees the other takes the copy back off the shelf for the line. The caller must not
+// hold a shard lock (shards are locked before books).
+void LMS::offerCopy(bookInfo* b) {
+	latencyTimer timer(STAT_HANDOFF);
+	int next;                      // Next patron in line (-1 if none)
+	while (true) {
+		{
+			unique_lock<mutex> guard = b->reservationGuard();
+			next = b->reservations.dequeue([&](int user) {
+				logChange("HOLD", b->ISBN, user); // Logged in turn, so per book the log keeps queue order
+			});
+			if (next >= 0) break;
+			logChange("SHELVE", b->ISBN, -1);
+			b->putCopy();          // Nobody waiting, the copy is available again
+		}
+		if (!reservationQueue::selfOrdered || b->reservations.isEmpty() || !b->takeCopy()) return;
+		logChange("UNSHELVE", b->ISBN, -1); // Someone queued meanwhile without seeing it: offer it again
+	}
+	libraryTrace::mark(TRACE_HANDOFF, b->ISBN);
+	userShard& s = shardOf(next);  // The copy is now theirs; it never touches the shelf
+	{
+		lock_guard<mutex> guard(s.lock);
+		s.holds[userBookKey(next, b->ISBN)] = s.deadlines.schedule(clock->now() + HOLD_PICKUP_SECONDS, HOLD_PICKUP, next, b); // Hold it for them
+	}
+	if (notices) *notices << "A copy of " << b->title << " is being held for " << users.name(next) << "." << '\n';
+}
+
+// Method to turn a user's hold on a book into a loan, returns false if they have no hold
+bool LMS::pickUp(int user, bookInfo* b) {
+	gatePass pass(gate);
+	userShard& s = shardOf(user);
+	lock_guard<mutex> guard(s.lock);
+	return takeHold(s, user, b, clock->now());
+}
+
+// Method to give up a user's hold, passing the copy along
+void LMS::forfeit(int user, bookInfo* b) {
+	gatePass pass(gate);
+	userShard& s = shardOf(user);
+	{
+		lock_guard<mutex> guard(s.lock);
+		if (!dropHold(s, user, b)) return; // No copy is waiting for them
+		logChange("FORFEIT", b->ISBN, user);
+	}
+	offerCopy(b);                  // Next in line gets it
+}
+
+// Method to check whether a copy of a book is being held for a user
+bool LMS::hasHold(int user, int ISBN) {
+	userShard& s = shardOf(user);
+	lock_guard<mutex> guard(s.lock);
+	return s.holds.count(userBookKey(user, ISBN)) != 0;
+}
+
+// Method to return the newest book a user still has out (0 if none)
+int LMS::newestLoan(int user) {
+	userShard& s = shardOf(user);
+	lock_guard<mutex> guard(s.lock);
+	for (int i = 0; i < s.loans.recentCount(user); i++) { // Newest first
+		if (s.loans.has(user, s.loans.recentAt(user, i))) return s.loans.recentAt(user, i);
+	}
+	return 0;
+}
+
+// Method to return how many copies a user has out
+int LMS::loanCount(int user) {
+	userShard& s = shardOf(user);
+	lock_guard<mutex> guard(s.lock);
+	return s.activity.loanCount(user);
+}
 
-			v->title = new char[110]; // Allocate memory for the title
-			ss.getline(v->title, 110, ','); // Get the title from the string
+// Method to process every deadline that has passed since the last sweep. Only one caller per
+// tick sweeps; the rest return at once instead of queuing on every shard lock.
+void LMS::expireDeadlines() {
+	long long now = clock->now();
+	long long tick = now / DEADLINE_TICK_SECONDS;
+	long long last = lastSweep.load();
+	if (tick <= last || !lastSweep.compare_exchange_strong(last, tick)) return; // Already swept this tick
+	gatePass pass(gate);
 
-			v->author = new char[60]; // Allocate memory for the author
-			ss.getline(v->author, 60, ','); // Get the author from the string
-			while (v->author[0] == ' ') { // Author's names don't start with ' '; this was a part of the title!
-				addToEnd(v->title, v->author); // Append it to the title
-				ss.getline(v->author, 60, ','); // Get the next part of the author name
+	vector<bookInfo*> freed;       // Copies whose holds lapsed, passed along once the shard is unlocked
+	for (userShard& s : shards) {
+		{
+			lock_guard<mutex> guard(s.lock);
+			timerNode* t = s.deadlines.advance(now); // Timers that fired
+			while (t) {
+				timerNode* next = t->next;
+				if (t->kind == HOLD_PICKUP) { // The patron never came for their copy
+					logChange("EXPIRE", t->book->ISBN, t->user);
+					s.holds.erase(userBookKey(t->user, t->book->ISBN));
+					s.activity.removeHold(t->user, t->book->ISBN);
+					if (notices) *notices << "Hold on " << t->book->title << " for " << users.name(t->user) << " expired." << '\n';
+					freed.push_back(t->book);
+				}
+				else {                 // A loan has run past its due date
+					s.loans.dueFired(t->user, t->book->ISBN, t); // The ledger must not cancel it later
+					if (notices) *notices << users.name(t->user) << "'s copy of " << t->book->title << " is overdue." << '\n';
+				}
+				delete t;              // Expired timers belong to us now
+				t = next;
 			}
+		}
+		for (bookInfo* b : freed) offerCopy(b); // Move on to the next person in each queue
+		freed.clear();
+	}
+}
 
-			ss.getline(num, 10, ','); // Get the price as a string
-			v->price = stod(num);    // Convert the price string to a double
+// Method to borrow a copy of a book for a user (a copy held for them takes priority).
+// Taking a shelf copy is a single compare-and-swap on the book's count.
+borrowResult LMS::borrow(int user, bookInfo* b) {
+	latencyTimer timer(STAT_BORROW);
+	gatePass pass(gate);
+	userShard& s = shardOf(user);
+	lock_guard<mutex> guard(s.lock);
+	if (s.activity.loanCount(user) >= MAX_LOANS) return AT_LIMIT; // Checkout limit reached
+	long long now = clock->now();
+	if (takeHold(s, user, b, now)) return PICKED_UP; // A copy is being held for them
+	if (!b->takeCopy()) return UNAVAILABLE; // Out of stock
+	logChange("BORROW", b->ISBN, user, now);
+	lend(s, user, b, now);
+	return BORROWED;
+}
 
-			ss.getline(num, 10, ','); // Get the quantity as a string
-			v->quantity = stoi(num);  // Convert the quantity string to an integer
+// Method to queue a user for a book, returns how many are ahead of them (or a reserveResult)
+int LMS::reserve(int user, bookInfo* b) {
+	gatePass pass(gate);
+	userShard& s = shardOf(user);
+	int ahead;
+	{
+		lock_guard<mutex> guard(s.lock);
+		const userActivity* a = s.activity.get(user);
+		if (a && a->holds.count(b->ISBN)) return ALREADY_RESERVED; // One place in line per user
 
-			deleteWhenDone.add(v);   // Add the book to the garbage collector
-			byTitle.insert(v);       // Insert the book into the AVL tree (by title)
-			byISBN.insert(v);        // Insert the book into the hash table (by ISBN)
+		long long ticket;          // Their entry in the queue
+		{
+			unique_lock<mutex> bookGuard = b->reservationGuard(); // Returns shelve copies under this lock too (if there is one)
+			if (b->quantity > 0) return IN_STOCK; // A copy came back meanwhile
+			ticket = b->reservations.enqueue(user, [&] { logChange("RESERVE", b->ISBN, user); }); // Join the queue
+			ahead = max(0, b->reservations.ahead(ticket)); // (Already served if it has left the queue)
 		}
-		else delete v;               // If ISBN is invalid, delete the book object
+		s.activity.addHold(user, b->ISBN, ticket); // Track the reservation (and its place in line) on their account
+		s.mostReserved.add(b->ISBN); // Feed the popularity tracker
+	}
+	if (reservationQueue::selfOrdered && b->quantity > 0 && b->takeCopy()) { // Shelved while we queued, by a returner who saw no line
+		logChange("UNSHELVE", b->ISBN, -1);
+		offerCopy(b);              // To the front of the line (perhaps us)
 	}
+	return ahead;
 }
 
-// Destructor for the LMS system
-LMS::~LMS() {
-	deleteWhenDone.~garbage();     // Clean up the garbage collector
-	// Note: AVL and hashTable destructors are called automatically
+// Method to return a user's copy of a book and pass it to the next reservation (nullptr if they have none)
+bookInfo* LMS::giveBack(int user, int ISBN) {
+	latencyTimer timer(STAT_RETURN);
+	gatePass pass(gate);
+	bookInfo* b = endLoan(user, ISBN); // End the loan
+	if (b) offerCopy(b);           // Hold the copy for the next reservation or put it back on the shelf
+	return b;
+}
+
+// Method to append a change to the write-ahead log and ship it to replicas (a no-op when there
+// is neither). Callers hold the lock that orders the change (or, for the ticket-ordered reservation
+// queue, log from its inOrder step), so conflicting changes reach the log, and every replica, in
+// the order they happened.
+void LMS::logChange(const char* kind, int ISBN, int user) {
+	logChange(kind, ISBN, user, clock->now());
+}
+
+// Method to append a record of a change made at time when (a replayed change keeps its own time)
+void LMS::logChange(const char* kind, int ISBN, int user, long long when) {
+	if (!wal && !shipper) return;
+	char record[512];              // Records are short: a kind, a time, an ISBN and a name
+	snprintf(record, sizeof(record), "%s %lld %d %s", kind, when, ISBN, user >= 0 ? users.name(user) : "");
+	if (wal) lastLogged = wal->append("%s", record);
+	if (shipper) shipper->publish(record);
+}
+
+// Method to redo one logged change. Records are facts, not requests: each is applied as it
+// happened (stock may briefly go negative mid-replay) and nothing is decided again. Locks are
+// taken as a live change would take them, since a replica answers reads meanwhile.
+void LMS::apply(const string& record) {
+	char kind[16];                 // What happened
+	long long when;                // When it happened
+	int ISBN, at = 0;              // Book, and where the user name starts
+	if (sscanf(record.c_str(), "%15s %lld %d %n", kind, &when, &ISBN, &at) < 3) return; // Not a record
+	bookInfo* b = byISBN.get(ISBN);
+	if (!b) return;                // Not in this catalog (any more)
+	string k = kind;
+	if (k == "SHELVE") {
+		b->putCopy();
+		return;
+	}
+	if (k == "UNSHELVE") {         // A shelved copy was taken back for the reservation line
+		b->addCopies(-1);
+		return;
+	}
+	if (!at || !record[at]) return; // Every other record names a user
+	int user = users.intern(record.c_str() + at);
+	userShard& s = shardOf(user);
+	if (k == "RETURN") {           // Locks the shard itself
+		endLoan(user, ISBN);
+		return;
+	}
+	{                              // Deadlines count from when it happened, not from now
+		lock_guard<mutex> guard(s.lock);
+		if (k == "BORROW") {
+			b->addCopies(-1);
+			lend(s, user, b, when);
+		}
+		else if (k == "PICKUP") takeHold(s, user, b, when);
+		else if (k == "RESERVE") {
+			long long ticket;
+			{
+				unique_lock<mutex> bookGuard = b->reservationGuard();
+				ticket = b->reservations.enqueue(user);
+			}
+			s.activity.addHold(user, ISBN, ticket);
+			s.mostReserved.add(ISBN);
+		}
+		else if (k == "HOLD") {
+			{
+				unique_lock<mutex> bookGuard = b->reservationGuard();
+				b->reservations.dequeue(); // The user at the front of the line
+			}
+			s.holds[userBookKey(user, ISBN)] = s.deadlines.schedule(when + HOLD_PICKUP_SECONDS, HOLD_PICKUP, user, b);
+		}
+		else if (k == "FORFEIT" || k == "EXPIRE") dropHold(s, user, b);
+	}
+}
+
+// Method to bring the loaded catalog up to date and log every further change. The last
+// snapshot is loaded first, then the closed-off log segments it does not cover, then the live
+// log, and a background thread keeps taking checkpoints from then on. Returns false if the
+// snapshot is damaged or the log cannot be opened for writing.
+bool LMS::openLog(const char* path) {
+	logPath = path;
+	long long snap = loadSnapshot(logPath + ".snap");
+	if (snap < 0) return false;
+	generation = snap;             // The live log is at least as new as the snapshot
+	function<void(const string&)> redo = [this](const string& record) { apply(record); };
+	long long n = 0;               // Changes replayed
+	for (long long g : closedSegments(logPath)) {
+		string segment = segmentPath(logPath, g);
+		if (g < snap) {            // Already in the snapshot (the crash came before it was deleted)
+			unlink(segment.c_str());
+			continue;
+		}
+		n += max(0LL, writeAheadLog::replay(segment.c_str(), redo));
+		generation = g + 1;        // The live log was started after this segment was closed off
+	}
+	n += max(0LL, writeAheadLog::replay(path, redo));
+	if (n > 0 && notices) *notices << "Replayed " << n << " logged changes." << '\n';
+	if (!journal.open(path)) return false;
+	wal = &journal;
+	if (n >= (long long)CHECKPOINT_RECORDS && !checkpoint()) cerr << "Checkpoint failed; the log is kept until the next one" << endl;
+	checkpointer = thread(&LMS::checkpointLoop, this);
+	return true;
+}
+
+// Method to take a checkpoint. Changes are held back only while the live log is closed off and
+// the process forks; the child writes the snapshot from its copy-on-write image of memory while
+// the parent carries on serving. Once the snapshot is durable the segments it covers are
+// deleted, so a restart never replays more than the changes since the last checkpoint.
+// Returns false if it failed (the closed-off segments are then kept and replayed on restart).
+bool LMS::checkpoint() {
+	if (!wal) return false;
+	lock_guard<mutex> one(checkpointing);
+	long long covered = generation; // Segment being closed off; the snapshot covers it and all before it
+	gate.close();                  // From here no change is half made, or made but not yet logged
+	users.freeze();                // Nor is anyone half registered
+	checkpointedAt = journal.count();
+	bool rolled = journal.roll(segmentPath(logPath, covered).c_str());
+	// The child is not async-signal-safe: writeSnapshot uses stdio, new and std::function, which
+	// POSIX does not allow after fork in a threaded process. It relies on glibc, whose fork takes
+	// the malloc and stdio locks around the call and resets them in the child, so none is left held
+	// by a thread that did not come along. Other C libraries may deadlock the child here.
+	pid_t child = rolled ? fork() : -1;
+	if (child == 0) _exit(writeSnapshot(logPath + ".snap", covered + 1) ? 0 : 1); // The child only reads its frozen copy
+	if (rolled) generation = covered + 1;
+	users.thaw();
+	gate.open();
+	if (child < 0) return false;
+
+	int status;                    // Wait for the snapshot to be written
+	while (waitpid(child, &status, 0) < 0) {
+		if (errno != EINTR) return false;
+	}
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) return false;
+	for (long long g : closedSegments(logPath)) {
+		if (g <= covered) unlink(segmentPath(logPath, g).c_str()); // Everything in it is in the snapshot
+	}
+	return true;
+}
+
+// Body of the checkpointer thread: take a checkpoint once CHECKPOINT_RECORDS changes have been
+// logged since the last one
+void LMS::checkpointLoop() {
+	unique_lock<mutex> guard(stopLock);
+	while (!stopping) {
+		stopWake.wait_for(guard, chrono::seconds(CHECKPOINT_POLL_SECONDS));
+		if (stopping || journal.count() - checkpointedAt < CHECKPOINT_RECORDS) continue;
+		guard.unlock();            // Stopping must not wait for the snapshot
+		if (!checkpoint()) cerr << "Checkpoint failed; the log is kept until the next one" << endl;
+		guard.lock();
+	}
+}
+
+// Method to write a snapshot file. It goes to a temporary file that is renamed into place once
+// durable, so a crash leaves the previous snapshot. Runs in the checkpoint's child process.
+bool LMS::writeSnapshot(const string& path, long long gen) {
+	string temp = path + ".tmp";
+	FILE* f = fopen(temp.c_str(), "w");
+	if (!f) return false;
+	dumpState(f, gen);
+	bool ok = fflush(f) == 0 && fsync(fileno(f)) == 0;
+	if (fclose(f) != 0) ok = false;
+	if (!ok || rename(temp.c_str(), path.c_str()) != 0) return false;
+	syncDirectory(path);
+	return true;
+}
+
+// Method to write the whole state: every stock count, reservation queue, hold, loan, recent borrow
+// and popularity counter, one per line in the shape of a log record ("KIND value ISBN name"),
+// between a "SNAPSHOT gen time" header and an END line. Only called with the gate closed and the
+// users frozen: in a child process forked that way, which is alone with a frozen copy of the
+// library, or by recordTo while it holds them so. Either way it takes no locks.
+void LMS::dumpState(FILE* f, long long gen) {
+	fprintf(f, "SNAPSHOT %lld %lld\n", gen, clock->now());
+	byISBN.forEachIn(0, byISBN.slots(), [&](bookInfo* b) {
+		fprintf(f, "STOCK %d %d\n", b->quantity.load(), b->ISBN);
+		int place = 0;             // Queue order is line order
+		b->reservations.forEach([&](int user) {
+			fprintf(f, "QUEUE %d %d %s\n", place++, b->ISBN, users.frozenName(user));
+		});
+	});
+	int* keys = new int[POPULAR_COUNTERS]; // One tracker's ISBNs
+	long long* hits = new long long[POPULAR_COUNTERS]; // Their counts
+	for (int i = 0; i < USER_SHARDS; i++) {
+		userShard& s = shards[i];
+		for (pair<const uint64_t, timerNode*>& h : s.holds) {
+			fprintf(f, "HOLD %lld %d %s\n", s.deadlines.when(h.second), h.second->book->ISBN, users.frozenName(h.second->user));
+		}
+		s.loans.forEachLoan([&](int user, bookInfo* b, timerNode* due) { // Due 0: already overdue
+			fprintf(f, "LOAN %lld %d %s\n", due ? s.deadlines.when(due) : 0LL, b->ISBN, users.frozenName(user));
+		});
+		s.loans.forEachRecent([&](int user, int ISBN) {
+			fprintf(f, "RECENT 0 %d %s\n", ISBN, users.frozenName(user));
+		});
+		int n = s.mostBorrowed.top(POPULAR_COUNTERS, keys, hits); // The shard number stands in for a name
+		for (int j = 0; j < n; j++) fprintf(f, "BORROWED %lld %d %d\n", hits[j], keys[j], i);
+		n = s.mostReserved.top(POPULAR_COUNTERS, keys, hits);
+		for (int j = 0; j < n; j++) fprintf(f, "RESERVED %lld %d %d\n", hits[j], keys[j], i);
+	}
+	delete[] keys;
+	delete[] hits;
+	fprintf(f, "END\n");          // Marks the snapshot complete
+}
+
+// Method to load a snapshot file on top of the freshly loaded catalog, returns its generation
+// (0 if there is none, -1 if it is damaged)
+long long LMS::loadSnapshot(const string& path) {
+	ifstream in(path);
+	if (!in.is_open()) return 0;   // Never checkpointed
+	long long gen = loadState([&](string& line) { return (bool)getline(in, line); });
+	if (gen < 0) cerr << "Snapshot " << path << " is incomplete" << endl;
+	return gen;
+}
+
+// Method to load snapshot lines (see dumpState) up to their END line, returns the number in the
+// header (-1 if the lines are not a complete snapshot)
+long long LMS::loadState(const function<bool(string&)>& next) {
+	string line;
+	long long gen = -1;            // From the first line
+	while (next(line)) {
+		if (gen < 0) {
+			if (sscanf(line.c_str(), "SNAPSHOT %lld", &gen) != 1) return -1; // Not a snapshot
+		}
+		else if (line == "END") return gen;
+		else restore(line);
+	}
+	return -1;
+}
+
+// Method to load one snapshot line (see dumpState)
+void LMS::restore(const string& record) {
+	char kind[16];                 // What the line describes
+	long long value;               // Count or deadline
+	int ISBN, at = 0;              // Book, and where the user name starts
+	if (sscanf(record.c_str(), "%15s %lld %d %n", kind, &value, &ISBN, &at) < 3) return;
+	bookInfo* b = byISBN.get(ISBN);
+	if (!b) return;                // Not in this catalog (any more)
+	string k = kind;
+	if (k == "STOCK") {
+		b->setQuantity((int)value);
+		return;
+	}
+	if (!at || !record[at]) return; // Every other line names a user (or a shard)
+	if (k == "BORROWED" || k == "RESERVED") {
+		userShard& s = shards[atoi(record.c_str() + at) % USER_SHARDS];
+		(k == "BORROWED" ? s.mostBorrowed : s.mostReserved).restore(ISBN, value);
+		return;
+	}
+	int user = users.intern(record.c_str() + at);
+	userShard& s = shardOf(user);
+	if (k == "QUEUE") {
+		s.activity.addHold(user, ISBN, b->reservations.enqueue(user));
+	}
+	else if (k == "HOLD") {
+		s.holds[userBookKey(user, ISBN)] = s.deadlines.schedule(value, HOLD_PICKUP, user, b);
+		s.activity.addHold(user, ISBN, -1); // Held copies have left the queue
+	}
+	else if (k == "LOAN") {
+		s.loans.restore(user, b, value ? s.deadlines.schedule(value, LOAN_DUE, user, b) : nullptr);
+		s.activity.addLoan(user, ISBN);
+	}
+	else if (k == "RECENT") s.loans.remember(user, ISBN);
+}
+
+// Method to wait until every change this thread has logged is on disk
+void LMS::sync() {
+	if (wal && lastLogged) wal->waitDurable(lastLogged);
+}
+
+// Method to have done called on the log's writer thread once this thread's logged changes are
+// durable; false (and done is not called) if they already are
+bool LMS::syncLater(const function<void()>& done) {
+	return wal && lastLogged && wal->whenDurable(lastLogged, done);
+}
+
+// Method to set the file the containers' trace is dumped to (by TRACE, or by main on the way out)
+void LMS::traceTo(const char* path) {
+	tracePath = path;
+}
+
+// Method to write every thread's recent container events to the trace file as a Chrome trace;
+// -1 if the build does not trace, no file was set, or it could not be written
+long long LMS::dumpTrace() {
+	if (is_same<libraryTrace, noTrace>::value || tracePath.empty()) return -1;
+	return traceRings.dump(tracePath.c_str());
+}
+
+// Method to record every request answered from now on (for replay.cpp), false if the file cannot be
+// created. The trace starts with the state as of now, written with the gate closed as a snapshot
+// is, so a replay can start from it rather than from the catalog as loaded.
+bool LMS::recordTo(const char* path) {
+	workloadRecorder* r = new workloadRecorder;
+	gate.close();                  // No change is half made while the state is written
+	users.freeze();
+	bool opened = r->open(path, [this](FILE* f) { dumpState(f, generation); });
+	users.thaw();
+	gate.open();
+	if (!opened) {
+		delete r;
+		return false;
+	}
+	recorder = r;
+	return true;
+}
+
+// Method to make this library a primary: every change from now on is shipped to the replicas
+// that connect on addr, each of which first gets a copy of the whole state
+bool LMS::serveReplicas(const char* addr) {
+	shipper = new logShipper([this](int fd, unsigned long long& seq) { return copyState(fd, seq); });
+	if (shipper->listenOn(addr)) return true;
+	delete shipper;
+	shipper = nullptr;
+	return false;
+}
+
+// Method to start copying the whole state to a new replica. With the gate closed for a moment the
+// next record's number is noted and the process forks; the child writes the state as of that
+// record to the replica's socket while the parent carries on. Returns the child (-1 if none).
+pid_t LMS::copyState(int fd, unsigned long long& seq) {
+	gate.close();                  // No change is half made, or made but not yet shipped
+	users.freeze();
+	seq = shipper->position();     // Every record before this one is in the copy, none after it
+	pid_t child = fork();          // The child leans on glibc's fork as checkpoint's does (see there)
+	if (child == 0) {              // The child only reads its frozen copy
+		FILE* f = fdopen(fd, "w");
+		if (!f) _exit(1);
+		dumpState(f, (long long)seq);
+		_exit(fflush(f) == 0 ? 0 : 1);
+	}
+	users.thaw();
+	gate.open();
+	return child;
+}
+
+// Method to make this library a replica of the primary whose replication address is addr: copy
+// its whole state, then apply its changes on a background thread as they stream in. From then on
+// only queries are answered (see handle). Returns false if the primary could not be reached.
+bool LMS::follow(const char* addr) {
+	primary = addr;
+	int fd = dialAddress(addr);
+	if (fd < 0) return false;
+	lineReader in(fd);
+	following = true;              // Sweeps and changes of our own would only diverge from the primary
+	if (!catchUp(fd, in)) {
+		close(fd);
+		following = false;
+		return false;
+	}
+	followFd = fd;
+	follower = thread(&LMS::followLoop, this, in);
+	return true;
+}
+
+// Method to (re)join the primary's stream: say how far this replica got, then load the copy of the
+// state the primary sends a fresh replica, or check that it resumes where we left off. A primary
+// that no longer has what we missed says RESYNC, and primaryEpoch becomes -1 (we give up).
+bool LMS::catchUp(int fd, lineReader& in) {
+	string line, header;
+	long long epoch;               // Run of the primary we reached
+	unsigned long long seq;        // Record it resumes from
+	if (!sendAll(fd, "FOLLOW " + to_string(primaryEpoch) + " " + to_string(applied) + "\n") || !in.next(line) ||
+		sscanf(line.c_str(), "PRIMARY %lld", &epoch) != 1 || !in.next(header)) return false;
+	if (header == "RESYNC") {
+		cerr << "The primary no longer has the changes this replica missed; restart the replica to copy it again" << endl;
+		primaryEpoch = -1;
+		return false;
+	}
+	if (sscanf(header.c_str(), "RESUME %llu", &seq) == 1) {
+		if (seq != applied) return false;
+	}
+	else {                         // A fresh copy of the whole state (only ever sent when we have nothing)
+		bool first = true;         // The header line has been read already
+		long long at = loadState([&](string& l) {
+			if (!first) return in.next(l);
+			l = header;
+			first = false;
+			return true;
+		});
+		if (at < 0) return false;
+		applied = at;
+	}
+	primaryEpoch = epoch;
+	lastHeard = steadySeconds();
+	return true;
+}
+
+// Body of the follower thread: apply each record as it arrives. When the stream breaks, reads are
+// still answered (until they turn stale) while we reconnect every second and resume.
+void LMS::followLoop(lineReader in) {
+	string record;
+	while (true) {
+		while (in.next(record)) {
+			lastHeard = steadySeconds();
+			if (record == "TICK") continue; // Heartbeat: nothing changed
+			gatePass pass(gate);   // recordTo must not see it half applied
+			apply(record);
+			applied++;
+		}
+		int fd = followFd.exchange(-1);
+		if (fd >= 0) close(fd);
+		while (true) {             // Reconnect
+			{
+				unique_lock<mutex> guard(stopLock);
+				if (stopWake.wait_for(guard, chrono::seconds(1), [this] { return stopping; })) return;
+			}
+			fd = dialAddress(primary.c_str());
+			if (fd < 0) continue;  // Primary still down
+			in = lineReader(fd);
+			if (catchUp(fd, in)) {
+				followFd = fd;
+				break;
+			}
+			close(fd);
+			if (primaryEpoch < 0) return; // Told to start over; reads stay stale
+		}
+	}
+}
+
+// Method to list a user's loans and holds (user -1: a name that has never borrowed or reserved)
+void LMS::showAccount(int user, ostream& out) {
+	if (user < 0) {
+		out << "You have 0 of " << MAX_LOANS << " books borrowed and 0 on hold." << '\n';
+		return;
+	}
+	userShard& s = shardOf(user);
+	lock_guard<mutex> guard(s.lock);
+	const userActivity* a = s.activity.get(user); // Everything the user has out or on hold
+	out << "You have " << s.activity.loanCount(user) << " of " << MAX_LOANS << " books borrowed and "
+		<< s.activity.holdCount(user) << " on hold." << '\n';
+	if (!a) return;                // Nothing to list
+
+	out << "Recently borrowed:\t";
+	for (int i = 0; i < s.loans.recentCount(user); i++) { // Newest first
+		if (i) out << ", ";
+		out << byISBN.get(s.loans.recentAt(user, i))->title;
+	}
+	out << '\n';
+
+	for (const pair<const int, int>& loan : a->loans) { // Each borrowed book
+		out << "Borrowed:\t" << byISBN.get(loan.first)->title;
+		if (loan.second > 1) out << " (x" << loan.second << ")";
+		out << '\n';
+	}
+	for (const pair<const int, heldBook>& hold : a->holds) { // Each hold
+		bookInfo* b = byISBN.get(hold.first);
+		out << "On hold:\t" << b->title;
+		if (s.holds.count(userBookKey(user, hold.first))) out << " (ready for pickup)";
+		else {
+			unique_lock<mutex> bookGuard = b->reservationGuard();
+			out << " (" << b->reservations.ahead(hold.second.ticket) << " ahead of you)";
+		}
+		out << '\n';
+	}
+}
+
+// Method to list the most borrowed or most reserved books, adding up every shard's tracker
+void LMS::showPopular(bool borrowed, ostream& out) {
+	unordered_map<int, long long> total; // ISBN -> estimated count across shards
+	int* keys = new int[POPULAR_COUNTERS]; // One shard's ISBNs
+	long long* hits = new long long[POPULAR_COUNTERS]; // Their estimated counts
+	for (userShard& s : shards) {
+		lock_guard<mutex> guard(s.lock);
+		int n = (borrowed ? s.mostBorrowed : s.mostReserved).top(POPULAR_COUNTERS, keys, hits);
+		for (int i = 0; i < n; i++) total[keys[i]] += hits[i];
+	}
+	delete[] keys;
+	delete[] hits;
+
+	vector<pair<long long, int> > ranked; // (count, ISBN), highest first after sorting
+	for (const pair<const int, long long>& e : total) ranked.push_back(make_pair(e.second, e.first));
+	int n = min((int)ranked.size(), POPULAR_SHOWN);
+	partial_sort(ranked.begin(), ranked.begin() + n, ranked.end(), greater<pair<long long, int> >());
+	for (int i = 0; i < n; i++) {
+		out << i + 1 << ".\t" << byISBN.get(ranked[i].second)->title << " (" << ranked[i].first << ")" << '\n';
+	}
+	if (!n) out << "Nothing yet." << '\n';
+}
+
+// Method to let catalog-wide scans split the catalog across a thread pool
+void LMS::useWorkers(workStealingPool* pool) {
+	workers = pool;
+}
+
+// Method to total up the whole catalog. Each range of hash table slots is summed on its own
+// and the partial totals are added together at the end.
+void LMS::showInventory(ostream& out) {
+	mutex merge;                   // Guards the totals below
+	long long titles = 0, copies = 0, outOfStock = 0;
+	double value = 0;
+	function<void(long long, long long)> scan = [&](long long first, long long last) {
+		long long t = 0, c = 0, o = 0; // This range's totals
+		double v = 0;
+		byISBN.forEachIn((int)first, (int)last, [&](bookInfo* b) {
+			int q = b->quantity.load(); // Copies on the shelf right now
+			t++;
+			c += q;
+			if (!q) o++;
+			v += q * b->price;
+		});
+		lock_guard<mutex> guard(merge);
+		titles += t;
+		copies += c;
+		outOfStock += o;
+		value += v;
+	};
+	if (workers) workers->parallelFor(0, byISBN.slots(), 0, scan);
+	else scan(0, byISBN.slots());
+
+	out << "Titles:\t" << titles << '\n';
+	out << "Copies on shelf:\t" << copies << '\n';
+	out << "Out of stock:\t" << outOfStock << '\n';
+	out << "Shelf value:\t" << fixed << setprecision(2) << value << '\n';
+}
+
+// Method to list books whose title starts with p, in title order. Titles with the prefix are
+// contiguous in title order and p itself sorts first among them, so the scan starts at p and
+// stops at the first title without it.
+void LMS::findPrefix(const string& p, ostream& out) {
+	int n = 0;                     // Matches listed
+	byTitle.forEachFrom(p.c_str(), [&](bookInfo* b) {
+		if (strncmp(b->title, p.c_str(), p.size()) != 0) return false; // Past the prefix
+		describe(b, out);
+		return ++n < SEARCH_LIMIT;
+	});
+}
+
+// Method to list books by an author (ignoring case), in title order. There is no author
+// index, so the catalog is scanned, split across the workers when there are any.
+void LMS::findAuthor(const string& name, ostream& out) {
+	mutex merge;                   // Guards found
+	vector<bookInfo*> found;       // Every match
+	function<void(long long, long long)> scan = [&](long long first, long long last) {
+		vector<bookInfo*> mine;    // This range's matches
+		byISBN.forEachIn((int)first, (int)last, [&](bookInfo* b) {
+			if (strcasecmp(b->author, name.c_str()) == 0) mine.push_back(b);
+		});
+		lock_guard<mutex> guard(merge);
+		found.insert(found.end(), mine.begin(), mine.end());
+	};
+	if (workers) workers->parallelFor(0, byISBN.slots(), 0, scan);
+	else scan(0, byISBN.slots());
+
+	sort(found.begin(), found.end(), [](bookInfo* a, bookInfo* b) { return strcmp(a->title, b->title) < 0; });
+	for (size_t i = 0; i < found.size() && i < (size_t)SEARCH_LIMIT; i++) describe(found[i], out);
+}
+
+// Method to list books priced low..high (and, if inStock, with a copy on the shelf), cheapest
+// first; the price index tests a block of books at a time, so only matches are touched
+void LMS::findPriced(double low, double high, bool inStock, ostream& out) {
+	int n = 0;                     // Matches listed
+	byPrice.forEachIn(low, high, inStock, [&](bookInfo* b) {
+		describe(b, out);
+		return ++n < SEARCH_LIMIT;
+	});
+}
+
+// Method to write a book as one tab separated line
+void LMS::describe(bookInfo* b, ostream& out) {
+	out << b->ISBN << '\t' << b->title << '\t' << b->author << '\t' << b->price << '\t' << b->quantity << '\n';
+}
+
+// Method to make the changes answering a query would make on the way (processing deadlines that
+// have passed; queries give no name an id), so that handle then makes none unless the clock ticks
+// over meanwhile. Batch runs call it for a run of queries, in order, before answering them in
+// parallel.
+void LMS::prepare(const char* /*line*/) {
+	if (!following) expireDeadlines(); // As handle does first
+}
+
+// Method to answer one protocol request line (commands are listed in Protocol.h)
+void LMS::handle(const char* line, string& out) {
+	if (following) {               // Replica: the primary makes every change, expiries included
+		if (!isQuery(line)) {
+			out += "ERR read-only replica\n";
+			return;
+		}
+		if (steadySeconds() - lastHeard > REPLICA_MAX_LAG_SECONDS) {
+			out += "ERR replica stale\n"; // Lost the primary too long ago to vouch for the answer
+			return;
+		}
+	}
+	else expireDeadlines();        // Bring holds and due dates up to date first
+
+	stringstream in(line);         // Split the request into words
+	ostringstream res;             // Response being built
+	string cmd, rest;
+	int ISBN = 0;
+	bool badISBN = false;          // The request needs an ISBN and has none that parses
+	int user = -1;                 // User the request is for (-1 if none given)
+	in >> cmd;
+	for (char& c : cmd) c = toupper(c); // Commands are case insensitive
+
+	bookInfo* b = nullptr;         // Book the request is about
+	AVL::range editions;           // Every book with the title (FIND)
+	if (cmd == "FIND") {           // Title lookup (the whole rest of the line)
+		getline(in >> ws, rest);
+		editions = lookUpTitle(&rest[0]);
+		if (!editions.empty()) b = editions[0];
+	}
+	else if (cmd == "ISBN" || cmd == "BORROW" || cmd == "RETURN" || cmd == "RESERVE") { // ISBN first
+		if (!(in >> ISBN)) badISBN = true;
+		else {
+			getline(in >> ws, rest); // The user name, for commands that take one
+			b = lookUpISBN(ISBN);
+		}
+	}
+	else if (cmd == "ACCOUNT") getline(in >> ws, rest);
+	bool takesUser = cmd == "BORROW" || cmd == "RETURN" || cmd == "RESERVE" || cmd == "ACCOUNT";
+	bool named = takesUser && !badISBN && !rest.empty(); // A user name was given
+	if (named) {                   // Names are kept for good, so only a borrow or reservation of a real book adds one
+		bool adds = (cmd == "BORROW" || cmd == "RESERVE") && b;
+		user = adds ? users.intern(rest.c_str()) : users.find(rest.c_str()); // -1: nobody by that name has done anything
+	}
+	if (recorder) {                // Keep the request for replay
+		const char* ops[] = { "FIND", "ISBN", "BORROW", "RETURN", "RESERVE", "ACCOUNT" };
+		int op = find(ops, ops + WORK_LINE, cmd) - ops; // WORK_LINE if none of them
+		if (named && user < 0) op = WORK_LINE; // A name without an id is kept in the whole line
+		recorder->record(op, ISBN, op == WORK_LINE ? string(line) : rest, user, rest.c_str());
+	}
+
+	if (badISBN) res << "ERR bad ISBN\n";
+	else if (cmd == "FIND" || cmd == "ISBN") {
+		if (!b) res << "ERR not found\n";
+		else {
+			res << "OK\n";
+			if (cmd == "ISBN") describe(b, res);
+			for (bookInfo* e : editions) describe(e, res); // FIND lists them all
+		}
+	}
+	else if (takesUser && !named) {
+		res << "ERR missing user\n";
+	}
+	else if (cmd == "BORROW") {
+		if (!b) res << "ERR not found\n";
+		else {
+			switch (borrow(user, b)) {
+			case BORROWED: res << "OK borrowed; " << b->quantity.load() << " left\n"; break;
+			case PICKED_UP: res << "OK picked up hold\n"; break;
+			case UNAVAILABLE: res << "ERR unavailable\n"; break;
+			case AT_LIMIT: res << "ERR loan limit reached\n"; break;
+			}
+		}
+	}
+	else if (cmd == "RETURN") {
+		if (user >= 0 && giveBack(user, ISBN)) res << "OK returned\n";
+		else res << "ERR not borrowed\n";
+	}
+	else if (cmd == "RESERVE") {
+		if (!b) res << "ERR not found\n";
+		else {
+			int ahead = reserve(user, b);
+			if (ahead == IN_STOCK) res << "ERR in stock\n"; // Just borrow it
+			else if (ahead == ALREADY_RESERVED) res << "ERR already reserved\n"; // One place in line per user
+			else res << "OK reserved; " << ahead << " ahead\n";
+		}
+	}
+	else if (cmd == "ACCOUNT") {
+		res << "OK\n";
+		showAccount(user, res);
+	}
+	else if (cmd == "POPULAR") {
+		res << "OK\nMost borrowed:\n";
+		showPopular(true, res);
+		res << "Most reserved:\n";
+		showPopular(false, res);
+	}
+	else if (cmd == "PREFIX" || cmd == "AUTHOR") {
+		getline(in >> ws, rest);
+		res << "OK\n";
+		if (cmd == "PREFIX") findPrefix(rest, res);
+		else findAuthor(rest, res);
+	}
+	else if (cmd == "PRICE") {
+		double low, high;
+		if (!(in >> low >> high)) res << "ERR missing price range\n";
+		else {
+			in >> rest;            // INSTOCK, if given
+			res << "OK\n";
+			findPriced(low, high, strcasecmp(rest.c_str(), "INSTOCK") == 0, res);
+		}
+	}
+	else if (cmd == "INVENTORY") {
+		res << "OK\n";
+		showInventory(res);
+	}
+	else if (cmd == "STATS") {
+		in >> rest;
+		vector<unsigned long long> total[STAT_OPS]; // Every thread's histograms added up
+		opLatency.merged(total);
+		res << "OK\n";
+		if (strcasecmp(rest.c_str(), "RAW") == 0) latencyStats::dump(total, res); // For a router to merge
+		else latencyStats::report(total, res);
+	}
+	else if (cmd == "TRACE") {
+		long long n = dumpTrace();
+		if (is_same<libraryTrace, noTrace>::value) res << "ERR tracing not built in (build with -DLMS_TRACE)\n";
+		else if (tracePath.empty()) res << "ERR no trace file (start with --trace <file>)\n";
+		else if (n < 0) res << "ERR could not write " << tracePath << "\n";
+		else res << "OK " << n << " events written\n";
+	}
+	else res << "ERR unknown command\n";
+
+	out += res.str();              // Hand back the response
 }
 
 // Method to handle the user interface for borrowing/returning books
@@ -93,13 +1196,24 @@ void LMS::interface() {
 
 	cout << "Enter your username, email address, or name: ";	//Prompt for input
 	cin.getline(name, 20);         // Get the user's name
+	int user = users.intern(name); // Look up (or assign) the user's id
+	notices = &cout;               // Show hold and overdue notices on screen
 
-	cout << "Would you like to a) borrow a book, b) return a book, c) or quit? <a/b/c>: ";	//Prompt for input
+	cout << "Would you like to a) borrow a book, b) return a book, c) quit, d) view your account, or e) see popular books? <a/b/c/d/e>: ";	//Prompt for input
 	cin >> choice;	//Input the user's choice
 	cin.ignore(); // Flush the newline after 'choice' input
 
-	while (choice == 'a' || choice == 'b') {	//While the user is borrowing or returning
-		if (choice == 'a') {	//If they are borrowing
+	while (choice == 'a' || choice == 'b' || choice == 'd' || choice == 'e') {	//While the user is borrowing, returning, or browsing
+		if (choice == 'd') {	//If they want to see their account
+			showAccount(user, cout);	//List their loans and holds
+		}
+		else if (choice == 'e') {	//If they want to see what's popular
+			cout << "Most borrowed:" << '\n';
+			showPopular(true, cout);
+			cout << "Most reserved:" << '\n';
+			showPopular(false, cout);
+		}
+		else if (choice == 'a') {	//If they are borrowing
 			cout << "Query by: a) Title b) ISBN <a/b>: ";	//Prompt for querry type
 			cin >> choice;	//Input choice
 			cin.ignore(); // Flush newline after choice input
@@ -107,62 +1221,84 @@ void LMS::interface() {
 			if (choice == 'a') {	//If they search by title
 				cout << "What is the title? ";	//Prompt for title
 				cin.getline(title, 50); // Read the title
-				cout << "Performing Binary Search ..." << endl;	//Alert the user
-				toReserve = byTitle.retrieve(title);	//Search for & store book information
+				cout << "Performing Binary Search ..." << '\n';	//Alert the user
+				toReserve = nullptr;
+				for (bookInfo* e : lookUpTitle(title)) {	//Search for & store book information (an edition on the shelf if there is one)
+					if (!toReserve || (toReserve->quantity <= 0 && e->quantity > 0)) toReserve = e;
+				}
 			}
 			else {	//If they search by ISBN
 				cout << "What is the ISBN? ";	//Prompt for ISBN
 				cin >> ISBN;	//Read the ISBN
-				cout << "Performing hash on ISBN ..." << endl;	//Alert the user
-				toReserve = byISBN.get(ISBN);	//Search for & store book information
+				cout << "Performing hash on ISBN ..." << '\n';	//Alert the user
+				toReserve = lookUpISBN(ISBN);	//Search for & store book information
 				cin.ignore(); // Flush newline after ISBN input
 			}
 
 			if (toReserve) {	//If the book is found
-				if (toReserve->quantity != 0) {	//If the book is in stock
-					borrowed.push(toReserve);	//Borrow the book
-					toReserve->quantity--;	//Decrease the number of available copies
+				borrowResult result = borrow(user, toReserve);	//Try to borrow it
+				if (result == AT_LIMIT) {	//If they are at their limit
+					cout << "You already have " << MAX_LOANS << " books borrowed. Return one first." << '\n';	//Alert the user
+				}
+				else if (result == PICKED_UP) {	//If a copy was being held for them
+					cout << "Picked up the copy of " << toReserve->title << " held for you." << '\n';	//Alert the user
+				}
+				else if (result == BORROWED) {	//If the book was in stock
 					cout << "Successfully reserved. We have " << toReserve->quantity	//Alert the user
-						<< " copies of " << toReserve->title << " left." << endl;
+						<< " copies of " << toReserve->title << " left." << '\n';
 				}
 				else {	//If the book is out of stock
-					cout << "All copies of " << toReserve->title << " taken." << endl;	//Alert the user
-					toReserve->reservations.enqueue(name);	//Queue the user's reservation
-					cout << "You have reserved this book. There are " << toReserve->reservations.length() - 1	//Alert the user
-						<< " reservations in front of you." << endl;
-					cout << "The current list of people who have reserved this book is: ";	//Display the current reservations
-					toReserve->reservations.displayAll();
+					cout << "All copies of " << toReserve->title << " taken." << '\n';	//Alert the user
+					int ahead = reserve(user, toReserve);	//Queue the user's reservation
+					if (ahead == ALREADY_RESERVED) {	//If they are already in line
+						cout << "You have already reserved this book." << '\n';	//Alert the user
+					}
+					else if (ahead == IN_STOCK) {	//If a copy came back meanwhile
+						cout << "A copy was just returned. Try borrowing it again." << '\n';	//Alert the user
+					}
+					else {
+						cout << "You have reserved this book. There are " << ahead	//Alert the user
+							<< " reservations in front of you." << '\n';
+						cout << "The current list of people who have reserved this book is: ";	//Display the current reservations
+						unique_lock<mutex> guard = toReserve->reservationGuard();	//Other terminals may be changing the queue
+						toReserve->reservations.displayAll(users);
+					}
 				}
 			}
 			else {	//If the book is not found
-				cout << "Could not find book. Try again." << endl;	//Alert the user
+				cout << "Could not find book. Try again." << '\n';	//Alert the user
 			}
 		}
 		else {	//If returning a book
-			if (!borrowed.peep()) {	//If they haven't borrowed a book
-				cout << "No books borrowed." << endl;	//Alert the user
+			bookInfo* returned = nullptr;	//Book being returned
+			if (!loanCount(user)) {	//If they haven't borrowed a book
+				cout << "No books borrowed." << '\n';	//Alert the user
 			}
-			else {	//Otherwise
-				cout << "Returning " << borrowed.peep()->title << endl;	//Alert the user of return
-				borrowed.peep()->quantity++;	//Increase the number of available copies
-
-				while (!borrowed.peep()->reservations.isEmpty() && borrowed.peep()->quantity > 0) {	//While there is a reservation & an available copy
-					if (strcmp(borrowed.peep()->reservations.dequeue(), name) == 0) {	//If the current user borrowed it
-						cout << "Your reservation for " << borrowed.peep()->title	//Ask if they want the book
-							<< " is available. Would you like to a) retrieve or b) forfeit? <a/b>: ";
-						cin >> choice;	//Input choice
-						cin.ignore(); // Flush newline after choice input
-						if (choice == 'a') {	//If they want it
-							borrowed.peep()->quantity--;	//Decrease available copies
-							borrowed.push(borrowed.pop());	//Borrow book (Note: this will actually be returned in a line & they will keep their previous copy)
-						}
-					}
+			else {	//Otherwise ask which one
+				cout << "What is the ISBN? (0 for your most recent) ";	//Prompt for ISBN
+				cin >> ISBN;	//Read the ISBN
+				cin.ignore(); // Flush newline after ISBN input
+				if (ISBN == 0) ISBN = newestLoan(user);	//Find their newest borrow still out
+				returned = giveBack(user, ISBN);	//End that loan and pass the copy along
+				if (!returned) cout << "You have not borrowed that book." << '\n';	//Alert the user
+			}
+			if (returned) {	//If a copy came back
+				cout << "Returned " << returned->title << '\n';	//Alert the user of return
+
+				while (hasHold(user, returned->ISBN)) {	//While the copy is being held for the current user
+					cout << "Your reservation for " << returned->title	//Ask if they want the book
+						<< " is available. Would you like to a) retrieve or b) forfeit? <a/b>: ";
+					cin >> choice;	//Input choice
+					cin.ignore(); // Flush newline after choice input
+					if (choice == 'a') pickUp(user, returned);	//If they want it, borrow it
+					else forfeit(user, returned);	//Otherwise pass it to the next person
 				}
-				borrowed.pop(); // Remove the returned book from the borrowed stack
 			}
 		}
 
-		cout << "Would you like to a) borrow a book, b) return a book, c) or quit? <a/b/c>: ";	//Prompt again
+		expireDeadlines();	//Pass along holds nobody picked up in time
+		sync();	//Make sure what they just did survives a crash
+		cout << "Would you like to a) borrow a book, b) return a book, c) quit, d) view your account, or e) see popular books? <a/b/c/d/e>: ";	//Prompt again
 		cin >> choice;	//Input choice
 		cin.ignore(); // Flush newline after choice input
 	}
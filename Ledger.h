@@ -0,0 +1,117 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include "Users.h"
+#include "TimerWheel.h"
+using namespace std;
+
+const int RECENT_LOANS = 10;          // How many recent borrows are remembered per user
+
+// One user's loans of one book
+struct loanRecord {
+	bookInfo* book;                   // Book that is borrowed
+	vector<timerNode*> due;           // Due date timer per copy, oldest first (nullptr once fired)
+};
+
+// Fixed-size ring of a user's most recent borrows (ISBNs, newest last)
+struct recentRing {
+	int ISBNs[RECENT_LOANS];          // Ring storage
+	int next;                         // Slot the next borrow goes into
+	int count;                        // Number of slots in use
+
+	recentRing() : next(0), count(0) {} // Constructor with no history
+};
+
+// Ledger of every active loan, keyed by (user, ISBN)
+class loanLedger {
+private:
+	unordered_map<uint64_t, loanRecord> loans; // (user, ISBN) -> that user's copies of that book
+	unordered_map<int, recentRing> recent; // Recent borrows per user id
+
+public:
+	void checkout(int user, bookInfo* b, timerNode* due); // Method to record a new loan of one copy
+	void restore(int user, bookInfo* b, timerNode* due); // Method to record a loan without counting it as a recent borrow
+	void remember(int user, int ISBN);  // Method to add a borrow to a user's recent history
+	bool checkin(int user, int ISBN, bookInfo*& b, timerNode*& due); // Method to end a loan of one copy
+	void dueFired(int user, int ISBN, timerNode* t); // Method to forget a due date timer that has fired
+	bool has(int user, int ISBN);     // Method to check whether a user has a book out
+	int recentCount(int user);        // Method to get how many recent borrows are remembered
+	int recentAt(int user, int i);    // Method to get the i-th most recent borrow (0 = newest)
+	void forEachLoan(const function<void(int, bookInfo*, timerNode*)>& visit); // Method to visit every copy out (oldest first per book)
+	void forEachRecent(const function<void(int, int)>& visit); // Method to visit every remembered borrow (oldest first per user)
+};
+
+// Method to record a new loan of one copy of a book
+void loanLedger::checkout(int user, bookInfo* b, timerNode* due) {
+	restore(user, b, due);
+	remember(user, b->ISBN);
+}
+
+// Method to record a loan of one copy without adding it to the user's recent history
+void loanLedger::restore(int user, bookInfo* b, timerNode* due) {
+	loanRecord& rec = loans[userBookKey(user, b->ISBN)]; // Find or create the record
+	rec.book = b;
+	rec.due.push_back(due);           // One more copy out, due at this time
+}
+
+// Method to add a borrow to a user's recent history
+void loanLedger::remember(int user, int ISBN) {
+	recentRing& r = recent[user];     // Find or create the user's history
+	r.ISBNs[r.next] = ISBN;           // Overwrite the oldest entry once the ring is full
+	r.next = (r.next + 1) % RECENT_LOANS;
+	if (r.count < RECENT_LOANS) r.count++;
+}
+
+// Method to end the loan of one copy; returns false if the user does not have the book.
+// On success b is the book and due is the copy's due date timer (nullptr if it already fired).
+bool loanLedger::checkin(int user, int ISBN, bookInfo*& b, timerNode*& due) {
+	unordered_map<uint64_t, loanRecord>::iterator it = loans.find(userBookKey(user, ISBN));
+	if (it == loans.end()) return false; // No such loan
+
+	b = it->second.book;
+	due = it->second.due.front();     // Return the copy that has been out longest
+	it->second.due.erase(it->second.due.begin());
+	if (it->second.due.empty()) loans.erase(it); // Last copy back
+	return true;
+}
+
+// Method to forget a due date timer that has fired (the copy is still out, just overdue)
+void loanLedger::dueFired(int user, int ISBN, timerNode* t) {
+	unordered_map<uint64_t, loanRecord>::iterator it = loans.find(userBookKey(user, ISBN));
+	if (it == loans.end()) return;
+	for (timerNode*& d : it->second.due) {
+		if (d == t) { d = nullptr; break; } // The caller frees the timer
+	}
+}
+
+// Method to check whether a user has a book out
+bool loanLedger::has(int user, int ISBN) {
+	return loans.count(userBookKey(user, ISBN)) != 0;
+}
+
+// Method to return how many recent borrows are remembered for a user
+int loanLedger::recentCount(int user) {
+	unordered_map<int, recentRing>::iterator it = recent.find(user);
+	return it == recent.end() ? 0 : it->second.count;
+}
+
+// Method to return the i-th most recent borrow of a user (0 = newest)
+int loanLedger::recentAt(int user, int i) {
+	recentRing& r = recent[user];
+	return r.ISBNs[(r.next - 1 - i + 2 * RECENT_LOANS) % RECENT_LOANS]; // Step back from the newest
+}
+
+// Method to visit every copy out as (user, book, due date timer), oldest copy first for each book
+void loanLedger::forEachLoan(const function<void(int, bookInfo*, timerNode*)>& visit) {
+	for (pair<const uint64_t, loanRecord>& l : loans) {
+		for (timerNode* due : l.second.due) visit((int)(l.first >> 32), l.second.book, due); // User is the key's high half
+	}
+}
+
+// Method to visit every remembered borrow as (user, ISBN), oldest first for each user
+void loanLedger::forEachRecent(const function<void(int, int)>& visit) {
+	for (pair<const int, recentRing>& r : recent) {
+		for (int i = r.second.count - 1; i >= 0; i--) visit(r.first, recentAt(r.first, i));
+	}
+}
@@ -1,84 +1,100 @@
 #pragma once
-#include "bookInfo.h"
+#include <functional>
+#include "Policies.h"
+#include "Trace.h"
 
 // Node structure for a sorted linked list
-struct lNode {
-	lNode* next;                    // Pointer to the next node
-	bookInfo* val;                  // Pointer to the value (book information)
+template <class key, class value>
+struct listNode {
+	listNode* next;                 // Pointer to the next node
+	key k;                          // Key of the value, kept here so a walk never touches the values
+	value val;                      // The value (book information)
 
-	lNode(bookInfo* v) : val(v), next(nullptr) {} // Constructor to initialize node
+	listNode(const key& k, const value& v) : next(nullptr), k(k), val(v) {} // Constructor to initialize node
 };
 
-// Class definition for a sorted list (by ISBN)
-class sortedList {
+// Class definition for a sorted singly linked list (by key); see Policies.h for the parameters.
+// It takes its nodes from a base class rather than a member, so an empty allocator adds nothing
+// and a hash table slot stays one pointer plus its key summary.
+template <class key, class value, class keyOf, class compare = threeWay<key>, class trace = noTrace, class alloc = allocator<value>>
+class basicSortedList : private nodeAllocator<listNode<key, value>, alloc> {
 private:
+	typedef listNode<key, value> lNode; // This list's nodes
+
 	lNode* head;                    // Pointer to the head of the list
 
 public:
-	sortedList();                   // Constructor
-	~sortedList();                  // Destructor
-	void insert(bookInfo* v);        // Method to insert book information
-	bookInfo* get(int ISBN);         // Method to retrieve a book by ISBN
-	void remove(int ISBN);           // Method to remove a book by ISBN
+	basicSortedList();              // Constructor
+	~basicSortedList();             // Destructor
+	void insert(const value& v);    // Method to insert a value
+	value get(const key& k);        // Method to retrieve a value by key (value() if absent)
+	bool remove(const key& k);      // Method to remove a value by key, false if it was not there
+	void forEach(const function<void(const value&)>& visit); // Method to visit every value in key order
 };
 
 // Constructor definition for the sorted list
-sortedList::sortedList() {
+template <class key, class value, class keyOf, class compare, class trace, class alloc>
+basicSortedList<key, value, keyOf, compare, trace, alloc>::basicSortedList() {
 	head = nullptr;                 // Initialize the head to null
 }
 
 // Destructor to clean up memory for the sorted list
-sortedList::~sortedList() {
+template <class key, class value, class keyOf, class compare, class trace, class alloc>
+basicSortedList<key, value, keyOf, compare, trace, alloc>::~basicSortedList() {
 	lNode* temp;                    // Temporary pointer for deletion
 	while (head) {                  // While the list is not empty
 		temp = head->next;          // Move temp to the next node
-		delete head;                // Delete the current head
+		this->free(head);           // Delete the current head
 		head = temp;                // Move head to the next node
 	}
 }
 
-// Insert method to add a book into the sorted list
-void sortedList::insert(bookInfo* v) {
-	lNode* newNode = new lNode(v);  // Dynamically allocate a new lNode
-
-	if (!head || head->val->ISBN > v->ISBN) {  // If the list is empty or the new book should be the first
-		newNode->next = head;       // Set the new node's next to the current head
-		head = newNode;             // Update the head to the new node
-	}
-	else {                         // Otherwise, find the correct position for insertion
-		lNode* current = head;      // Start from the head
-		lNode* next = head->next;   // Get the next node
-		while (next && next->val->ISBN < v->ISBN) { // Traverse the list until the correct spot
-			current = next;         // Move current to the next node
-			next = current->next;   // Move next forward
-		}
-		current->next = newNode;    // Insert the new node at the correct position
-		newNode->next = next;       // Link the new node to the rest of the list
+// Insert method to add a value into the sorted list
+template <class key, class value, class keyOf, class compare, class trace, class alloc>
+void basicSortedList<key, value, keyOf, compare, trace, alloc>::insert(const value& v) {
+	lNode* newNode = this->make(keyOf::of(v), v); // Allocate a new lNode
+	lNode** link = &head;           // Link the new node will go in
+	while (*link && compare::compare((*link)->k, newNode->k) < 0) { // Traverse the list until the correct spot
+		trace::step();
+		link = &(*link)->next;      // Move on to the next node's link
 	}
+	newNode->next = *link;          // Link the new node to the rest of the list
+	*link = newNode;                // Insert the new node at the correct position
 }
 
-// Method to retrieve a book by its ISBN
-bookInfo* sortedList::get(int ISBN) {
+// Method to retrieve a value by its key
+template <class key, class value, class keyOf, class compare, class trace, class alloc>
+value basicSortedList<key, value, keyOf, compare, trace, alloc>::get(const key& k) {
 	lNode* current = head;          // Start from the head of the list
-	while (current && current->val->ISBN < ISBN) current = current->next; // Traverse the list
-	if (!current) return nullptr;   // If no book is found, return null
-	if (current->val->ISBN != ISBN) return nullptr; // If ISBN doesn't match, return null
-	return current->val;            // Return the book info if found
+	while (current && compare::compare(current->k, k) < 0) { // Traverse the list
+		trace::step();
+		current = current->next;
+	}
+	if (!current || compare::compare(current->k, k) != 0) return value(); // Not in the list
+	return current->val;            // Return the value if found
 }
 
-// Method to remove a book by its ISBN
-void sortedList::remove(int ISBN) {
-	if (head && head->val->ISBN <= ISBN) { // If the list is not empty and the head's ISBN is valid
-		lNode* prev = head;         // Previous node pointer starts at the head
-		lNode* current = head->next; // Current node pointer starts at the next node
-		while (current && current->val->ISBN < ISBN) { // Traverse the list
-			prev = current;         // Move prev to the next node
-			current = prev->next;   // Move current forward
-		}
-		if (current && current->val->ISBN == ISBN) { // If the book is found
-			current = current->next; // Move current to the next node
-			delete prev->next;       // Delete the current node
-			prev->next = current->next; // Link the previous node to the next one
-		}
+// Method to remove a value by its key
+template <class key, class value, class keyOf, class compare, class trace, class alloc>
+bool basicSortedList<key, value, keyOf, compare, trace, alloc>::remove(const key& k) {
+	lNode** link = &head;           // Link pointing at the node being looked at
+	while (*link && compare::compare((*link)->k, k) < 0) { // Traverse the list
+		trace::step();
+		link = &(*link)->next;      // Move on to the next node's link
 	}
+	if (*link && compare::compare((*link)->k, k) == 0) { // If the value is found
+		lNode* found = *link;       // Node to delete
+		*link = found->next;        // Link the previous node (or the head) past it
+		this->free(found);          // Delete the node (the value belongs to the caller)
+		return true;
+	}
+	return false;                   // Not in the list
+}
+
+// Method to visit every value in the list in key order
+template <class key, class value, class keyOf, class compare, class trace, class alloc>
+void basicSortedList<key, value, keyOf, compare, trace, alloc>::forEach(const function<void(const value&)>& visit) {
+	for (lNode* current = head; current; current = current->next) visit(current->val);
 }
+
+typedef basicSortedList<int, bookInfo*, isbnOf, threeWay<int>, libraryTrace> sortedList; // Sorted list as the library builds it
@@ -0,0 +1,79 @@
+#pragma once
+#include <memory>
+#include <cstring>
+#include <cstdint>
+#include <utility>
+#include "bookInfo.h"
+using namespace std;
+
+/*
+Policies the containers are templates over. sortedList, hashTable and AVL take
+	key                         What they order and look up by (stored in every node)
+	value                       What they hold (the library stores bookInfo*)
+	keyOf                       Extractor: static key of(const value&)
+	compare                     Comparator: static int compare(const key&, const key&), <0, 0 or >0 like strcmp
+	trace                       Probe policy (Trace.h)
+	alloc                       Standard allocator their nodes are taken from (rebound to the node type)
+Every policy is a class with static inline methods, so a descent compiles to the comparison
+itself: an integer compare for ISBNs, one 64-bit compare for most titles.
+*/
+
+// Comparator for anything with < and >, such as ISBNs, prices and user ids
+template <class T>
+struct threeWay {
+	static int compare(const T& a, const T& b) { return (a > b) - (a < b); }
+};
+
+// Comparator for C strings
+struct cStringOrder {
+	static int compare(const char* a, const char* b) { return strcmp(a, b); }
+};
+
+// A title with its first 8 bytes packed big endian (zero padded), so most comparisons are one
+// integer compare and never touch the string; orders exactly as strcmp does
+struct titlePrefix {
+	uint64_t prefix;              // First 8 bytes, first byte most significant
+	const char* s;                // Whole title
+
+	titlePrefix(const char* t) : prefix(0), s(t) { // Constructor that packs the prefix (stops at the end of t)
+		for (int i = 0; i < 8 && t[i]; i++) prefix |= (uint64_t)(unsigned char)t[i] << (56 - 8 * i);
+	}
+};
+
+// Comparator for titlePrefix keys
+struct prefixOrder {
+	static int compare(const titlePrefix& a, const titlePrefix& b) {
+		if (a.prefix != b.prefix) return a.prefix < b.prefix ? -1 : 1;
+		if ((a.prefix & 0xff) == 0) return 0; // Both end within the prefix, so they are equal
+		return strcmp(a.s + 8, b.s + 8);      // Same first 8 bytes, none of them the end
+	}
+};
+
+// Key extractor for books by ISBN
+struct isbnOf {
+	static int of(const bookInfo* b) { return b->ISBN; }
+};
+
+// Key extractor for books by title
+struct titleOf {
+	static titlePrefix of(const bookInfo* b) { return titlePrefix(b->title); }
+};
+
+// Helper for taking a container's nodes from its allocator (rebound to the node type); it is the
+// allocator, so an empty one takes no space in a container that derives from it
+template <class node, class alloc>
+struct nodeAllocator : allocator_traits<alloc>::template rebind_alloc<node> {
+	typedef typename allocator_traits<alloc>::template rebind_alloc<node> type; // Allocator for nodes
+	typedef allocator_traits<type> traits;
+
+	template <class... args>
+	node* make(args&&... a) {     // Method to allocate and construct a node
+		node* n = traits::allocate(*this, 1);
+		traits::construct(*this, n, forward<args>(a)...);
+		return n;
+	}
+	void free(node* n) {          // Method to destroy and release a node
+		traits::destroy(*this, n);
+		traits::deallocate(*this, n, 1);
+	}
+};
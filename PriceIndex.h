@@ -0,0 +1,172 @@
+#pragma once
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <functional>
+#include <cstdint>
+#include <cmath>
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+#include "bookInfo.h"
+using namespace std;
+
+/*
+Books by price, for "in stock between $20 and $40" searches. The index is the leaf level of a
+B+-tree: blocks of up to PRICE_BLOCK books in price order, each laid out as arrays (prices in
+whole cents, copies on the shelf, books), with a sorted array of every block's lowest price above
+them. A search binary searches that array (one int per block, so it stays in cache) for its first
+block, then tests a whole block per step: the price range and the in-stock check are SIMD
+compares over the block's arrays, giving a bit mask of the books that match, and only those
+books are touched.
+Copies on the shelf are mirrored in the blocks, because reading quantity through each book's
+pointer is the pointer chase the index is there to avoid. bookInfo::stockMirror points at a
+book's mirror, and takeCopy, putCopy, addCopies and setQuantity change both. The mirror is only
+eventually consistent: it is changed just after quantity, not in the same atomic step (a lock
+there would cost every borrow), so while a change is in flight an INSTOCK search can list a book
+whose last copy was just taken, or miss one that was just returned. Changes only add, subtract
+or set, so the mirror equals quantity again as soon as no change is in flight; whoever acts on
+a search result goes through takeCopy, which checks quantity itself.
+Books are added while the catalog loads (inserting moves mirrors, so it must not race with
+borrowing) and never removed; the index must outlive any borrowing of its books.
+*/
+
+const int PRICE_BLOCK = 64;          // Books per block (one bit each in a match mask)
+const long long PRICE_MAX_CENTS = 1000000000; // Prices are clamped to +/- this many cents
+
+// One block of the index: PRICE_BLOCK books in price order
+struct alignas(64) priceBlock {
+	int cents[PRICE_BLOCK];          // Prices in cents, ascending (first count are used)
+	atomic<int> stock[PRICE_BLOCK];  // Copies on the shelf (mirrors of the books' quantity)
+	bookInfo* books[PRICE_BLOCK];    // The books
+	int count;                       // Slots in use
+
+	priceBlock() : count(0) {}       // Constructor for an empty block
+	void put(int at, int c, bookInfo* b); // Method to fill a slot with a book
+	void move(int from, priceBlock* to, int at); // Method to move a slot (to another block, or along this one)
+	uint64_t match(int low, int high, bool inStock); // Method to find the slots in a price range (and in stock)
+};
+
+// Index of books by price; see above
+class priceIndex {
+private:
+	vector<priceBlock*> blocks;      // Blocks in price order
+	vector<int> lowest;              // Lowest price in each block (what a search starts with)
+
+	static int centsOf(double dollars); // Method to convert a price to whole cents
+	size_t blockFor(int c);          // Method to pick the block a price goes in
+	void split(size_t i);            // Method to split a full block in two
+
+public:
+	~priceIndex();                   // Destructor to free the blocks
+	void insert(bookInfo* b);        // Method to add a book (catalog loading only)
+	void forEachIn(double low, double high, bool inStock, const function<bool(bookInfo*)>& visit); // Method to visit books priced low..high in price order until visit returns false
+};
+
+// Method to fill a slot with a book and point the book at its mirror
+void priceBlock::put(int at, int c, bookInfo* b) {
+	cents[at] = c;
+	stock[at].store(b->quantity.load(), memory_order_relaxed);
+	books[at] = b;
+	b->stockMirror = &stock[at];
+}
+
+// Method to move a slot's book to slot at of block to (which may be this one)
+void priceBlock::move(int from, priceBlock* to, int at) {
+	to->cents[at] = cents[from];
+	to->stock[at].store(stock[from].load(memory_order_relaxed), memory_order_relaxed);
+	to->books[at] = books[from];
+	to->books[at]->stockMirror = &to->stock[at];
+}
+
+// Method to find the slots priced low..high cents (and, if inStock, with a copy on the shelf);
+// bit j of the result is slot j. Every slot is tested, with no branches, several at a time.
+uint64_t priceBlock::match(int low, int high, bool inStock) {
+	alignas(64) int shelf[PRICE_BLOCK]; // Stock as of now (read one by one: they are atomics)
+	for (int j = 0; j < PRICE_BLOCK; j++) shelf[j] = stock[j].load(memory_order_relaxed);
+	int minStock = inStock ? 0 : INT32_MIN; // Stock must be above this
+	uint64_t m = 0;
+#if defined(__AVX2__)
+	__m256i lo = _mm256_set1_epi32(low - 1), hi = _mm256_set1_epi32(high + 1), least = _mm256_set1_epi32(minStock);
+	for (int j = 0; j < PRICE_BLOCK; j += 8) {
+		__m256i c = _mm256_load_si256((const __m256i*)(cents + j));
+		__m256i s = _mm256_load_si256((const __m256i*)(shelf + j));
+		__m256i in = _mm256_and_si256(_mm256_and_si256(_mm256_cmpgt_epi32(c, lo), _mm256_cmpgt_epi32(hi, c)), _mm256_cmpgt_epi32(s, least));
+		m |= (uint64_t)_mm256_movemask_ps(_mm256_castsi256_ps(in)) << j;
+	}
+#elif defined(__SSE2__)
+	__m128i lo = _mm_set1_epi32(low - 1), hi = _mm_set1_epi32(high + 1), least = _mm_set1_epi32(minStock);
+	for (int j = 0; j < PRICE_BLOCK; j += 4) {
+		__m128i c = _mm_load_si128((const __m128i*)(cents + j));
+		__m128i s = _mm_load_si128((const __m128i*)(shelf + j));
+		__m128i in = _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi32(c, lo), _mm_cmplt_epi32(c, hi)), _mm_cmpgt_epi32(s, least));
+		m |= (uint64_t)_mm_movemask_ps(_mm_castsi128_ps(in)) << j;
+	}
+#else
+	for (int j = 0; j < PRICE_BLOCK; j++) m |= (uint64_t)((cents[j] >= low) & (cents[j] <= high) & (shelf[j] > minStock)) << j;
+#endif
+	return count == PRICE_BLOCK ? m : m & ((1ULL << count) - 1); // Unused slots never match
+}
+
+// Destructor to free the blocks (the books belong to the caller)
+priceIndex::~priceIndex() {
+	for (priceBlock* p : blocks) delete p;
+}
+
+// Method to convert a price to whole cents, clamped so a range end can be widened by a cent
+int priceIndex::centsOf(double dollars) {
+	return (int)llround(max(-(double)PRICE_MAX_CENTS, min((double)PRICE_MAX_CENTS, dollars * 100)));
+}
+
+// Method to pick the block a price goes in: the last whose lowest price is not above it
+size_t priceIndex::blockFor(int c) {
+	size_t i = upper_bound(lowest.begin(), lowest.end(), c) - lowest.begin();
+	return i ? i - 1 : 0;
+}
+
+// Method to split a full block, moving its upper half to a new block after it
+void priceIndex::split(size_t i) {
+	priceBlock* p = blocks[i];
+	priceBlock* q = new priceBlock;
+	int half = p->count / 2;
+	for (int j = half; j < p->count; j++) p->move(j, q, j - half);
+	q->count = p->count - half;
+	p->count = half;
+	blocks.insert(blocks.begin() + i + 1, q);
+	lowest.insert(lowest.begin() + i + 1, q->cents[0]);
+}
+
+// Method to add a book; books with the same price stay in the order they were added
+void priceIndex::insert(bookInfo* b) {
+	int c = centsOf(b->price);
+	if (blocks.empty()) {
+		blocks.push_back(new priceBlock);
+		lowest.push_back(c);
+	}
+	size_t i = blockFor(c);
+	if (blocks[i]->count == PRICE_BLOCK) { // Full: split it, and go in whichever half the price belongs to
+		split(i);
+		if (c >= lowest[i + 1]) i++;
+	}
+	priceBlock* p = blocks[i];
+	int at = upper_bound(p->cents, p->cents + p->count, c) - p->cents; // After any books at this price
+	for (int j = p->count; j > at; j--) p->move(j - 1, p, j); // Make room
+	p->put(at, c, b);
+	p->count++;
+	lowest[i] = p->cents[0];
+}
+
+// Method to visit the books priced low..high dollars (inclusive, to the cent), cheapest first, and
+// if inStock only those with a copy on the shelf, until visit returns false
+void priceIndex::forEachIn(double low, double high, bool inStock, const function<bool(bookInfo*)>& visit) {
+	int lo = centsOf(low), hi = centsOf(high);
+	if (lo > hi) return;
+	size_t i = lower_bound(lowest.begin(), lowest.end(), lo) - lowest.begin(); // First block starting at lo or later
+	if (i) i--;                      // The block before it may end with books at lo or above
+	for (; i < blocks.size() && lowest[i] <= hi; i++) {
+		priceBlock* p = blocks[i];
+		for (uint64_t m = p->match(lo, hi, inStock); m; m &= m - 1) { // Each match, lowest slot first
+			if (!visit(p->books[__builtin_ctzll(m)])) return;
+		}
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <string>
+#include <cstring>
+#include <strings.h>
+#include <functional>
+using namespace std;
+
+/*
+Request protocol shared by the server, batch mode, and client.
+Each request is one line; each response is one status line ("OK ..." or "ERR ...")
+optionally followed by data lines. Over a socket a blank line ends each response.
+	FIND <title>                Look a title up: every book with it, one data line per edition
+	ISBN <isbn>                 Look a book up by ISBN
+	BORROW <isbn> <user>        Borrow a copy (or pick up a copy held for the user)
+	RETURN <isbn> <user>        Return a borrowed copy
+	RESERVE <isbn> <user>       Join the reservation queue of an out-of-stock book
+	ACCOUNT <user>              List a user's loans and holds
+	POPULAR                     List the most borrowed and most reserved books
+	PREFIX <text>               Books whose title starts with text (title order, at most SEARCH_LIMIT)
+	AUTHOR <name>               Books by an author, ignoring case (title order, at most SEARCH_LIMIT)
+	PRICE <low> <high> [INSTOCK]  Books priced from low to high dollars (cheapest first, at most
+	                            SEARCH_LIMIT); INSTOCK keeps only those with a copy on the shelf
+	                            (as of a moment ago: a borrow or return in flight may not show yet)
+	INVENTORY                   Totals across the whole catalog (titles, copies on the shelf,
+	                            titles out of stock, value of the copies on the shelf)
+	STATS [RAW]                 Latency of lookups, borrows, returns, hand-offs and catalog loading
+	                            since start: count, p50, p99, p99.9 and max in ns per operation
+	                            (RAW lists histogram buckets instead, see Stats.h)
+	TRACE                       Write recent hash probes, tree descents, rotations and queue
+	                            operations to the --trace file as a Chrome trace (builds with
+	                            -DLMS_TRACE only; see Trace.h)
+Book data lines are tab separated: ISBN, title, author, price, quantity.
+A read-only replica (Replication.h) answers only FIND, ISBN, ACCOUNT, POPULAR, PREFIX, AUTHOR,
+PRICE, INVENTORY, STATS and TRACE; anything else gets "ERR read-only replica", and every request gets
+"ERR replica stale" once it has not heard from its primary for REPLICA_MAX_LAG_SECONDS.
+
+In a sharded deployment each shard process owns the ISBNs that ownerShard() assigns it, and
+a router process (Router.h) speaks the same protocol: requests naming an ISBN go to the owning
+shard, and searches and reports go to every shard and the answers are merged.
+*/
+
+const int SEARCH_LIMIT = 20;       // Most books listed by PREFIX, AUTHOR and PRICE
+
+// Function to pick the shard (0..shards-1) that owns an ISBN
+int ownerShard(int ISBN, int shards) {
+	return (int)((unsigned)ISBN % (unsigned)shards);
+}
+
+// Function to check whether a request only reads (so it may run alongside other reads)
+bool isQuery(const char* line) {
+	while (*line == ' ' || *line == '\t') line++; // Skip leading blanks
+	const char* queries[] = { "FIND", "ISBN", "ACCOUNT", "POPULAR", "INVENTORY", "PREFIX", "AUTHOR", "PRICE", "STATS", "TRACE" };
+	for (const char* q : queries) {
+		size_t n = strlen(q);
+		if (strncasecmp(line, q, n) == 0 && (line[n] == 0 || line[n] == ' ' || line[n] == '\t')) return true;
+	}
+	return false;
+}
+
+// Interface for anything that answers protocol request lines
+class requestHandler {
+public:
+	virtual ~requestHandler() {}
+	virtual void handle(const char* line, string& out) = 0; // Method to answer one request (appends the response lines to out)
+	virtual void prepare(const char* /*line*/) {} // Method to make, on the calling thread, the changes handle would make on the way to answering a query (none by default)
+	virtual void sync() {}         // Method to wait until everything this thread's requests changed is durable (call before replying)
+	virtual bool syncLater(const function<void()>& /*done*/) { sync(); return false; } // Method to have done called (on another thread) once this thread's changes are durable; false, without calling it, if they already are
+};
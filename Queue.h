@@ -1,107 +1,171 @@
 #ifndef _QUEUE_H_
 #define _QUEUE_H_
 #include <iostream>
+#include <stdexcept>
+#include <functional>
+#include <memory>
+#include "Users.h"
+#include "Trace.h"
 using namespace std;
 
-// Node structure definition for a doubly linked list
-struct qNode {
-	qNode* prev;              // Pointer to the previous node (qNode)
-	qNode* next;              // Pointer to the next node (qNode)
-	const char* val;          // Pointer to constant character string (C-style string)
-};
-
-// Queue class definition (Doubly linked list implementation)
-class Q {
+// Queue class definition (growable ring buffer, of user ids in the library); trace is the probe
+// policy (Trace.h), none is what dequeue returns when empty (value must be an integer or pointer
+// type), and the buffer comes from alloc. Every entry gets a ticket, its sequence number in the
+// queue's history; whoever keeps the ticket can ask how far from the front it is in O(1).
+template <class value, class trace = noTrace, value none = value(), class alloc = allocator<value>>
+class basicQ {
 private:
-	qNode* head;              // Pointer to the front (head) of the queue
-	qNode* tail;              // Pointer to the end (tail) of the queue
+	typedef allocator_traits<alloc> slots; // How the buffer is allocated
+
+	alloc store;              // Allocator of the buffer
+	value* buf;               // Ring buffer (allocated on first enqueue)
+	int cap;                  // Capacity of the ring buffer
+	int head;                 // Index of the front element in the buffer
 	int len;                  // Integer representing the length of the queue
+	long long headSeq;        // Sequence number (ticket) of the front element
+
+	void grow();              // Method to double the capacity of the ring buffer
 
 public:
-	Q();                      // Constructor for initializing the queue
-	~Q();                     // Destructor for cleaning up the queue
+	static const bool selfOrdered = false; // Callers lock around it
+
+	basicQ();                 // Constructor for initializing the queue
+	~basicQ();                // Destructor for cleaning up the queue
 
-	void enqueue(char* v);     // Method to add a value (char*) to the queue
-	const char* dequeue();     // Method to remove and return the front value
-	const char* front();       // Method to get the front value without removing it
+	long long enqueue(const value& id); // Method to add a value, returns its ticket
+	long long enqueue(const value& id, const function<void()>& inOrder); // Method to add a value, running inOrder first
+	value dequeue();           // Method to remove and return the front value (none if empty)
+	value dequeue(const function<void(const value&)>& inOrder); // Method to remove the front value, running inOrder on it
+	value front();             // Method to get the front value without removing it
 	bool isEmpty();            // Method to check if the queue is empty
 	int length();              // Method to get the length of the queue
-	void displayAll();         // Method to display all values in the queue
+	int ahead(long long ticket); // Method to get how many are ahead of an entry (-1 if it has left the queue)
+	void displayAll(const userRegistry& users); // Method to display all names in the queue (user id queues)
+	void forEach(const function<void(const value&)>& visit); // Method to visit every value, front to back
 };
 
 // Constructor definition to initialize the queue
-Q::Q() {
-	head = nullptr;            // Initially, head is null (empty queue)
-	tail = nullptr;            // Initially, tail is also null (empty queue)
+template <class value, class trace, value none, class alloc>
+basicQ<value, trace, none, alloc>::basicQ() {
+	buf = nullptr;             // No storage until the first reservation
+	cap = 0;                   // Initial capacity is 0
+	head = 0;                  // Front starts at index 0
 	len = 0;                   // Initial length of the queue is 0
+	headSeq = 0;               // First element gets sequence number 0
 }
 
 // Destructor to clean up memory for the queue
-Q::~Q() {
-	while (head) {             // While the queue is not empty
-		tail = head->next;     // Move tail to the next node
-		delete head;           // Delete the current head node
-		head = tail;           // Move head to the next node
-	}
+template <class value, class trace, value none, class alloc>
+basicQ<value, trace, none, alloc>::~basicQ() {
+	for (int i = 0; i < len; i++) slots::destroy(store, buf + (head + i) % cap); // Values still queued
+	if (buf) slots::deallocate(store, buf, cap); // Free the ring buffer
 }
 
-// Method to add a value to the end of the queue
-void Q::enqueue(char* v) {
-	qNode* newNode = new qNode;    // Dynamically allocate a new qNode
-	newNode->val = v;              // Set the node's value to the input value
-	newNode->next = nullptr;       // The next node is null (since it's the last node)
-	newNode->prev = tail;          // The previous node is the current tail
-
-	if (tail) tail->next = newNode; // If the queue is not empty, update the current tail's next
-	else head = newNode;            // If the queue is empty, newNode becomes the head
+// Method to double the capacity, unrolling the ring so the front is at index 0
+template <class value, class trace, value none, class alloc>
+void basicQ<value, trace, none, alloc>::grow() {
+	int newCap = cap ? cap * 2 : 4;   // Start small; most books never get reserved
+	trace::mark(TRACE_QUEUE_GROW, newCap);
+	value* newBuf = slots::allocate(store, newCap); // Allocate the larger buffer
+	for (int i = 0; i < len; i++) {   // Move over in queue order
+		value* old = buf + (head + i) % cap;
+		slots::construct(store, newBuf + i, move(*old));
+		slots::destroy(store, old);
+	}
+	if (buf) slots::deallocate(store, buf, cap); // Free the old buffer
+	buf = newBuf;                     // Switch to the new buffer
+	cap = newCap;                     // Update the capacity
+	head = 0;                         // Front is now at index 0
+}
 
-	tail = newNode;                 // Update the tail to the new node
-	len++;                          // Increment the length of the queue
+// Method to add a value to the end of the queue, returns its ticket (ahead(ticket) is how many
+// entries were queued before it)
+template <class value, class trace, value none, class alloc>
+long long basicQ<value, trace, none, alloc>::enqueue(const value& id) {
+	traceSpan s = trace::begin();
+	if (len == cap) grow();           // Make room if the buffer is full
+	slots::construct(store, buf + (head + len) % cap, id); // Store the value after the current tail
+	trace::end(TRACE_ENQUEUE, s, len + 1);
+	return headSeq + len++;           // Its sequence number
 }
 
 // Method to remove and return the front value of the queue
-const char* Q::dequeue() {
-	if (!head) return nullptr;      // If the queue is empty, return null
-
-	qNode* temp = head;             // Store the current head node
-	const char* v = head->val;      // Get the value of the head node
-	head = head->next;              // Move the head to the next node
+template <class value, class trace, value none, class alloc>
+value basicQ<value, trace, none, alloc>::dequeue() {
+	if (!len) return none;            // If the queue is empty, say so
+
+	traceSpan s = trace::begin();
+	value id = move(buf[head]);       // Get the value at the front
+	slots::destroy(store, buf + head);
+	head = (head + 1) % cap;          // Advance the front
+	headSeq++;                        // The next element is now at the front
+	len--;                            // Decrease the length of the queue
+	trace::end(TRACE_DEQUEUE, s, len);
+	return id;                        // Return the dequeued value
+}
 
-	if (head) head->prev = nullptr; // If the queue is not empty, update the head's prev pointer
-	else tail = nullptr;            // If the queue becomes empty, update tail to nullptr
+// Method to add a value after running inOrder (the same interface as the ticket-ordered queue, whose
+// inOrder steps are kept in queue order; callers of this one hold a lock, so that is automatic)
+template <class value, class trace, value none, class alloc>
+long long basicQ<value, trace, none, alloc>::enqueue(const value& id, const function<void()>& inOrder) {
+	inOrder();
+	return enqueue(id);
+}
 
-	delete temp;                    // Delete the dequeued node
-	len--;                          // Decrease the length of the queue
-	return v;                       // Return the dequeued value
+// Method to remove the front value and run inOrder on it (nothing runs if the queue is empty)
+template <class value, class trace, value none, class alloc>
+value basicQ<value, trace, none, alloc>::dequeue(const function<void(const value&)>& inOrder) {
+	if (!len) return none;
+	value id = dequeue();
+	inOrder(id);
+	return id;
 }
 
 // Method to return the front value without removing it
-const char* Q::front() {
-	if (!head) {                    // If the queue is empty, throw an error
+template <class value, class trace, value none, class alloc>
+value basicQ<value, trace, none, alloc>::front() {
+	if (!len) {                       // If the queue is empty, throw an error
 		throw runtime_error("Queue is empty, no front element.");
 	}
-	return head->val;               // Return the value at the head
+	return buf[head];                 // Return the value at the front
 }
 
 // Method to check if the queue is empty
-bool Q::isEmpty() {
-	return len == 0;                // Return true if the length is 0 (queue is empty)
+template <class value, class trace, value none, class alloc>
+bool basicQ<value, trace, none, alloc>::isEmpty() {
+	return len == 0;                  // Return true if the length is 0 (queue is empty)
 }
 
 // Method to return the length of the queue
-int Q::length() {
-	return len;                     // Return the length of the queue
+template <class value, class trace, value none, class alloc>
+int basicQ<value, trace, none, alloc>::length() {
+	return len;                       // Return the length of the queue
+}
+
+// Method to return how many entries are ahead of the one with this ticket (reservations ahead of
+// a user); entries only leave from the front, so that is its distance from the front's ticket
+template <class value, class trace, value none, class alloc>
+int basicQ<value, trace, none, alloc>::ahead(long long ticket) {
+	if (ticket < headSeq || ticket >= headSeq + len) return -1; // Already dequeued (or never issued)
+	return (int)(ticket - headSeq);
+}
+
+// Method to visit every value in the queue, front to back
+template <class value, class trace, value none, class alloc>
+void basicQ<value, trace, none, alloc>::forEach(const function<void(const value&)>& visit) {
+	for (int i = 0; i < len; i++) visit(buf[(head + i) % cap]);
 }
 
-// Method to display all elements in the queue
-void Q::displayAll() {
-	qNode* temp = head;             // Start from the head node
-	while (temp) {                  // While there are more nodes in the queue
-		cout << temp->val;           // Print the value of the current node
-		if (temp->next) cout << ", "; // Print a comma if there's a next node
-		temp = temp->next;           // Move to the next node
+// Method to display all names in the queue
+template <class value, class trace, value none, class alloc>
+void basicQ<value, trace, none, alloc>::displayAll(const userRegistry& users) {
+	for (int i = 0; i < len; i++) {   // Walk the queue from front to back
+		cout << users.name(buf[(head + i) % cap]); // Print the name for the current id
+		if (i + 1 < len) cout << ", "; // Print a comma if there's a next entry
 	}
-	cout << endl;                   // End the line after printing all values
+	cout << '\n';                     // End the line after printing all values
 }
 
+typedef basicQ<int, libraryTrace, -1> Q; // Reservation queue (of user ids) as the library builds it
+
 #endif
\ No newline at end of file
@@ -0,0 +1,252 @@
+#pragma once
+#include <string>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <sys/wait.h>
+#include "Server.h"
+using namespace std;
+
+/*
+Log shipping from a primary to read-only replicas. A replica connects and sends
+	FOLLOW <epoch> <seq>        Epoch and position it has applied up to (0 0 when it has nothing)
+and the primary answers
+	PRIMARY <epoch>             Identifies this run of the primary
+followed by one of
+	SNAPSHOT <seq> <time> ... END   The primary's whole state as of record seq (a fresh replica)
+	RESUME <seq>                Records continue from where the replica left off
+	RESYNC                      Too far behind (or the primary restarted); the replica must start over
+and from then on every change record, in the order the primary logged it, plus
+	TICK                        Heartbeat sent while nothing changes
+*/
+
+const size_t REPLICA_BACKLOG = 1 << 20;   // Records kept for replicas that lag or reconnect
+const int REPLICA_HEARTBEAT_SECONDS = 1;  // Longest quiet spell on a replication stream
+const int REPLICA_MAX_LAG_SECONDS = 5;    // Replicas refuse reads after hearing nothing for this long
+
+// Helper function to read a clock that only moves forward, in seconds
+long long steadySeconds() {
+	return chrono::duration_cast<chrono::seconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Helper class to read newline terminated lines from a blocking socket
+class lineReader {
+private:
+	int fd;                        // Socket being read
+	string buf;                    // Bytes received but not yet returned
+
+public:
+	lineReader(int fd) : fd(fd) {} // Constructor with the socket
+	bool next(string& line);       // Method to read the next line (without its newline), false at end of stream
+};
+
+// Method to read the next line, false once the stream ends or breaks
+bool lineReader::next(string& line) {
+	size_t nl;
+	while ((nl = buf.find('\n')) == string::npos) {
+		char chunk[65536];
+		ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return false;  // Stream ended (a partial last line is dropped)
+		buf.append(chunk, n);
+	}
+	line.assign(buf, 0, nl);
+	buf.erase(0, nl + 1);
+	return true;
+}
+
+// Helper function to send a whole buffer on a socket, false if the peer went away
+bool sendAll(int fd, const string& data) {
+	size_t sent = 0;
+	while (sent < data.size()) {
+		ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return false;
+		sent += n;
+	}
+	return true;
+}
+
+// One replica connected to the primary
+struct follower {
+	int fd;                        // Replication stream
+	unsigned long long sent;       // Sequence number of the next record to send
+	pid_t copying;                 // Child process writing its snapshot (0 if none)
+	thread sender;                 // Thread feeding it records
+	atomic<bool> done;             // Set once the stream has ended
+};
+
+// Primary side of log shipping: keeps the most recent records and streams them to every
+// replica from wherever that replica is up to
+class logShipper {
+private:
+	int listenFd;                  // Where replicas connect
+	long long epoch;               // Identifies this run, so replicas notice a restarted primary
+	mutex lock;                    // Guards everything below
+	condition_variable published;  // Signals senders that records arrived (or shutdown)
+	deque<string> backlog;         // Most recent records, oldest first
+	unsigned long long first;      // Sequence number of backlog.front()
+	unsigned long long next;       // Sequence number the next record gets
+	vector<follower*> followers;   // Connected replicas
+	thread acceptor;               // Thread accepting replicas
+	atomic<bool> stopping;         // Set when shutting down
+	function<pid_t(int, unsigned long long&)> copyState; // Starts writing a snapshot to a socket, sets the sequence number it is as of
+
+	void acceptLoop();             // Body of the acceptor thread
+	void welcome(int fd);          // Method to answer a replica's FOLLOW and start streaming to it
+	void sendLoop(follower* f);    // Body of each sender thread
+
+public:
+	logShipper(const function<pid_t(int, unsigned long long&)>& copyState); // Constructor with the way to copy the whole state
+	~logShipper();                 // Destructor that disconnects every replica
+	bool listenOn(const char* addr); // Method to start accepting replicas on a Unix socket path or TCP port
+	void publish(const char* record); // Method to ship one change record (callers keep records in log order)
+	unsigned long long position(); // Method to get the sequence number the next record will get
+};
+
+// Constructor for a shipper with nothing published yet
+logShipper::logShipper(const function<pid_t(int, unsigned long long&)>& copyState)
+	: listenFd(-1), first(0), next(0), stopping(false), copyState(copyState) {
+	epoch = ((long long)time(nullptr) << 20) ^ getpid(); // Differs between runs
+}
+
+// Destructor that stops accepting and disconnects every replica
+logShipper::~logShipper() {
+	stopping = true;
+	if (listenFd >= 0) shutdown(listenFd, SHUT_RDWR); // Wakes the acceptor
+	if (acceptor.joinable()) acceptor.join();
+	if (listenFd >= 0) close(listenFd);
+	{
+		lock_guard<mutex> guard(lock);
+		for (follower* f : followers) shutdown(f->fd, SHUT_RDWR); // Wakes senders blocked in send
+	}
+	published.notify_all();
+	for (follower* f : followers) {
+		f->sender.join();
+		delete f;
+	}
+}
+
+// Method to start accepting replicas on a Unix socket path or TCP port
+bool logShipper::listenOn(const char* addr) {
+	listenFd = listenAddress(addr);
+	if (listenFd < 0) return false;
+	fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL) & ~O_NONBLOCK); // The acceptor simply blocks
+	acceptor = thread(&logShipper::acceptLoop, this);
+	return true;
+}
+
+// Method to ship one change record; called under the lock that ordered the change, like the log
+void logShipper::publish(const char* record) {
+	{
+		lock_guard<mutex> guard(lock);
+		backlog.push_back(record);
+		backlog.back() += '\n';
+		next++;
+		if (backlog.size() > REPLICA_BACKLOG) { // Replicas this far behind have to start over
+			backlog.pop_front();
+			first++;
+		}
+	}
+	published.notify_all();
+}
+
+// Method to return the sequence number the next record will get
+unsigned long long logShipper::position() {
+	lock_guard<mutex> guard(lock);
+	return next;
+}
+
+// Body of the acceptor thread: welcome each replica, and forget those whose streams ended
+void logShipper::acceptLoop() {
+	while (!stopping) {
+		int fd = accept(listenFd, nullptr, nullptr);
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) continue;
+			return;                // Listener shut down
+		}
+		{
+			lock_guard<mutex> guard(lock);
+			for (size_t i = 0; i < followers.size(); i++) {
+				if (!followers[i]->done) continue;
+				followers[i]->sender.join();
+				delete followers[i];
+				followers[i--] = followers.back();
+				followers.pop_back();
+			}
+		}
+		welcome(fd);
+	}
+}
+
+// Method to answer a replica's FOLLOW: send it a snapshot if it has nothing, resume it if its
+// records are still in the backlog, or tell it to start over
+void logShipper::welcome(int fd) {
+	lineReader in(fd);
+	string hello;
+	long long theirEpoch = 0;
+	unsigned long long theirSeq = 0;
+	if (!in.next(hello) || sscanf(hello.c_str(), "FOLLOW %lld %llu", &theirEpoch, &theirSeq) != 2 ||
+		!sendAll(fd, "PRIMARY " + to_string(epoch) + "\n")) {
+		close(fd);
+		return;
+	}
+
+	follower* f = new follower;
+	f->fd = fd;
+	f->copying = 0;
+	f->done = false;
+	if (theirEpoch == 0 && theirSeq == 0) { // Fresh replica: copy the whole state, then stream from there
+		f->copying = copyState(fd, f->sent);
+		if (f->copying < 0) f->sent = 0; // Could not fork; the sender notices and hangs up
+	}
+	else {
+		lock_guard<mutex> guard(lock);
+		if (theirEpoch != epoch || theirSeq < first || theirSeq > next) {
+			sendAll(fd, "RESYNC\n"); // Their records are gone (or came from another run)
+			close(fd);
+			delete f;
+			return;
+		}
+		f->sent = theirSeq;
+	}
+	if (f->copying == 0 && !sendAll(fd, "RESUME " + to_string(f->sent) + "\n")) f->copying = -1;
+
+	lock_guard<mutex> guard(lock);
+	followers.push_back(f);
+	f->sender = thread(&logShipper::sendLoop, this, f);
+}
+
+// Body of each sender thread: wait for the snapshot to be written, then send every record from
+// where the replica is up to, and a heartbeat whenever nothing has been sent for a while
+void logShipper::sendLoop(follower* f) {
+	bool ok = f->copying >= 0;     // Negative: copying the state could not even start
+	if (f->copying > 0) {
+		int status;
+		while (waitpid(f->copying, &status, 0) < 0 && errno == EINTR);
+		ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+	}
+
+	unique_lock<mutex> guard(lock);
+	while (ok && !stopping) {
+		if (f->sent < first) break; // Fell out of the backlog; it will be told to start over
+		string batch;              // Everything it has not seen yet
+		if (f->sent == next) {
+			if (!published.wait_for(guard, chrono::seconds(REPLICA_HEARTBEAT_SECONDS), [&] { return stopping || f->sent < next; }))
+				batch = "TICK\n";  // Quiet for a while: let it know we are still here
+			else continue;
+		}
+		for (; f->sent < next; f->sent++) batch += backlog[f->sent - first];
+		guard.unlock();            // Publishing carries on while we send
+		ok = sendAll(f->fd, batch);
+		guard.lock();
+	}
+	guard.unlock();
+	close(f->fd);
+	f->done = true;
+}
@@ -0,0 +1,338 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <sstream>
+#include <algorithm>
+#include <unordered_map>
+#include "Protocol.h"
+#include "Server.h"
+#include "LMS.h"
+using namespace std;
+
+// Connections to one shard process, reused across requests (each is used by one request at a time)
+class shardLink {
+private:
+	string address;                // Where the shard listens
+	mutex lock;                    // Guards idle
+	vector<int> idle;              // Open connections not in use
+
+public:
+	shardLink(const string& addr); // Constructor with the shard's address
+	~shardLink();                  // Destructor to close every connection
+	int take();                    // Method to get a connection (opens one if none are idle; -1 if the shard is down)
+	void giveBack(int fd);         // Method to return a healthy connection for reuse
+	bool send(int fd, const string& request); // Method to send one request line
+	bool receive(int fd, string& response);   // Method to read one response (without its blank line)
+};
+
+// Constructor with the shard's address
+shardLink::shardLink(const string& addr) : address(addr) {}
+
+// Destructor to close every idle connection
+shardLink::~shardLink() {
+	for (int fd : idle) close(fd);
+}
+
+// Method to get a connection to the shard
+int shardLink::take() {
+	{
+		lock_guard<mutex> guard(lock);
+		if (!idle.empty()) {
+			int fd = idle.back();
+			idle.pop_back();
+			return fd;
+		}
+	}
+	return dialAddress(address.c_str()); // Every connection is busy; open another
+}
+
+// Method to return a connection once its response has been read in full
+void shardLink::giveBack(int fd) {
+	lock_guard<mutex> guard(lock);
+	idle.push_back(fd);
+}
+
+// Method to send one request line
+bool shardLink::send(int fd, const string& request) {
+	string line = request + '\n';
+	size_t sent = 0;
+	while (sent < line.size()) {
+		ssize_t n = ::send(fd, line.data() + sent, line.size() - sent, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return false;  // Shard went away
+		sent += n;
+	}
+	return true;
+}
+
+// Method to read one response up to the blank line that ends it
+bool shardLink::receive(int fd, string& response) {
+	response.clear();
+	char buf[4096];
+	while (response.size() < 2 || response.compare(response.size() - 2, 2, "\n\n") != 0) {
+		ssize_t n = recv(fd, buf, sizeof(buf), 0); // Shards answer one request at a time, so nothing follows the blank line
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return false;  // Shard went away mid-response
+		response.append(buf, n);
+	}
+	response.pop_back();           // Drop the blank line
+	return true;
+}
+
+// Request handler for the router process: requests naming an ISBN go to the shard that owns it
+// (see ownerShard), searches and reports go to every shard and their answers are merged.
+// Holds and loans live on the shard that owns the book, so MAX_LOANS is enforced per shard.
+class shardRouter : public requestHandler {
+private:
+	vector<shardLink*> shards;     // One link per shard, in shard order
+
+	bool ask(int shard, const string& request, string& response); // Method to get one shard's answer
+	void askAll(const string& request, vector<string>& responses); // Method to get every shard's answer
+	void mergeFind(vector<string>& responses, string& out);      // Method to merge FIND answers
+	void mergeBooks(vector<string>& responses, bool byPrice, string& out); // Method to merge PREFIX, AUTHOR and PRICE answers
+	void mergeAccount(vector<string>& responses, string& out);   // Method to merge ACCOUNT answers
+	void mergePopular(vector<string>& responses, string& out);   // Method to merge POPULAR answers
+	void mergeInventory(vector<string>& responses, string& out); // Method to merge INVENTORY answers
+	void mergeStats(vector<string>& responses, bool raw, string& out); // Method to merge STATS RAW answers
+	void mergeTrace(vector<string>& responses, string& out);     // Method to merge TRACE answers
+
+public:
+	shardRouter(const vector<string>& addresses); // Constructor with every shard's address, in shard order
+	~shardRouter();                // Destructor to close every link
+	void handle(const char* line, string& out); // Method to answer one protocol request (thread safe)
+};
+
+// Constructor with every shard's address
+shardRouter::shardRouter(const vector<string>& addresses) {
+	for (const string& a : addresses) shards.push_back(new shardLink(a));
+}
+
+// Destructor to close every link
+shardRouter::~shardRouter() {
+	for (shardLink* s : shards) delete s;
+}
+
+// Method to get one shard's answer, returns false (with an ERR response) if the shard is down
+bool shardRouter::ask(int shard, const string& request, string& response) {
+	shardLink* s = shards[shard];
+	int fd = s->take();
+	if (fd >= 0 && s->send(fd, request) && s->receive(fd, response)) {
+		s->giveBack(fd);
+		return true;
+	}
+	if (fd >= 0) close(fd);        // Broken connection; the next request dials again
+	response = "ERR shard " + to_string(shard) + " unavailable\n";
+	return false;
+}
+
+// Method to get every shard's answer. The request goes out to all shards before any answer is
+// read, so the shards work on it at the same time.
+void shardRouter::askAll(const string& request, vector<string>& responses) {
+	responses.assign(shards.size(), string());
+	vector<int> fds(shards.size(), -1);
+	for (size_t i = 0; i < shards.size(); i++) {
+		fds[i] = shards[i]->take();
+		if (fds[i] >= 0 && !shards[i]->send(fds[i], request)) {
+			close(fds[i]);
+			fds[i] = -1;
+		}
+	}
+	for (size_t i = 0; i < shards.size(); i++) {
+		if (fds[i] >= 0 && shards[i]->receive(fds[i], responses[i])) shards[i]->giveBack(fds[i]);
+		else {
+			if (fds[i] >= 0) close(fds[i]);
+			responses[i] = "ERR shard " + to_string(i) + " unavailable\n";
+		}
+	}
+}
+
+// Method to answer one request by forwarding it to the right shard(s)
+void shardRouter::handle(const char* line, string& out) {
+	stringstream in(line);         // Split off the command
+	string cmd;
+	in >> cmd;
+	for (char& c : cmd) c = toupper(c); // Commands are case insensitive
+
+	if (cmd == "ISBN" || cmd == "BORROW" || cmd == "RETURN" || cmd == "RESERVE") {
+		int ISBN = 0;
+		in >> ISBN;                // A missing ISBN still gets the shard's own error
+		string response;
+		ask(ownerShard(ISBN, (int)shards.size()), line, response);
+		out += response;
+		return;
+	}
+
+	vector<string> responses;      // One answer per shard
+	string raw;                    // STATS RAW asks for the buckets themselves
+	if (cmd == "STATS") in >> raw;
+	if (cmd == "FIND" || cmd == "PREFIX" || cmd == "AUTHOR" || cmd == "PRICE" || cmd == "ACCOUNT" || cmd == "POPULAR" || cmd == "INVENTORY" || cmd == "STATS" || cmd == "TRACE") {
+		askAll(cmd == "STATS" ? "STATS RAW" : line, responses); // Histograms merge exactly; percentiles would not
+		for (string& r : responses) {
+			if (r.compare(0, 10, "ERR shard ") == 0) { // A shard is down
+				out += r;
+				return;
+			}
+		}
+	}
+	if (cmd == "FIND") mergeFind(responses, out);
+	else if (cmd == "PREFIX" || cmd == "AUTHOR" || cmd == "PRICE") mergeBooks(responses, cmd == "PRICE", out);
+	else if (cmd == "ACCOUNT") mergeAccount(responses, out);
+	else if (cmd == "POPULAR") mergePopular(responses, out);
+	else if (cmd == "INVENTORY") mergeInventory(responses, out);
+	else if (cmd == "STATS") mergeStats(responses, strcasecmp(raw.c_str(), "RAW") == 0, out);
+	else if (cmd == "TRACE") mergeTrace(responses, out);
+	else {                         // Unknown commands: let a shard produce the error
+		string response;
+		ask(0, line, response);
+		out += response;
+	}
+}
+
+// Method to merge FIND answers: a title's editions may be spread over shards, so list every shard's
+void shardRouter::mergeFind(vector<string>& responses, string& out) {
+	string editions;               // Every shard's data lines
+	for (string& r : responses) {
+		if (r.compare(0, 2, "OK") == 0) editions += r.substr(r.find('\n') + 1);
+	}
+	if (!editions.empty()) out += "OK\n" + editions;
+	else out += responses.empty() ? "ERR not found\n" : responses[0]; // Everyone said no
+}
+
+// Method to merge PREFIX, AUTHOR and PRICE answers: every shard's books, in title order (or,
+// for PRICE, cheapest first), up to SEARCH_LIMIT
+void shardRouter::mergeBooks(vector<string>& responses, bool byPrice, string& out) {
+	vector<pair<pair<double, string>, string>> books; // ((price or 0, title), whole line)
+	for (string& r : responses) {
+		if (r.compare(0, 2, "OK") != 0) { // A shard refused (a malformed PRICE): pass its error on
+			out += r;
+			return;
+		}
+		stringstream lines(r);
+		string l;
+		getline(lines, l);         // Skip the status line
+		while (getline(lines, l)) {
+			size_t tab = l.find('\t');
+			size_t end = l.find('\t', tab + 1); // End of the title
+			double price = byPrice ? atof(l.c_str() + l.find('\t', end + 1) + 1) : 0; // After the author
+			books.push_back(make_pair(make_pair(price, l.substr(tab + 1, end - tab - 1)), l));
+		}
+	}
+	sort(books.begin(), books.end());
+	out += "OK\n";
+	for (size_t i = 0; i < books.size() && i < (size_t)SEARCH_LIMIT; i++) out += books[i].second + '\n';
+}
+
+// Method to merge ACCOUNT answers: add up the counts and list every shard's loans and holds
+void shardRouter::mergeAccount(vector<string>& responses, string& out) {
+	int borrowed = 0, held = 0;    // Totals across shards
+	string recent;                 // Recent borrows, shard by shard
+	string borrowedLines, holdLines; // Every shard's Borrowed and On hold lines
+	bool any = false;              // Some shard had activity to list
+	for (string& r : responses) {
+		stringstream lines(r);
+		string l;
+		getline(lines, l);         // Skip the status line
+		while (getline(lines, l)) {
+			int b, m, h;
+			if (sscanf(l.c_str(), "You have %d of %d books borrowed and %d on hold.", &b, &m, &h) == 3) {
+				borrowed += b;
+				held += h;
+			}
+			else if (l.compare(0, 18, "Recently borrowed:") == 0) {
+				any = true;
+				string titles = l.substr(19); // After "Recently borrowed:\t"
+				if (!titles.empty()) recent += (recent.empty() ? "" : ", ") + titles;
+			}
+			else if (l.compare(0, 9, "Borrowed:") == 0) borrowedLines += l + '\n';
+			else holdLines += l + '\n';
+		}
+	}
+	out += "OK\n";
+	out += "You have " + to_string(borrowed) + " of " + to_string(MAX_LOANS) + " books borrowed and " + to_string(held) + " on hold.\n";
+	if (!any) return;
+	out += "Recently borrowed:\t" + recent + '\n';
+	out += borrowedLines + holdLines;
+}
+
+// Method to merge POPULAR answers: add up each title's counts and keep the top POPULAR_SHOWN
+void shardRouter::mergePopular(vector<string>& responses, string& out) {
+	unordered_map<string, long long> counts[2]; // Title -> count, for most borrowed and most reserved
+	for (string& r : responses) {
+		stringstream lines(r);
+		string l;
+		int section = -1;          // Which list the lines belong to
+		while (getline(lines, l)) {
+			if (l == "Most borrowed:") section = 0;
+			else if (l == "Most reserved:") section = 1;
+			else if (section >= 0 && l.find(".\t") != string::npos) { // "N.\tTitle (count)"
+				size_t start = l.find('\t') + 1, open = l.rfind(" (");
+				counts[section][l.substr(start, open - start)] += atoll(l.c_str() + open + 2);
+			}
+		}
+	}
+	out += "OK\n";
+	for (int section = 0; section < 2; section++) {
+		out += section ? "Most reserved:\n" : "Most borrowed:\n";
+		vector<pair<long long, string>> ranked;
+		for (pair<const string, long long>& c : counts[section]) ranked.push_back(make_pair(-c.second, c.first));
+		sort(ranked.begin(), ranked.end()); // Highest count first, then by title
+		for (size_t i = 0; i < ranked.size() && i < (size_t)POPULAR_SHOWN; i++) {
+			out += to_string(i + 1) + ".\t" + ranked[i].second + " (" + to_string(-ranked[i].first) + ")\n";
+		}
+		if (ranked.empty()) out += "Nothing yet.\n";
+	}
+}
+
+// Method to merge INVENTORY answers: add up every total
+void shardRouter::mergeInventory(vector<string>& responses, string& out) {
+	long long titles = 0, copies = 0, outOfStock = 0;
+	double value = 0;
+	for (string& r : responses) {
+		stringstream lines(r);
+		string l;
+		while (getline(lines, l)) {
+			size_t tab = l.find('\t');
+			if (tab == string::npos) continue;
+			string field = l.substr(0, tab);
+			const char* num = l.c_str() + tab + 1;
+			if (field == "Titles:") titles += atoll(num);
+			else if (field == "Copies on shelf:") copies += atoll(num);
+			else if (field == "Out of stock:") outOfStock += atoll(num);
+			else if (field == "Shelf value:") value += atof(num);
+		}
+	}
+	ostringstream res;
+	res << "OK\n";
+	res << "Titles:\t" << titles << '\n';
+	res << "Copies on shelf:\t" << copies << '\n';
+	res << "Out of stock:\t" << outOfStock << '\n';
+	res << "Shelf value:\t" << fixed << setprecision(2) << value << '\n';
+	out += res.str();
+}
+
+// Method to merge STATS answers: add up every shard's histogram buckets, then list them (raw)
+// or work out the percentiles of the whole deployment
+void shardRouter::mergeStats(vector<string>& responses, bool raw, string& out) {
+	vector<unsigned long long> total[STAT_OPS]; // Buckets of every shard added up
+	for (vector<unsigned long long>& t : total) t.assign(LATENCY_BUCKETS, 0);
+	for (string& r : responses) latencyStats::parse(r.substr(r.find('\n') + 1), total); // After the status line
+	ostringstream res;
+	res << "OK\n";
+	if (raw) latencyStats::dump(total, res);
+	else latencyStats::report(total, res);
+	out += res.str();
+}
+
+// Method to merge TRACE answers: each shard writes its own file; report the total, or the first refusal
+void shardRouter::mergeTrace(vector<string>& responses, string& out) {
+	long long events = 0;
+	for (string& r : responses) {
+		if (r.compare(0, 3, "OK ") != 0) {
+			out += r;
+			return;
+		}
+		events += atoll(r.c_str() + 3);
+	}
+	out += "OK " + to_string(events) + " events written\n";
+}
@@ -0,0 +1,345 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include "Protocol.h"
+#include "Executor.h"
+using namespace std;
+
+// Helper function to check whether an address names a Unix socket path rather than a TCP port
+bool isUnixAddress(const char* addr) {
+	return strchr(addr, '/') != nullptr; // Paths contain a '/', "host:port" and "port" don't
+}
+
+// Helper function to connect to "path", "port", or "host:port"; returns the socket or -1
+int dialAddress(const char* addr) {
+	if (isUnixAddress(addr)) {     // Unix domain socket
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		sockaddr_un sa;
+		memset(&sa, 0, sizeof(sa));
+		sa.sun_family = AF_UNIX;
+		strncpy(sa.sun_path, addr, sizeof(sa.sun_path) - 1);
+		if (fd >= 0 && connect(fd, (sockaddr*)&sa, sizeof(sa)) == 0) return fd;
+		if (fd >= 0) close(fd);
+		return -1;
+	}
+
+	string host = "127.0.0.1", port = addr; // A bare port means this machine
+	const char* colon = strrchr(addr, ':');
+	if (colon) {
+		host.assign(addr, colon - addr);
+		port = colon + 1;
+	}
+	addrinfo hints, *found;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(host.c_str(), port.c_str(), &hints, &found) != 0) return -1; // Unknown host
+	int fd = -1;
+	for (addrinfo* a = found; a && fd < 0; a = a->ai_next) { // First address that accepts
+		fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+		if (fd >= 0 && connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+			close(fd);
+			fd = -1;
+		}
+	}
+	freeaddrinfo(found);
+	return fd;
+}
+
+// Helper function to listen on "path" or "port" (every interface); returns a non-blocking socket or -1
+int listenAddress(const char* addr) {
+	int fd;
+	if (isUnixAddress(addr)) {     // Unix domain socket
+		fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+		sockaddr_un sa;
+		memset(&sa, 0, sizeof(sa));
+		sa.sun_family = AF_UNIX;
+		strncpy(sa.sun_path, addr, sizeof(sa.sun_path) - 1);
+		unlink(addr);              // Remove a stale socket file from a previous run
+		if (fd >= 0 && bind(fd, (sockaddr*)&sa, sizeof(sa)) != 0) {
+			close(fd);
+			return -1;
+		}
+	}
+	else {                         // TCP port on every interface
+		fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+		int on = 1;
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+		sockaddr_in sa;
+		memset(&sa, 0, sizeof(sa));
+		sa.sin_family = AF_INET;
+		sa.sin_addr.s_addr = htonl(INADDR_ANY);
+		sa.sin_port = htons(atoi(addr));
+		if (fd >= 0 && bind(fd, (sockaddr*)&sa, sizeof(sa)) != 0) {
+			close(fd);
+			return -1;
+		}
+	}
+	if (fd >= 0 && listen(fd, SOMAXCONN) != 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+// State of one client connection
+struct connection {
+	int fd;                        // Socket
+	uint64_t id;                   // Unique id (fds get reused, ids don't)
+	string in;                     // Bytes read but not yet dispatched
+	string out;                    // Bytes waiting to be written
+	bool busy;                     // A worker is answering this connection's requests
+	bool peerClosed;               // The client has finished sending
+};
+
+// Request server: one epoll thread does all socket I/O, and a worker pool answers
+// requests. Each connection has at most one batch of requests in flight, so its
+// responses come back in request order. The pool is the caller's, so the handler can
+// fork its scans onto the same threads instead of a second pool.
+class lmsServer {
+private:
+	static const uint64_t LISTEN_ID = 0; // epoll id of the listening socket
+	static const uint64_t WAKE_ID = 1;   // epoll id of the wake-up eventfd
+	static const size_t MAX_PENDING = 1 << 20; // Most unanswered bytes buffered per connection
+
+	requestHandler& handler;       // Answers the requests
+	workStealingPool& pool;        // Threads that run the handler
+	atomic<int> inFlight;          // Batches handed to the pool and not yet answered
+	int epfd;                      // epoll instance
+	int wakeFd;                    // eventfd workers use to wake the I/O thread
+	int listenFd;                  // Listening socket
+	atomic<bool> running;          // Cleared by stop()
+	uint64_t nextId;               // Next connection id
+	unordered_map<uint64_t, connection*> conns; // Open connections by id
+	mutex doneLock;                // Guards done
+	vector<pair<uint64_t, string>> done; // Finished responses waiting to be written
+
+	void watch(connection* c);     // Method to update what epoll waits for on a connection
+	void acceptAll();              // Method to accept every pending connection
+	void readFrom(connection* c);  // Method to read what a client sent
+	void dispatch(connection* c);  // Method to hand complete request lines to a worker
+	void flush(connection* c);     // Method to write as much pending output as the socket takes
+	void finishAll();              // Method to collect responses from the workers
+	void drop(connection* c);      // Method to close a connection
+
+public:
+	lmsServer(requestHandler& handler, workStealingPool& pool); // Constructor with the handler and the threads to run it on
+	~lmsServer();                  // Destructor to wait for the pool and close every socket
+	bool listenOn(const char* addr); // Method to listen on a Unix socket path or a TCP port
+	void run();                    // Method to serve until stop() is called
+	void stop();                   // Method to make run() return (safe from any thread)
+};
+
+// Constructor for the server
+lmsServer::lmsServer(requestHandler& handler, workStealingPool& pool)
+	: handler(handler), pool(pool), inFlight(0), listenFd(-1), running(false), nextId(2) {
+	epfd = epoll_create1(0);       // Event loop
+	wakeFd = eventfd(0, EFD_NONBLOCK); // Workers poke this when a response is ready
+	epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.u64 = WAKE_ID;
+	epoll_ctl(epfd, EPOLL_CTL_ADD, wakeFd, &ev);
+}
+
+// Destructor to close every socket once no batch is still being answered
+lmsServer::~lmsServer() {
+	while (inFlight.load() > 0) this_thread::yield(); // They write to done and wakeFd
+	while (!conns.empty()) drop(conns.begin()->second);
+	if (listenFd >= 0) close(listenFd);
+	close(wakeFd);
+	close(epfd);
+}
+
+// Method to listen on a Unix socket path or a TCP port
+bool lmsServer::listenOn(const char* addr) {
+	listenFd = listenAddress(addr);
+	if (listenFd < 0) return false;
+
+	epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.u64 = LISTEN_ID;
+	return epoll_ctl(epfd, EPOLL_CTL_ADD, listenFd, &ev) == 0;
+}
+
+// Method to serve until stop() is called
+void lmsServer::run() {
+	epoll_event events[64];        // Ready sockets per wake-up
+	running = true;
+	while (running) {
+		int n = epoll_wait(epfd, events, 64, -1);
+		if (n < 0 && errno != EINTR) break; // epoll itself failed
+		for (int i = 0; i < n; i++) {
+			uint64_t id = events[i].data.u64;
+			if (id == LISTEN_ID) acceptAll();
+			else if (id == WAKE_ID) finishAll();
+			else {
+				unordered_map<uint64_t, connection*>::iterator it = conns.find(id);
+				if (it == conns.end()) continue; // Dropped earlier in this batch
+				connection* c = it->second;
+				if (events[i].events & (EPOLLHUP | EPOLLERR)) drop(c); // Client is gone both ways
+				else if (events[i].events & EPOLLOUT) flush(c); // Read on the next wake-up if c survives
+				else readFrom(c);
+			}
+		}
+	}
+}
+
+// Method to make run() return
+void lmsServer::stop() {
+	running = false;
+	uint64_t one = 1;
+	if (write(wakeFd, &one, sizeof(one)) < 0) {} // Wake the loop so it sees the flag
+}
+
+// Method to accept every pending connection
+void lmsServer::acceptAll() {
+	while (true) {
+		int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK);
+		if (fd < 0) return;        // EAGAIN: nobody else is waiting
+		connection* c = new connection;
+		c->fd = fd;
+		c->id = nextId++;
+		c->busy = false;
+		c->peerClosed = false;
+		conns[c->id] = c;
+
+		epoll_event ev;
+		ev.events = EPOLLIN;
+		ev.data.u64 = c->id;
+		epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+	}
+}
+
+// Method to read what the client has sent so far, up to MAX_PENDING unanswered bytes; past that
+// the connection stops reading (see watch) until its batch in flight is answered
+void lmsServer::readFrom(connection* c) {
+	char buf[16384];               // Read buffer
+	while (c->in.size() <= MAX_PENDING) {
+		ssize_t n = recv(c->fd, buf, sizeof(buf), 0);
+		if (n > 0) c->in.append(buf, n);
+		else if (n == 0) {         // Client finished sending
+			c->peerClosed = true;
+			break;
+		}
+		else if (errno == EAGAIN || errno == EWOULDBLOCK) break; // Drained for now
+		else if (errno != EINTR) { // Connection is broken
+			drop(c);
+			return;
+		}
+	}
+
+	dispatch(c);
+	if (!c->busy && c->in.size() > MAX_PENDING) drop(c); // One line longer than the limit: refuse to buffer it
+	else if (c->peerClosed && !c->busy && c->out.empty()) drop(c); // Nothing left to answer
+	else watch(c);                 // Stop reading if it is done sending or too far ahead
+}
+
+// Method to hand every complete request line to a worker as one batch
+void lmsServer::dispatch(connection* c) {
+	if (c->busy) return;           // Keep responses in order: one batch at a time
+	size_t end = c->in.rfind('\n');
+	if (end == string::npos) return; // No complete line yet
+
+	string batch = c->in.substr(0, end + 1);
+	c->in.erase(0, end + 1);
+	c->busy = true;
+	uint64_t id = c->id;
+	inFlight++;
+	pool.submit([this, id, batch] {
+		string out;                // Responses for the whole batch
+		size_t start = 0;
+		while (start < batch.size()) {
+			size_t nl = batch.find('\n', start);
+			string line = batch.substr(start, nl - start);
+			start = nl + 1;
+			if (!line.empty() && line.back() == '\r') line.pop_back(); // Accept CRLF clients
+			if (line.empty()) continue; // Ignore blank lines
+			handler.handle(line.c_str(), out);
+			out += '\n';           // Blank line ends each response
+		}
+		handler.sync();            // Nothing is acknowledged before it is durable
+		{
+			lock_guard<mutex> guard(doneLock);
+			done.push_back({ id, out });
+		}
+		uint64_t one = 1;
+		if (write(wakeFd, &one, sizeof(one)) < 0) {} // Wake the I/O thread
+		inFlight--;
+	});
+}
+
+// Method to write as much pending output as the socket will take
+void lmsServer::flush(connection* c) {
+	while (!c->out.empty()) {
+		ssize_t n = send(c->fd, c->out.data(), c->out.size(), MSG_NOSIGNAL);
+		if (n > 0) c->out.erase(0, n);
+		else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break; // Socket full, wait for EPOLLOUT
+		else if (n < 0 && errno == EINTR) continue;
+		else {                     // Client went away
+			drop(c);
+			return;
+		}
+	}
+	watch(c);
+	if (c->peerClosed && !c->busy && c->out.empty()) drop(c); // All answered
+}
+
+// Method to wait for input (unless the client is done, or has MAX_PENDING bytes waiting for the
+// batch in flight) and for room to write (if output is pending)
+void lmsServer::watch(connection* c) {
+	epoll_event ev;
+	bool reading = !c->peerClosed && c->in.size() <= MAX_PENDING;
+	ev.events = (reading ? (uint32_t)EPOLLIN : 0u) | (c->out.empty() ? 0u : (uint32_t)EPOLLOUT);
+	ev.data.u64 = c->id;
+	epoll_ctl(epfd, EPOLL_CTL_MOD, c->fd, &ev);
+}
+
+// Method to collect finished responses and send them on
+void lmsServer::finishAll() {
+	uint64_t count;
+	if (read(wakeFd, &count, sizeof(count)) < 0) {} // Reset the eventfd
+
+	vector<pair<uint64_t, string>> ready;
+	{
+		lock_guard<mutex> guard(doneLock);
+		ready.swap(done);
+	}
+	for (pair<uint64_t, string>& r : ready) {
+		unordered_map<uint64_t, connection*>::iterator it = conns.find(r.first);
+		if (it == conns.end()) continue; // Client left before the answer was ready
+		connection* c = it->second;
+		c->out += r.second;
+		c->busy = false;
+		dispatch(c);               // Start on anything that arrived meanwhile
+		if (!c->busy && c->in.size() > MAX_PENDING) { // One line longer than the limit
+			drop(c);
+			continue;
+		}
+		flush(c);                  // May drop c (and reading resumes if it had stopped)
+	}
+}
+
+// Method to close a connection and forget it
+void lmsServer::drop(connection* c) {
+	epoll_ctl(epfd, EPOLL_CTL_DEL, c->fd, nullptr);
+	close(c->fd);
+	conns.erase(c->id);
+	delete c;
+}
@@ -1,56 +1,80 @@
 #pragma once
-#include "bookInfo.h"
+#include "Policies.h"
+#include "Trace.h"
 
-// Stack class definition
-class stack {
+// Stack class definition; trace is the probe policy (Trace.h), nodes come from alloc
+template <class value, class trace = noTrace, class alloc = allocator<value>>
+class basicStack {
 private:
+	// Node structure for a stack (Doubly linked list structure)
+	struct sNode {
+		sNode* above;             // Pointer to the node above in the stack
+		sNode* below;             // Pointer to the node below in the stack
+		value val;                // The value (book information) stored in the node
+
+		// Constructor to initialize the stack node with a value
+		sNode(const value& v) : above(nullptr), below(nullptr), val(v) {}
+	};
+
 	sNode* top;                   // Pointer to the top node of the stack
+	nodeAllocator<sNode, alloc> nodes; // Where nodes come from
 
 public:
-	stack();                      // Constructor to initialize the stack
-	~stack();                     // Destructor to clean up the stack
-	void push(bookInfo* v);        // Method to push a book onto the stack
-	bookInfo* pop();               // Method to pop a book off the stack
-	bookInfo* peep();              // Method to peek at the top book without removing it
+	basicStack();                 // Constructor to initialize the stack
+	~basicStack();                // Destructor to clean up the stack
+	void push(const value& v);     // Method to push a value onto the stack
+	value pop();                   // Method to pop a value off the stack (value() if empty)
+	value peep();                  // Method to peek at the top value without removing it
 };
 
 // Constructor for the stack
-stack::stack() {
+template <class value, class trace, class alloc>
+basicStack<value, trace, alloc>::basicStack() {
 	top = nullptr;                // Initialize the top of the stack as null (empty stack)
 }
 
 // Destructor to clean up the stack
-stack::~stack() {
+template <class value, class trace, class alloc>
+basicStack<value, trace, alloc>::~basicStack() {
 	sNode* below;                 // Temporary pointer to store the node below
 	while (top) {                 // While there are nodes in the stack
 		below = top->below;       // Move below to the next node in the stack
-		delete top;               // Delete the current top node
+		nodes.free(top);          // Delete the current top node
 		top = below;              // Move top to the next node in the stack
 	}
 }
 
-// Method to push a book onto the stack
-void stack::push(bookInfo* v) {
-	sNode* newNode = new sNode(v); // Dynamically allocate a new node with bookInfo
+// Method to push a value onto the stack
+template <class value, class trace, class alloc>
+void basicStack<value, trace, alloc>::push(const value& v) {
+	traceSpan s = trace::begin();
+	sNode* newNode = nodes.make(v); // Allocate a new node with the value
 	if (top) top->above = newNode; // If the stack is not empty, set the current top's above to new node
 	newNode->below = top;          // Set the new node's below pointer to the current top
 	top = newNode;                 // Update the top of the stack to the new node
+	trace::end(TRACE_PUSH, s, 0);
 }
 
-// Method to pop a book off the stack
-bookInfo* stack::pop() {
-	if (!top) return nullptr;      // If the stack is empty, return null
+// Method to pop a value off the stack
+template <class value, class trace, class alloc>
+value basicStack<value, trace, alloc>::pop() {
+	if (!top) return value();      // If the stack is empty, return an empty value
 
-	bookInfo* ret = top->val;      // Get the bookInfo stored at the top of the stack
+	traceSpan s = trace::begin();
+	value ret = top->val;          // Get the value stored at the top of the stack
 	sNode* temp = top;             // Temporarily store the current top node
 	top = top->below;              // Move top to the next node in the stack
-	delete temp;                   // Delete the old top node
+	nodes.free(temp);              // Delete the old top node
 	if (top) top->above = nullptr; // If the stack is not empty, update the new top's above pointer
-	return ret;                    // Return the book that was popped off the stack
+	trace::end(TRACE_POP, s, 0);
+	return ret;                    // Return the value that was popped off the stack
 }
 
-// Method to peek at the top book without removing it
-bookInfo* stack::peep() {
-	if (top) return top->val;      // If the stack is not empty, return the book at the top
-	else return nullptr;           // If the stack is empty, return null
+// Method to peek at the top value without removing it
+template <class value, class trace, class alloc>
+value basicStack<value, trace, alloc>::peep() {
+	if (top) return top->val;      // If the stack is not empty, return the value at the top
+	else return value();           // If the stack is empty, return an empty value
 }
+
+typedef basicStack<bookInfo*, libraryTrace> stack; // Stack as the library builds it
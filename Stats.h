@@ -0,0 +1,180 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <ostream>
+#include <cstdio>
+#include <cstring>
+using namespace std;
+
+// Operations whose latency is recorded
+enum statOp {
+	STAT_TITLE_LOOKUP,            // Finding a book by title (AVL::retrieve)
+	STAT_ISBN_LOOKUP,             // Finding a book by ISBN (hashTable::get)
+	STAT_BORROW,                  // Borrowing or picking up a copy
+	STAT_RETURN,                  // Returning a copy (includes passing it along)
+	STAT_HANDOFF,                 // Passing a freed copy to the next reservation or the shelf
+	STAT_INGEST,                  // Loading one book from the catalog file
+	STAT_OPS                      // Number of operations above
+};
+
+// Names STATS lists the operations under
+const char* statNames[STAT_OPS] = { "title-lookup", "isbn-lookup", "borrow", "return", "hand-off", "ingest" };
+
+const int LATENCY_SUB_BITS = 5;   // 32 buckets per power of two, so a bucket is within about 3% of its values
+const int LATENCY_MAGNITUDES = 40; // Values up to 2^40 ns (about 18 minutes); longer ones count as that
+const int LATENCY_BUCKETS = (LATENCY_MAGNITUDES - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS;
+
+// Helper function to read a steady clock in nanoseconds
+long long monotonicNs() {
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Histogram of latencies in log-linear buckets (the HDR histogram layout): exact below 64 ns,
+// then 32 buckets per power of two. Written by one thread, read by any.
+class latencyHistogram {
+private:
+	atomic<unsigned long long> counts[LATENCY_BUCKETS]; // Values seen per bucket
+
+public:
+	latencyHistogram();            // Constructor for an empty histogram
+	static int bucketOf(long long ns); // Method to find the bucket a value falls in
+	static long long bucketTop(int bucket); // Method to get the largest value a bucket holds
+	void record(long long ns);     // Method to count one value (only from the owning thread)
+	void addTo(vector<unsigned long long>& total) const; // Method to add every bucket's count into total
+};
+
+// Constructor for a histogram with nothing counted
+latencyHistogram::latencyHistogram() {
+	for (atomic<unsigned long long>& c : counts) c.store(0, memory_order_relaxed);
+}
+
+// Method to find the bucket of a value: its top LATENCY_SUB_BITS + 1 bits, and how far they were shifted
+int latencyHistogram::bucketOf(long long ns) {
+	if (ns < 0) ns = 0;
+	if (ns >= 1LL << LATENCY_MAGNITUDES) ns = (1LL << LATENCY_MAGNITUDES) - 1;
+	int top = 63 - __builtin_clzll(ns | 1); // Highest set bit
+	int shift = top > LATENCY_SUB_BITS ? top - LATENCY_SUB_BITS : 0;
+	return (shift << LATENCY_SUB_BITS) + (int)(ns >> shift);
+}
+
+// Method to get the largest value a bucket holds (what percentiles report, as HDR histograms do)
+long long latencyHistogram::bucketTop(int bucket) {
+	int shift = bucket < (2 << LATENCY_SUB_BITS) ? 0 : (bucket >> LATENCY_SUB_BITS) - 1;
+	long long sub = bucket - ((long long)shift << LATENCY_SUB_BITS);
+	return ((sub + 1) << shift) - 1;
+}
+
+// Method to count one value; only the owning thread writes, so a plain load and store will do
+void latencyHistogram::record(long long ns) {
+	atomic<unsigned long long>& c = counts[bucketOf(ns)];
+	c.store(c.load(memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+// Method to add every bucket's count into total (sized LATENCY_BUCKETS)
+void latencyHistogram::addTo(vector<unsigned long long>& total) const {
+	for (int i = 0; i < LATENCY_BUCKETS; i++) total[i] += counts[i].load(memory_order_relaxed);
+}
+
+// Latency histograms of every operation, one set per thread so recording never contends;
+// reads add up every thread's set
+class latencyStats {
+private:
+	struct threadSet {
+		latencyHistogram ops[STAT_OPS]; // One histogram per operation
+	};
+
+	mutex lock;                    // Guards sets
+	vector<threadSet*> sets;       // Every thread's set (kept after the thread ends, so its counts stay in)
+	static thread_local threadSet* mine; // Calling thread's set (nullptr until it records)
+
+public:
+	void record(statOp op, long long ns); // Method to count one latency on the calling thread
+	void merged(vector<unsigned long long> (&total)[STAT_OPS]); // Method to add up every thread's buckets
+	static void report(vector<unsigned long long> (&total)[STAT_OPS], ostream& out); // Method to list counts and percentiles
+	static void dump(vector<unsigned long long> (&total)[STAT_OPS], ostream& out); // Method to list raw bucket counts
+	static void parse(const string& dumped, vector<unsigned long long> (&total)[STAT_OPS]); // Method to add dumped counts into total
+};
+
+thread_local latencyStats::threadSet* latencyStats::mine = nullptr;
+
+latencyStats opLatency;           // Latencies of this process's operations
+
+// Method to count one latency in the calling thread's histogram (registering it the first time)
+void latencyStats::record(statOp op, long long ns) {
+	if (!mine) {
+		threadSet* s = new threadSet;
+		lock_guard<mutex> guard(lock);
+		sets.push_back(s);
+		mine = s;
+	}
+	mine->ops[op].record(ns);
+}
+
+// Method to add up every thread's buckets for every operation
+void latencyStats::merged(vector<unsigned long long> (&total)[STAT_OPS]) {
+	for (vector<unsigned long long>& t : total) t.assign(LATENCY_BUCKETS, 0);
+	lock_guard<mutex> guard(lock);
+	for (threadSet* s : sets) {
+		for (int op = 0; op < STAT_OPS; op++) s->ops[op].addTo(total[op]);
+	}
+}
+
+// Method to write one tab separated line per operation: name, count, p50, p99, p99.9 and max in ns
+void latencyStats::report(vector<unsigned long long> (&total)[STAT_OPS], ostream& out) {
+	out << "Operation\tCount\tp50 ns\tp99 ns\tp99.9 ns\tMax ns" << '\n';
+	for (int op = 0; op < STAT_OPS; op++) {
+		unsigned long long n = 0;
+		for (unsigned long long c : total[op]) n += c;
+		out << statNames[op] << '\t' << n;
+		const double wanted[] = { 0.5, 0.99, 0.999, 1.0 };
+		int bucket = 0;
+		unsigned long long seen = 0; // Values in buckets before bucket
+		for (double p : wanted) {
+			unsigned long long rank = n ? (unsigned long long)(p * n + 0.999999) : 0; // Values at or below the percentile
+			if (rank < 1) rank = 1;
+			while (n && bucket < LATENCY_BUCKETS && seen + total[op][bucket] < rank) seen += total[op][bucket++];
+			out << '\t' << (n ? latencyHistogram::bucketTop(bucket) : 0);
+		}
+		out << '\n';
+	}
+}
+
+// Method to write each non-empty bucket as "name bucket count", for merging in another process
+void latencyStats::dump(vector<unsigned long long> (&total)[STAT_OPS], ostream& out) {
+	for (int op = 0; op < STAT_OPS; op++) {
+		for (int i = 0; i < LATENCY_BUCKETS; i++) {
+			if (total[op][i]) out << statNames[op] << '\t' << i << '\t' << total[op][i] << '\n';
+		}
+	}
+}
+
+// Method to add the counts in a dump (lines from dump) into total (sized LATENCY_BUCKETS each)
+void latencyStats::parse(const string& dumped, vector<unsigned long long> (&total)[STAT_OPS]) {
+	size_t start = 0;
+	while (start < dumped.size()) {
+		size_t end = dumped.find('\n', start);
+		if (end == string::npos) end = dumped.size();
+		string line = dumped.substr(start, end - start);
+		start = end + 1;
+		size_t tab = line.find('\t');
+		if (tab == string::npos) continue;
+		int bucket = 0;
+		unsigned long long count = 0;
+		if (sscanf(line.c_str() + tab + 1, "%d %llu", &bucket, &count) != 2 || bucket < 0 || bucket >= LATENCY_BUCKETS) continue;
+		for (int op = 0; op < STAT_OPS; op++) {
+			if (line.compare(0, tab, statNames[op]) == 0 && strlen(statNames[op]) == tab) total[op][bucket] += count;
+		}
+	}
+}
+
+// Timer that records how long its scope took as one latency of an operation
+struct latencyTimer {
+	statOp op;                     // Operation being timed
+	long long start;               // When the scope began
+
+	latencyTimer(statOp op) : op(op), start(monotonicNs()) {} // Constructor that starts the clock
+	~latencyTimer() { opLatency.record(op, monotonicNs() - start); } // Destructor that records the time taken
+};
@@ -0,0 +1,203 @@
+#pragma once
+#include <ctime>
+#include "bookInfo.h"
+
+// Source of the current time in seconds (swap in manualClock to drive time by hand)
+class clockSource {
+public:
+	virtual ~clockSource() {}
+	virtual long long now() = 0;          // Method to get the current time in seconds
+};
+
+// Clock that reads the system wall clock
+class systemClock : public clockSource {
+public:
+	long long now() { return (long long)time(nullptr); } // Seconds since the epoch
+};
+
+// Clock that reads the system wall clock moved by a fixed number of seconds (to carry on from another time)
+class shiftedClock : public clockSource {
+private:
+	long long offset;                     // Seconds added to the wall clock
+
+public:
+	shiftedClock(long long from) : offset(from - (long long)time(nullptr)) {} // Constructor that makes now() read from
+	long long now() { return (long long)time(nullptr) + offset; }
+};
+
+// Clock that only moves when told to
+class manualClock : public clockSource {
+private:
+	long long t;                          // Current time in seconds
+
+public:
+	manualClock(long long start = 0) : t(start) {} // Constructor with the starting time
+	long long now() { return t; }         // Method to get the current time
+	void set(long long s) { t = s; }      // Method to jump to a time
+	void advance(long long s) { t += s; } // Method to move time forward
+};
+
+// Kinds of deadlines tracked by the timer wheel
+enum timerKind {
+	HOLD_PICKUP,                          // A copy is held for a patron until this time
+	LOAN_DUE                              // A borrowed copy is due back at this time
+};
+
+// Node structure for a timer (intrusive doubly linked list so cancel is O(1))
+struct timerNode {
+	timerNode* prev;                      // Previous timer in the same slot
+	timerNode* next;                      // Next timer in the same slot (or in the expired list)
+	long long expires;                    // Tick at which the timer fires
+	int level;                            // Wheel level the timer is filed under
+	int slot;                             // Slot within that level
+	timerKind kind;                       // What the deadline is for
+	int user;                             // User id the deadline belongs to
+	bookInfo* book;                       // Book the deadline belongs to
+};
+
+// Hierarchical timing wheel: each level has 64 slots, and each slot of a level covers
+// a full turn of the level below it. Timers are filed by how far away they are and
+// cascade down a level as their time approaches.
+class timerWheel {
+private:
+	static const int LEVELS = 4;          // Number of wheel levels
+	static const int BITS = 6;            // log2 of slots per level
+	static const int SLOTS = 1 << BITS;   // Slots per level
+
+	timerNode* slots[LEVELS][SLOTS];      // Head of the timer list in each slot
+	long long current;                    // Last tick that has been processed
+	int tickSeconds;                      // Seconds per tick
+	int count;                            // Number of pending timers
+
+	void place(timerNode* t);             // Method to file a timer in the right slot
+	void unlink(timerNode* t);            // Method to remove a timer from its slot
+	void cascade(int level, int slot);    // Method to move a slot's timers down a level
+
+public:
+	timerWheel(int tickSeconds = 60);     // Constructor with the wheel resolution
+	~timerWheel();                        // Destructor to free pending timers
+	void start(long long now);            // Method to set the wheel's starting time
+	timerNode* schedule(long long when, timerKind kind, int user, bookInfo* book); // Method to add a timer
+	void cancel(timerNode* t);            // Method to remove and free a pending timer
+	timerNode* advance(long long now);    // Method to move time forward, returns the expired timers
+	long long when(timerNode* t);         // Method to get a timer's deadline in seconds
+	int pending();                        // Method to get the number of pending timers
+};
+
+// Constructor for the timer wheel
+timerWheel::timerWheel(int tickSeconds) : current(0), tickSeconds(tickSeconds), count(0) {
+	for (int l = 0; l < LEVELS; l++)
+		for (int s = 0; s < SLOTS; s++) slots[l][s] = nullptr; // Every slot starts empty
+}
+
+// Destructor to free every pending timer
+timerWheel::~timerWheel() {
+	for (int l = 0; l < LEVELS; l++) {
+		for (int s = 0; s < SLOTS; s++) {
+			while (slots[l][s]) {          // Free each timer in the slot
+				timerNode* next = slots[l][s]->next;
+				delete slots[l][s];
+				slots[l][s] = next;
+			}
+		}
+	}
+}
+
+// Method to set the wheel's starting time (call before scheduling)
+void timerWheel::start(long long now) {
+	current = now / tickSeconds;          // Ticks up to now count as processed
+}
+
+// Method to file a timer under the level whose span covers its distance from now
+void timerWheel::place(timerNode* t) {
+	if (t->expires < current) t->expires = current; // Cascaded stragglers fire on this tick
+	long long delta = t->expires - current; // Ticks until the timer fires
+
+	int level = 0;
+	while (level < LEVELS - 1 && delta >= (1LL << (BITS * (level + 1)))) level++; // Find the covering level
+	long long at = t->expires;
+	if (delta >= (1LL << (BITS * LEVELS))) at = current + (1LL << (BITS * LEVELS)) - 1; // Park far timers at the horizon
+	t->level = level;
+	t->slot = (int)((at >> (BITS * level)) & (SLOTS - 1)); // Slot index at that level
+
+	t->prev = nullptr;                    // Push onto the front of the slot's list
+	t->next = slots[level][t->slot];
+	if (t->next) t->next->prev = t;
+	slots[level][t->slot] = t;
+}
+
+// Method to remove a timer from its slot's list
+void timerWheel::unlink(timerNode* t) {
+	if (t->prev) t->prev->next = t->next; // Bypass the timer from the previous node
+	else slots[t->level][t->slot] = t->next; // Or move the slot head past it
+	if (t->next) t->next->prev = t->prev; // Bypass the timer from the next node
+}
+
+// Method to re-file every timer in a slot now that its turn has come
+void timerWheel::cascade(int level, int slot) {
+	timerNode* t = slots[level][slot];    // Detach the whole slot
+	slots[level][slot] = nullptr;
+	while (t) {
+		timerNode* next = t->next;
+		place(t);                          // Lands on a lower level (or fires on this tick)
+		t = next;
+	}
+}
+
+// Method to add a timer firing at the given time in seconds
+timerNode* timerWheel::schedule(long long when, timerKind kind, int user, bookInfo* book) {
+	timerNode* t = new timerNode;         // Dynamically allocate the timer
+	t->expires = (when + tickSeconds - 1) / tickSeconds; // Round up to a whole tick
+	if (t->expires <= current) t->expires = current + 1; // Overdue timers fire on the next tick
+	t->kind = kind;
+	t->user = user;
+	t->book = book;
+	place(t);                             // File it in the wheel
+	count++;                              // One more pending timer
+	return t;                             // The caller keeps this handle to cancel it
+}
+
+// Method to cancel a pending timer
+void timerWheel::cancel(timerNode* t) {
+	if (!t) return;                       // Nothing to cancel
+	unlink(t);                            // Remove it from its slot
+	delete t;                             // Free the timer
+	count--;                              // One fewer pending timer
+}
+
+// Method to process every tick up to now; returns the expired timers linked through next.
+// The caller owns the returned nodes and must delete them.
+timerNode* timerWheel::advance(long long now) {
+	long long target = now / tickSeconds; // Last tick to process
+	timerNode* expired = nullptr;         // List of timers that fired
+
+	if (!count && current < target) current = target; // Nothing pending, skip straight ahead
+	while (current < target) {
+		current++;                         // Process the next tick
+		for (int level = 1; level < LEVELS; level++) { // Cascade higher levels at their boundaries
+			if (current & ((1LL << (BITS * level)) - 1)) break; // Not a boundary for this level
+			cascade(level, (int)((current >> (BITS * level)) & (SLOTS - 1)));
+		}
+
+		int slot = (int)(current & (SLOTS - 1)); // Level 0 slot for this tick
+		while (slots[0][slot]) {           // Everything left in it fires now
+			timerNode* t = slots[0][slot];
+			slots[0][slot] = t->next;
+			t->next = expired;             // Move it onto the expired list
+			expired = t;
+			count--;
+		}
+	}
+	if (expired) expired->prev = nullptr;
+	return expired;                       // The caller handles and frees these
+}
+
+// Method to return a timer's deadline in seconds
+long long timerWheel::when(timerNode* t) {
+	return t->expires * tickSeconds;      // Convert ticks back to seconds
+}
+
+// Method to return the number of pending timers
+int timerWheel::pending() {
+	return count;                         // Pending timers not yet expired or cancelled
+}
@@ -0,0 +1,198 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+using namespace std;
+
+struct ssBucket;
+
+// Node structure for one monitored key in the Space-Saving summary
+struct ssCounter {
+	int key;                       // ISBN being counted
+	long long error;               // Most this key's count may be overestimated by
+	ssCounter* prev;               // Previous counter in the same bucket
+	ssCounter* next;               // Next counter in the same bucket
+	ssBucket* bucket;              // Bucket holding every counter with the same count
+};
+
+// Node structure for a group of counters sharing one count (buckets are sorted ascending)
+struct ssBucket {
+	long long count;               // Count shared by every counter in the bucket
+	ssCounter* first;              // Counters with this count
+	ssBucket* prev;                // Bucket with the next lower count
+	ssBucket* next;                // Bucket with the next higher count
+};
+
+// Space-Saving heavy hitters over a fixed number of counters (stream-summary layout, so
+// each event is O(1)). Optionally halves every count after a fixed number of events so
+// that old popularity fades.
+class spaceSaving {
+private:
+	int capacity;                  // Number of keys monitored at once
+	ssCounter* counters;           // Counter storage
+	ssBucket* buckets;             // Bucket storage
+	vector<ssCounter*> freeCounters; // Counters not monitoring a key
+	vector<ssBucket*> freeBuckets; // Buckets not in use
+	ssBucket* minBucket;           // Bucket with the lowest count
+	ssBucket* maxBucket;           // Bucket with the highest count
+	unordered_map<int, ssCounter*> where; // Key -> its counter
+	long long decayEvery;          // Events between halvings (0 = never)
+	long long sinceDecay;          // Events since the last halving
+
+	ssBucket* newBucket(long long count, ssBucket* after); // Method to link a bucket after another (nullptr = front)
+	void detach(ssCounter* c);     // Method to take a counter out of its bucket
+	void attach(ssCounter* c, ssBucket* b); // Method to put a counter into a bucket
+	void increment(ssCounter* c);  // Method to move a counter up by one
+	void decay();                  // Method to halve every count
+
+public:
+	spaceSaving(int capacity, long long decayEvery = 0); // Constructor with the number of counters
+	~spaceSaving();                // Destructor to free the counters
+	void add(int key);             // Method to count one event for a key
+	long long estimate(int key);   // Method to get a key's estimated count (0 if not monitored)
+	void restore(int key, long long count); // Method to start monitoring a key at a saved count
+	int top(int k, int* keys, long long* counts); // Method to get the k largest, returns how many were written
+};
+
+// Constructor for the Space-Saving summary
+spaceSaving::spaceSaving(int capacity, long long decayEvery)
+	: capacity(capacity), minBucket(nullptr), maxBucket(nullptr), decayEvery(decayEvery), sinceDecay(0) {
+	counters = new ssCounter[capacity]; // Allocate every counter up front
+	buckets = new ssBucket[capacity + 1]; // One per counter, plus one while a counter moves up
+	for (int i = capacity - 1; i >= 0; i--) freeCounters.push_back(&counters[i]);
+	for (int i = capacity; i >= 0; i--) freeBuckets.push_back(&buckets[i]);
+}
+
+// Destructor to free the counters and buckets
+spaceSaving::~spaceSaving() {
+	delete[] counters;
+	delete[] buckets;
+}
+
+// Method to link a new, empty bucket after another bucket (or at the front)
+ssBucket* spaceSaving::newBucket(long long count, ssBucket* after) {
+	ssBucket* b = freeBuckets.back(); // Reuse a free bucket
+	freeBuckets.pop_back();
+	b->count = count;
+	b->first = nullptr;
+	b->prev = after;
+	b->next = after ? after->next : minBucket;
+	if (b->next) b->next->prev = b; else maxBucket = b;
+	if (after) after->next = b; else minBucket = b;
+	return b;
+}
+
+// Method to take a counter out of its bucket, freeing the bucket if it empties
+void spaceSaving::detach(ssCounter* c) {
+	ssBucket* b = c->bucket;
+	if (c->prev) c->prev->next = c->next; else b->first = c->next;
+	if (c->next) c->next->prev = c->prev;
+	if (!b->first) {               // Bucket is empty, unlink it
+		if (b->prev) b->prev->next = b->next; else minBucket = b->next;
+		if (b->next) b->next->prev = b->prev; else maxBucket = b->prev;
+		freeBuckets.push_back(b);
+	}
+}
+
+// Method to put a counter into a bucket
+void spaceSaving::attach(ssCounter* c, ssBucket* b) {
+	c->bucket = b;
+	c->prev = nullptr;
+	c->next = b->first;
+	if (b->first) b->first->prev = c;
+	b->first = c;
+}
+
+// Method to move a counter to the bucket one higher, creating it if needed
+void spaceSaving::increment(ssCounter* c) {
+	ssBucket* b = c->bucket;
+	ssBucket* up = b->next;
+	if (!up || up->count != b->count + 1) up = newBucket(b->count + 1, b); // Next count doesn't exist yet
+	detach(c);                     // May free b, but up is already linked past it
+	attach(c, up);
+}
+
+// Method to count one event for a key
+void spaceSaving::add(int key) {
+	unordered_map<int, ssCounter*>::iterator it = where.find(key);
+	if (it != where.end()) increment(it->second); // Already monitored
+	else if (!freeCounters.empty()) { // Room for a new key
+		ssCounter* c = freeCounters.back();
+		freeCounters.pop_back();
+		c->key = key;
+		c->error = 0;              // Seen from its first event, so exact
+		ssBucket* b = (minBucket && minBucket->count == 1) ? minBucket : newBucket(1, nullptr);
+		attach(c, b);
+		where[key] = c;
+	}
+	else {                         // Replace the least counted key
+		ssCounter* c = minBucket->first;
+		where.erase(c->key);
+		c->key = key;
+		c->error = minBucket->count; // The newcomer inherits the evicted count as error
+		where[key] = c;
+		increment(c);
+	}
+
+	if (decayEvery && ++sinceDecay >= decayEvery) decay(); // Let old popularity fade
+}
+
+// Method to halve every count (and error), forgetting keys that reach zero
+void spaceSaving::decay() {
+	vector<pair<long long, ssCounter*>> live; // New count per still-monitored counter
+	for (ssBucket* b = minBucket; b; b = b->next) {
+		for (ssCounter* c = b->first; c; c = c->next) {
+			if (b->count / 2) live.push_back({ b->count / 2, c });
+			else {                     // Count fades to nothing
+				where.erase(c->key);
+				freeCounters.push_back(c);
+			}
+		}
+	}
+	while (minBucket) {            // Release every bucket
+		freeBuckets.push_back(minBucket);
+		minBucket = minBucket->next;
+	}
+	maxBucket = nullptr;
+
+	sort(live.begin(), live.end()); // Rebuild buckets in ascending order
+	for (const pair<long long, ssCounter*>& p : live) {
+		if (!maxBucket || maxBucket->count != p.first) newBucket(p.first, maxBucket);
+		p.second->error /= 2;
+		attach(p.second, maxBucket);
+	}
+	sinceDecay = 0;
+}
+
+// Method to start monitoring a key at a count saved earlier (ignored if it is already monitored
+// or every counter is in use)
+void spaceSaving::restore(int key, long long count) {
+	if (count <= 0 || where.count(key) || freeCounters.empty()) return;
+	ssCounter* c = freeCounters.back();
+	freeCounters.pop_back();
+	c->key = key;
+	c->error = 0;
+	ssBucket* b = minBucket;       // First bucket not below count
+	while (b && b->count < count) b = b->next;
+	if (!b || b->count != count) b = newBucket(count, b ? b->prev : maxBucket);
+	attach(c, b);
+	where[key] = c;
+}
+
+// Method to return a key's estimated count
+long long spaceSaving::estimate(int key) {
+	unordered_map<int, ssCounter*>::iterator it = where.find(key);
+	return it == where.end() ? 0 : it->second->bucket->count;
+}
+
+// Method to write the k most frequent keys (highest first), returns how many were written
+int spaceSaving::top(int k, int* keys, long long* counts) {
+	int n = 0;
+	for (ssBucket* b = maxBucket; b && n < k; b = b->prev) { // Walk down from the highest count
+		for (ssCounter* c = b->first; c && n < k; c = c->next, n++) {
+			keys[n] = c->key;
+			counts[n] = b->count;
+		}
+	}
+	return n;
+}
@@ -0,0 +1,178 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "Stats.h"
+using namespace std;
+
+/*
+Probe points in the containers. hashTable, sortedList, AVL, Q and stack are templates over a
+trace policy with these static methods:
+	traceSpan begin()                              Start timing an operation
+	void step()                                    Count one node visited (chain link, tree node)
+	void end(traceEvent e, traceSpan s, long long arg) Finish an operation begun at s
+	void mark(traceEvent e, long long arg)         Note a single moment (a rotation, a hand-off)
+noTrace does nothing and compiles away. ringTrace writes fixed-size records into a ring per
+thread, which dumpTrace() writes out as a Chrome trace (chrome://tracing, ui.perfetto.dev).
+The library's containers use libraryTrace: ringTrace when built with -DLMS_TRACE, else noTrace.
+*/
+
+// Things the containers trace
+enum traceEvent {
+	TRACE_HASH_INSERT,            // hashTable::insert (arg: slot)
+	TRACE_HASH_GET,               // hashTable::get (arg: slot)
+	TRACE_HASH_REMOVE,            // hashTable::remove (arg: slot)
+	TRACE_TREE_INSERT,            // AVL::insert (arg: tree height)
+	TRACE_TREE_RETRIEVE,          // AVL::retrieve (arg: tree height)
+	TRACE_TREE_REMOVE,            // AVL::remove (arg: tree height)
+	TRACE_ROTATE_LEFT,            // AVL rotation (arg: height of the subtree)
+	TRACE_ROTATE_RIGHT,           // AVL rotation (arg: height of the subtree)
+	TRACE_ENQUEUE,                // Q::enqueue (arg: length after)
+	TRACE_DEQUEUE,                // Q::dequeue (arg: length after)
+	TRACE_QUEUE_GROW,             // Q ring buffer doubled (arg: new capacity)
+	TRACE_PUSH,                   // stack::push
+	TRACE_POP,                    // stack::pop
+	TRACE_HANDOFF,                // A returned copy went to the next reservation (arg: ISBN)
+	TRACE_EVENTS                  // Number of events above
+};
+
+// How each event appears in the trace: name, category, and what its arg means
+const char* traceNames[TRACE_EVENTS][3] = {
+	{ "hash insert", "hashTable", "slot" }, { "hash get", "hashTable", "slot" }, { "hash remove", "hashTable", "slot" },
+	{ "tree insert", "AVL", "height" }, { "tree retrieve", "AVL", "height" }, { "tree remove", "AVL", "height" },
+	{ "rotate left", "AVL", "height" }, { "rotate right", "AVL", "height" },
+	{ "enqueue", "Q", "length" }, { "dequeue", "Q", "length" }, { "queue grow", "Q", "capacity" },
+	{ "push", "stack", "arg" }, { "pop", "stack", "arg" }, { "hand-off", "LMS", "ISBN" }
+};
+
+const int TRACE_RING_EVENTS = 1 << 15; // Most recent events kept per thread (32 bytes each)
+
+// Start of a traced operation
+struct traceSpan {
+	long long start;              // When it began (ns)
+	long long steps;              // Thread's step count when it began
+};
+
+// One traced event, as stored in a ring
+struct traceRecord {
+	long long start;              // When it began (ns on the steady clock)
+	long long arg;                // Event specific value (see traceEvent)
+	unsigned int duration;        // How long it took (ns; 0 for a moment)
+	unsigned int steps;           // Nodes visited
+	unsigned short event;         // traceEvent
+	bool instant;                 // A moment rather than an operation
+};
+
+// Policy that traces nothing; every call is empty and compiles away
+struct noTrace {
+	static traceSpan begin() { return traceSpan(); }
+	static void step() {}
+	static void end(traceEvent, traceSpan, long long) {}
+	static void mark(traceEvent, long long) {}
+};
+
+// Events of one thread, newest overwriting oldest
+struct traceRing {
+	traceRecord records[TRACE_RING_EVENTS]; // Ring storage
+	atomic<unsigned long long> written; // Events ever written (the next goes at written % TRACE_RING_EVENTS)
+	long long steps;              // Nodes visited so far (only the owning thread touches it)
+	long tid;                     // Kernel thread id, to tell threads apart in the trace
+};
+
+// Every thread's ring, for dumping
+class traceRegistry {
+private:
+	mutex lock;                   // Guards rings
+	vector<traceRing*> rings;     // Kept after their threads end, so their events can still be dumped
+
+public:
+	traceRing* join();            // Method to give the calling thread a ring
+	long long dump(const char* path); // Method to write every ring as a Chrome trace, returns the events written (-1 on error)
+};
+
+traceRegistry traceRings;         // Rings of this process's threads
+
+// Policy that records every event in the calling thread's ring
+struct ringTrace {
+	static thread_local traceRing* ring; // Calling thread's ring (nullptr until it traces)
+
+	static traceRing* mine() {    // Method to get the calling thread's ring
+		if (!ring) ring = traceRings.join();
+		return ring;
+	}
+	static traceSpan begin() {
+		traceSpan s = { monotonicNs(), mine()->steps };
+		return s;
+	}
+	static void step() { mine()->steps++; }
+	static void end(traceEvent e, traceSpan s, long long arg) { write(e, s.start, monotonicNs() - s.start, mine()->steps - s.steps, arg, false); }
+	static void mark(traceEvent e, long long arg) { write(e, monotonicNs(), 0, 0, arg, true); }
+	static void write(traceEvent e, long long start, long long duration, long long steps, long long arg, bool instant); // Method to append a record
+};
+
+thread_local traceRing* ringTrace::ring = nullptr;
+
+// Method to append one record to the calling thread's ring (only its own thread writes it)
+void ringTrace::write(traceEvent e, long long start, long long duration, long long steps, long long arg, bool instant) {
+	traceRing* r = mine();
+	unsigned long long n = r->written.load(memory_order_relaxed);
+	traceRecord& rec = r->records[n % TRACE_RING_EVENTS];
+	rec.start = start;
+	rec.arg = arg;
+	rec.duration = (unsigned int)min(duration, 0xffffffffLL);
+	rec.steps = (unsigned int)steps;
+	rec.event = (unsigned short)e;
+	rec.instant = instant;
+	r->written.store(n + 1, memory_order_release); // The dumper reads records before this mark
+}
+
+// Method to give the calling thread a ring of its own
+traceRing* traceRegistry::join() {
+	traceRing* r = new traceRing;
+	r->written = 0;
+	r->steps = 0;
+	r->tid = syscall(SYS_gettid);
+	lock_guard<mutex> guard(lock);
+	rings.push_back(r);
+	return r;
+}
+
+// Method to write every thread's events as Chrome trace JSON. Threads keep tracing meanwhile,
+// so a ring that wraps during the dump may contribute a few garbled records.
+long long traceRegistry::dump(const char* path) {
+	FILE* f = fopen(path, "w");
+	if (!f) return -1;
+	long long count = 0;          // Events written
+	long pid = getpid();
+	fprintf(f, "{\"traceEvents\":[");
+	lock_guard<mutex> guard(lock);
+	for (traceRing* r : rings) {
+		unsigned long long last = r->written.load(memory_order_acquire);
+		unsigned long long first = last > (unsigned long long)TRACE_RING_EVENTS ? last - TRACE_RING_EVENTS : 0;
+		for (unsigned long long i = first; i < last; i++) {
+			traceRecord rec = r->records[i % TRACE_RING_EVENTS];
+			if (rec.event >= TRACE_EVENTS) continue; // Overwritten mid-copy
+			const char** names = traceNames[rec.event];
+			fprintf(f, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%s\",\"ts\":%.3f,", count ? "," : "", names[0], names[1],
+				rec.instant ? "i" : "X", rec.start / 1000.0);
+			if (rec.instant) fprintf(f, "\"s\":\"t\",");
+			else fprintf(f, "\"dur\":%.3f,", rec.duration / 1000.0);
+			fprintf(f, "\"pid\":%ld,\"tid\":%ld,\"args\":{\"%s\":%lld,\"steps\":%u}}", pid, r->tid, names[2], rec.arg, rec.steps);
+			count++;
+		}
+	}
+	fprintf(f, "\n]}\n");
+	if (fclose(f) != 0) return -1;
+	return count;
+}
+
+// Trace policy of the library's own containers
+#ifdef LMS_TRACE
+typedef ringTrace libraryTrace;
+#else
+typedef noTrace libraryTrace;
+#endif
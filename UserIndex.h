@@ -0,0 +1,106 @@
+#pragma once
+#include <unordered_map>
+using namespace std;
+
+// One book a patron has on hold
+struct heldBook {
+	int copies;                     // Holds on the book
+	long long ticket;               // Their reservation queue entry's ticket (-1 if they never queued)
+
+	heldBook() : copies(0), ticket(-1) {} // Constructor with nothing held
+};
+
+// Everything one patron currently has out or on hold (by ISBN)
+struct userActivity {
+	unordered_map<int, heldBook> holds; // Reservations waiting in a queue or ready for pickup
+	unordered_map<int, int> loans;  // Copies currently borrowed
+	int holdTotal;                  // Total holds across all books
+	int loanTotal;                  // Total loans across all books
+
+	userActivity() : holdTotal(0), loanTotal(0) {} // Constructor with nothing out
+};
+
+// Index from user id to their holds and loans, kept up to date as they change
+class userIndex {
+private:
+	unordered_map<int, userActivity> byUser; // Activity per user id
+
+	userActivity& at(int user);     // Method to get a user's entry, creating it if needed
+	void bump(unordered_map<int, int>& m, int& total, int ISBN, int by); // Method to adjust one count
+
+public:
+	void addHold(int user, int ISBN, long long ticket); // Method to record a new hold and its place in the queue
+	void removeHold(int user, int ISBN);  // Method to drop a hold (picked up, forfeited or expired)
+	void addLoan(int user, int ISBN);     // Method to record a new loan
+	void removeLoan(int user, int ISBN);  // Method to drop a returned loan
+	int loanCount(int user);              // Method to get how many copies a user has out
+	int holdCount(int user);              // Method to get how many holds a user has
+	const userActivity* get(int user);    // Method to get a user's activity (nullptr if none)
+};
+
+// Method to return a user's entry, creating it for new users
+userActivity& userIndex::at(int user) {
+	return byUser[user];
+}
+
+// Method to adjust a per-ISBN count and its total, dropping counts that reach zero
+void userIndex::bump(unordered_map<int, int>& m, int& total, int ISBN, int by) {
+	unordered_map<int, int>::iterator it = m.find(ISBN);
+	if (it == m.end()) {
+		if (by > 0) m[ISBN] = by;      // First copy of this book
+		else return;                   // Nothing to remove
+	}
+	else if ((it->second += by) <= 0) m.erase(it); // Last copy gone
+	total += by;                       // Keep the running total in step
+}
+
+// Method to record a new hold on a book; ticket is the user's entry in its reservation queue
+// (-1 for a hold restored without one), which the account listing turns into a place in line
+void userIndex::addHold(int user, int ISBN, long long ticket) {
+	userActivity& a = at(user);
+	heldBook& h = a.holds[ISBN];
+	h.copies++;
+	h.ticket = ticket;
+	a.holdTotal++;
+}
+
+// Method to drop a hold on a book, dropping the entry once no copies are held
+void userIndex::removeHold(int user, int ISBN) {
+	unordered_map<int, userActivity>::iterator u = byUser.find(user);
+	if (u == byUser.end()) return;     // Nothing to remove (and no entry made for nobody)
+	userActivity& a = u->second;
+	unordered_map<int, heldBook>::iterator it = a.holds.find(ISBN);
+	if (it == a.holds.end()) return;   // Nothing to remove
+	if (--it->second.copies <= 0) a.holds.erase(it);
+	a.holdTotal--;
+}
+
+// Method to record a new loan of a book
+void userIndex::addLoan(int user, int ISBN) {
+	userActivity& a = at(user);
+	bump(a.loans, a.loanTotal, ISBN, 1);
+}
+
+// Method to drop a returned loan of a book
+void userIndex::removeLoan(int user, int ISBN) {
+	unordered_map<int, userActivity>::iterator u = byUser.find(user);
+	if (u != byUser.end()) bump(u->second.loans, u->second.loanTotal, ISBN, -1); // Nobody with no loans gets an entry
+}
+
+// Method to return how many copies a user has out
+int userIndex::loanCount(int user) {
+	unordered_map<int, userActivity>::iterator it = byUser.find(user);
+	return it == byUser.end() ? 0 : it->second.loanTotal;
+}
+
+// Method to return how many holds a user has
+int userIndex::holdCount(int user) {
+	unordered_map<int, userActivity>::iterator it = byUser.find(user);
+	return it == byUser.end() ? 0 : it->second.holdTotal;
+}
+
+// Method to return a user's activity, or nullptr if they have never had any
+const userActivity* userIndex::get(int user) {
+	unordered_map<int, userActivity>::iterator it = byUser.find(user);
+	return it == byUser.end() ? nullptr : &it->second;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <iostream>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <shared_mutex>
+using namespace std;
+
+// Helper function to combine a user id and an ISBN into one map key
+uint64_t userBookKey(int user, int ISBN) {
+	return ((uint64_t)(uint32_t)user << 32) | (uint32_t)ISBN; // User in the high half, ISBN in the low half
+}
+
+// Registry that interns user names into small integer ids
+class userRegistry {
+private:
+	vector<char*> names;                 // Owned copy of each name, indexed by user id
+	unordered_map<string, int> ids;      // Name -> user id lookup
+	mutable shared_mutex lock;           // Lookups share it, new registrations take it alone
+
+public:
+	userRegistry();                      // Constructor to initialize the registry
+	~userRegistry();                     // Destructor to free the interned names
+	int intern(const char* name);        // Method to get (or assign) the id for a name
+	int find(const char* name);          // Method to get the id for a name, or -1 if unknown
+	const char* name(int id) const;      // Method to get the name for an id
+	int size() const;                    // Method to get the number of registered users
+	void freeze();                       // Method to hold off registrations (and lookups) until thaw
+	void thaw();                         // Method to let registrations continue
+	const char* frozenName(int id) const; // Method to get the name for an id while the registry is frozen
+};
+
+// Constructor for the user registry
+userRegistry::userRegistry() {}
+
+// Destructor to free every interned name
+userRegistry::~userRegistry() {
+	for (char* n : names) delete[] n;    // Free each owned name buffer
+}
+
+// Method to return the id for a name, registering it if it is new
+int userRegistry::intern(const char* name) {
+	{
+		shared_lock<shared_mutex> reading(lock);
+		unordered_map<string, int>::iterator it = ids.find(name); // Look for an existing id
+		if (it != ids.end()) return it->second; // Known user, return their id
+	}
+
+	unique_lock<shared_mutex> writing(lock);
+	unordered_map<string, int>::iterator it = ids.find(name); // Someone may have added them meanwhile
+	if (it != ids.end()) return it->second;
+
+	char* copy = new char[strlen(name) + 1]; // Allocate an owned copy of the name
+	strcpy(copy, name);                  // Copy the name so callers may reuse their buffer
+	names.push_back(copy);               // The new id is the index of the copy
+	ids[copy] = (int)names.size() - 1;   // Remember the id for later lookups
+	return (int)names.size() - 1;        // Return the new id
+}
+
+// Method to return the id for a name without registering it
+int userRegistry::find(const char* name) {
+	shared_lock<shared_mutex> reading(lock);
+	unordered_map<string, int>::iterator it = ids.find(name); // Look for an existing id
+	return it == ids.end() ? -1 : it->second; // Return -1 if the name is unknown
+}
+
+// Method to return the name belonging to an id
+const char* userRegistry::name(int id) const {
+	shared_lock<shared_mutex> reading(lock);
+	if (id < 0 || id >= (int)names.size()) return "?"; // Unknown ids print as '?'
+	return names[id];                    // Return the interned name
+}
+
+// Method to return the number of registered users
+int userRegistry::size() const {
+	shared_lock<shared_mutex> reading(lock);
+	return (int)names.size();            // One id per interned name
+}
+
+// Method to hold off registrations and lookups, so the registry can be copied in a consistent state
+void userRegistry::freeze() {
+	lock.lock();
+}
+
+// Method to let registrations and lookups continue after freeze
+void userRegistry::thaw() {
+	lock.unlock();
+}
+
+// Method to return the name belonging to an id without locking; only for the thread that froze
+// the registry (or a process forked while it was frozen, where that lock can never be released)
+const char* userRegistry::frozenName(int id) const {
+	if (id < 0 || id >= (int)names.size()) return "?";
+	return names[id];
+}
@@ -0,0 +1,234 @@
+#pragma once
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+#include <fstream>
+#include <cstdio>
+#include <cstdarg>
+#include <unistd.h>
+#include <fcntl.h>
+using namespace std;
+
+// Helper function to make renames and new files in a file's directory durable
+void syncDirectory(const string& file) {
+	int dir = ::open(file.substr(0, file.find_last_of('/') + 1).append(".").c_str(), O_RDONLY | O_CLOEXEC);
+	if (dir < 0) return;
+	fsync(dir);
+	::close(dir);
+}
+
+// Append-only write-ahead log of text records, one per line. Records are collected in memory
+// and a single writer thread writes everything collected so far with one write() and one
+// fdatasync() (group commit), so callers never pay for a sync each.
+class writeAheadLog {
+private:
+	int fd;                        // Log file (-1 when closed)
+	string path;                   // Where the log lives
+	thread writer;                 // Group commit thread
+	mutex lock;                    // Guards everything below
+	condition_variable pending;    // Signals the writer that records are waiting
+	condition_variable synced;     // Signals callers that more records are durable
+	string buffer;                 // Records not yet handed to the writer
+	unsigned long long appended;   // Sequence number of the last record appended
+	unsigned long long durable;    // Sequence number of the last record known to be on disk
+	bool stopping;                 // Set when the log is closing
+	bool failed;                   // Set if a write or sync failed (nothing is durable after that)
+	vector<pair<unsigned long long, function<void()>>> waiters; // whenDurable callbacks still waiting (record, callback)
+
+	void commitLoop();             // Body of the writer thread
+	void dropTornTail();           // Method to cut off a record a crash left half written
+
+public:
+	writeAheadLog();               // Constructor for a closed log
+	~writeAheadLog();              // Destructor that makes everything durable and closes the file
+	bool open(const char* path);   // Method to open (or create) a log for appending
+	void close();                  // Method to make everything durable and close the file
+	unsigned long long append(const char* format, ...); // Method to add a record (printf style, no newline), returns its sequence number
+	bool waitDurable(unsigned long long seq); // Method to wait until a record is on disk (false if the log failed)
+	bool whenDurable(unsigned long long seq, const function<void()>& done); // Method to have done called once a record is on disk, without waiting
+	bool roll(const char* closedPath); // Method to move the records so far to another file and carry on in an empty log
+	unsigned long long count();    // Method to get the number of records appended since the log was opened
+	static long long replay(const char* path, const function<void(const string&)>& apply); // Method to feed every complete record of a log to apply
+};
+
+// Constructor for a closed log
+writeAheadLog::writeAheadLog() : fd(-1), appended(0), durable(0), stopping(false), failed(false) {}
+
+// Destructor that makes everything durable and closes the file
+writeAheadLog::~writeAheadLog() {
+	close();
+}
+
+// Method to open (or create) a log for appending and start the writer thread
+bool writeAheadLog::open(const char* path) {
+	fd = ::open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+	if (fd < 0) return false;
+	this->path = path;
+	dropTornTail();                // New records must start on a fresh line
+	stopping = false;
+	writer = thread(&writeAheadLog::commitLoop, this);
+	return true;
+}
+
+// Method to cut the file back to the end of its last complete record
+void writeAheadLog::dropTornTail() {
+	off_t end = lseek(fd, 0, SEEK_END); // Scan backwards from the end for the last newline
+	off_t keep = end;
+	char buf[4096];
+	while (keep > 0) {
+		off_t from = keep > (off_t)sizeof(buf) ? keep - (off_t)sizeof(buf) : 0;
+		ssize_t n = pread(fd, buf, keep - from, from);
+		if (n <= 0) return;        // Can't read it; leave the file alone
+		int i = (int)n - 1;
+		while (i >= 0 && buf[i] != '\n') i--;
+		if (i >= 0) {
+			keep = from + i + 1;   // Just after the newline
+			break;
+		}
+		keep = from;
+	}
+	if (keep < end && ftruncate(fd, keep) == 0) fdatasync(fd);
+}
+
+// Method to make everything durable, stop the writer, and close the file
+void writeAheadLog::close() {
+	if (fd < 0) return;
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+	pending.notify_one();
+	writer.join();                 // The writer drains the buffer before it exits
+	::close(fd);
+	fd = -1;
+}
+
+// Method to add a record; it is durable once waitDurable(returned number) returns
+unsigned long long writeAheadLog::append(const char* format, ...) {
+	char record[512];              // Records are short: a kind, a time, an ISBN and a name
+	va_list args;
+	va_start(args, format);
+	int n = vsnprintf(record, sizeof(record) - 1, format, args);
+	va_end(args);
+	if (n < 0) return 0;
+	if (n > (int)sizeof(record) - 2) n = sizeof(record) - 2; // Cut overlong names rather than lose the record
+	record[n++] = '\n';
+
+	unsigned long long seq;
+	{
+		lock_guard<mutex> guard(lock);
+		buffer.append(record, n);
+		seq = ++appended;
+	}
+	pending.notify_one();          // The writer picks it up with whatever else has arrived
+	return seq;
+}
+
+// Method to wait until record seq (and everything before it) is on disk
+bool writeAheadLog::waitDurable(unsigned long long seq) {
+	unique_lock<mutex> guard(lock);
+	synced.wait(guard, [&] { return durable >= seq || failed || fd < 0; });
+	return durable >= seq;
+}
+
+// Method to have done called on the writer thread once record seq is on disk (or the log has
+// failed), for callers that must not block; false, without calling done, if it already is
+bool writeAheadLog::whenDurable(unsigned long long seq, const function<void()>& done) {
+	lock_guard<mutex> guard(lock);
+	if (durable >= seq || failed || fd < 0) return false;
+	waiters.push_back(make_pair(seq, done));
+	return true;
+}
+
+// Method to close off the log: everything appended so far is made durable and the file is renamed
+// to closedPath, and later records go to a new, empty file at the log's path. Callers must make
+// sure nothing is appended meanwhile, so the cut falls between two known records.
+bool writeAheadLog::roll(const char* closedPath) {
+	if (fd < 0 || !waitDurable(appended)) return false; // The old file must hold every record so far
+	if (rename(path.c_str(), closedPath) != 0) return false;
+	int fresh = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+	if (fresh < 0) {
+		rename(closedPath, path.c_str()); // Put the old file back and keep using it
+		return false;
+	}
+	syncDirectory(path);           // Make both names durable
+	int old;
+	{
+		lock_guard<mutex> guard(lock); // The writer picks up the new file with its next batch
+		old = fd;
+		fd = fresh;
+	}
+	::close(old);
+	return true;
+}
+
+// Method to return the number of records appended since the log was opened
+unsigned long long writeAheadLog::count() {
+	lock_guard<mutex> guard(lock);
+	return appended;
+}
+
+// Body of the writer thread: take everything appended so far, write it, sync once, repeat
+void writeAheadLog::commitLoop() {
+	string batch;                  // Records being written (swapped with buffer, so no copying)
+	while (true) {
+		unsigned long long last;   // Last sequence number in this batch
+		int out;                   // File the batch goes to (roll may switch it between batches)
+		{
+			unique_lock<mutex> guard(lock);
+			pending.wait(guard, [&] { return stopping || !buffer.empty(); });
+			if (buffer.empty()) return; // Stopping and everything is written
+			batch.swap(buffer);
+			last = appended;
+			out = fd;
+		}
+
+		size_t done = 0;           // Write and sync without holding the lock, so appends continue meanwhile
+		bool ok = true;
+		while (done < batch.size() && ok) {
+			ssize_t n = write(out, batch.data() + done, batch.size() - done);
+			if (n > 0) done += n;
+			else if (!(n < 0 && errno == EINTR)) ok = false;
+		}
+		if (ok && fdatasync(out) != 0) ok = false;
+		batch.clear();
+
+		vector<function<void()>> ready; // whenDurable callbacks this batch releases
+		{
+			lock_guard<mutex> guard(lock);
+			if (ok) durable = last;
+			else failed = true;
+			size_t kept = 0;
+			for (size_t i = 0; i < waiters.size(); i++) {
+				if (!ok || waiters[i].first <= last) ready.push_back(waiters[i].second);
+				else waiters[kept++] = waiters[i];
+			}
+			waiters.resize(kept);
+		}
+		synced.notify_all();       // Everyone waiting on this batch can go
+		for (function<void()>& f : ready) f(); // Outside the lock: they may append or wait again
+		if (!ok) {
+			perror("write-ahead log");
+			return;
+		}
+	}
+}
+
+// Method to feed every complete record of a log to apply; a torn last record (from a crash
+// mid-write) is ignored. Returns the number of records, or -1 if the log does not exist.
+long long writeAheadLog::replay(const char* path, const function<void(const string&)>& apply) {
+	ifstream in(path);
+	if (!in.is_open()) return -1;
+	string record;
+	long long count = 0;
+	while (getline(in, record)) {
+		if (in.eof()) break;       // No newline: the crash happened while this record was written
+		if (record.empty()) continue;
+		apply(record);
+		count++;
+	}
+	return count;
+}
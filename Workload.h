@@ -0,0 +1,356 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+#include <algorithm>
+#include <functional>
+#include <climits>
+#include <cstdio>
+#include "Stats.h"
+using namespace std;
+
+/*
+Workload traces: every protocol request a library answers, in the order it arrived, so a real
+day's traffic can be replayed against another build (see replay.cpp). The file is
+	LMSWORK2\n                  Magic
+	state                       The library's state when recording began, as snapshot lines
+	                            (LMS::dumpState) from "SNAPSHOT gen time" to "END"
+followed by one record per request:
+	op                          One byte (workloadOp)
+	gap                         Varint: ns since the previous request arrived
+	ISBN                        Varint (ISBN, BORROW, RETURN, RESERVE only)
+	text                        Varint length and bytes: the title (FIND) or whole line (anything else)
+	user                        Varint: the user's id + 1, 0 for none (ISBN, BORROW, RETURN, RESERVE, ACCOUNT);
+	                            the first time an id appears it is followed by the name (varint length and bytes)
+Varints are little endian base 128. LMSWORK1 traces (no state: they start from the catalog
+as loaded) are still read.
+Each recording thread keeps its requests in a lane of its own, so threads never wait for each
+other; a flusher thread merges the lanes by arrival time and writes them out at least every
+WORKLOAD_FLUSH_MS, so a server that is killed loses only its last moments.
+*/
+
+const int WORKLOAD_FLUSH_MS = 500;   // Longest a recorded request waits in memory
+const size_t WORKLOAD_LANE = 4096;   // Requests a lane collects before the flusher is woken regardless
+
+// Kinds of request a workload trace distinguishes
+enum workloadOp {
+	WORK_FIND,                    // FIND <title>
+	WORK_ISBN,                    // ISBN <isbn> [user]
+	WORK_BORROW,                  // BORROW <isbn> <user>
+	WORK_RETURN,                  // RETURN <isbn> <user>
+	WORK_RESERVE,                 // RESERVE <isbn> <user>
+	WORK_ACCOUNT,                 // ACCOUNT <user>
+	WORK_LINE,                    // Anything else, kept as the whole line
+	WORK_OPS                      // Number of kinds above
+};
+
+// Names the replay report lists requests under, and the commands they are rebuilt with
+const char* workNames[WORK_OPS] = { "find", "isbn", "borrow", "return", "reserve", "account", "other" };
+const char* workCommands[WORK_OPS] = { "FIND", "ISBN", "BORROW", "RETURN", "RESERVE", "ACCOUNT", "" };
+
+// Function to check whether requests of a kind name a book by ISBN
+bool workHasISBN(int op) {
+	return op == WORK_ISBN || op == WORK_BORROW || op == WORK_RETURN || op == WORK_RESERVE;
+}
+
+// Function to check whether requests of a kind carry a user
+bool workHasUser(int op) {
+	return workHasISBN(op) || op == WORK_ACCOUNT;
+}
+
+// One recorded request
+struct workloadRequest {
+	long long at;                 // ns after the first request of the trace
+	int op;                       // workloadOp
+	int ISBN;                     // Book (requests that name one)
+	string text;                  // Title (FIND) or whole line (WORK_LINE)
+	int user;                     // Trace's id of the user (-1 if none)
+	string name;                  // User's name ("" if none)
+
+	string line() const;          // Method to rebuild the protocol request
+};
+
+// Method to rebuild the request line the library was sent
+string workloadRequest::line() const {
+	if (op == WORK_LINE) return text;
+	string l = workCommands[op];
+	if (op == WORK_FIND) return l + ' ' + text;
+	if (workHasISBN(op)) l += ' ' + to_string(ISBN);
+	if (!name.empty()) l += ' ' + name;
+	return l;
+}
+
+// Requests one thread has recorded that the flusher has not taken yet
+struct recordLane {
+	mutex lock;                   // Guards requests (only its thread and the flusher take it)
+	vector<workloadRequest> requests; // In arrival order (at is ns on the monotonic clock)
+};
+
+// Writes a workload trace; any thread may record, and requests are written in arrival order
+class workloadRecorder {
+private:
+	FILE* f;                      // Trace file
+	long long serial;             // Tells this recorder's lanes from those of one freed at the same address
+	mutex lanesLock;              // Guards lanes and stopping
+	vector<recordLane*> lanes;    // One per thread that has recorded (kept until the recorder goes)
+	bool stopping;                // Set when the recorder is closing
+	atomic<bool> full;            // A lane has WORKLOAD_LANE requests waiting
+	condition_variable wake;      // Wakes the flusher early (a full lane, or closing)
+	thread flusher;               // Writes the lanes out every WORKLOAD_FLUSH_MS
+	vector<workloadRequest> held; // Taken from the lanes, but too recent to write yet (flusher only)
+	string out;                   // Records being written (flusher only, like the rest)
+	long long last;               // When the previous request written arrived (ns, 0 before the first)
+	vector<bool> named;           // User ids whose names are already in the file
+
+	static atomic<long long> serials; // Last serial handed out
+	static thread_local long long laneSerial; // Recorder the calling thread's lane belongs to
+	static thread_local recordLane* myLane; // The calling thread's lane in that recorder
+
+	recordLane* lane();           // Method to get the calling thread's lane, adding it the first time
+	void put(unsigned long long v); // Method to append a varint to out
+	void put(const char* s, size_t n); // Method to append a length and bytes to out
+	void encode(const workloadRequest& r); // Method to append one request's record to out
+	void write(long long cut);    // Method to write every request that arrived before cut
+	void flushLoop();             // Body of the flusher thread
+
+public:
+	workloadRecorder();           // Constructor for a recorder with no file yet
+	~workloadRecorder();          // Destructor that writes out whatever is left
+	bool open(const char* path, const function<void(FILE*)>& writeState); // Method to start a new trace file with the state it starts from
+	void record(int op, int ISBN, const string& text, int user, const char* name); // Method to append one request
+};
+
+atomic<long long> workloadRecorder::serials(0);
+thread_local long long workloadRecorder::laneSerial = 0;
+thread_local recordLane* workloadRecorder::myLane = nullptr;
+
+// Constructor for a recorder that has not opened its file yet
+workloadRecorder::workloadRecorder() : f(nullptr), serial(++serials), stopping(false), full(false), last(0) {}
+
+// Destructor that stops the flusher and writes out whatever is left
+workloadRecorder::~workloadRecorder() {
+	{
+		lock_guard<mutex> guard(lanesLock);
+		stopping = true;
+	}
+	wake.notify_all();
+	if (flusher.joinable()) flusher.join();
+	if (f) {
+		write(LLONG_MAX);         // Nobody records any more: everything goes
+		fclose(f);
+	}
+	for (recordLane* l : lanes) delete l;
+}
+
+// Method to create the trace file (replacing any old one), write the state it starts from and
+// start the flusher
+bool workloadRecorder::open(const char* path, const function<void(FILE*)>& writeState) {
+	f = fopen(path, "wb");
+	if (!f) return false;
+	fputs("LMSWORK2\n", f);
+	writeState(f);
+	flusher = thread(&workloadRecorder::flushLoop, this);
+	return true;
+}
+
+// Method to get the calling thread's lane; only a thread's first request takes lanesLock
+recordLane* workloadRecorder::lane() {
+	if (laneSerial == serial) return myLane;
+	lock_guard<mutex> guard(lanesLock);
+	myLane = new recordLane;
+	lanes.push_back(myLane);
+	laneSerial = serial;
+	return myLane;
+}
+
+// Method to append a varint to the output
+void workloadRecorder::put(unsigned long long v) {
+	while (v >= 0x80) {
+		out += (char)((v & 0x7f) | 0x80);
+		v >>= 7;
+	}
+	out += (char)v;
+}
+
+// Method to append a length prefixed string to the output
+void workloadRecorder::put(const char* s, size_t n) {
+	put(n);
+	out.append(s, n);
+}
+
+// Method to append one request's record to the output; requests must come in arrival order
+void workloadRecorder::encode(const workloadRequest& r) {
+	out += (char)r.op;
+	put(last ? r.at - last : 0);
+	last = r.at;
+	if (workHasISBN(r.op)) put((unsigned)r.ISBN);
+	if (r.op == WORK_FIND || r.op == WORK_LINE) put(r.text.data(), r.text.size());
+	if (workHasUser(r.op)) {
+		put(r.user + 1);
+		if (r.user >= 0) {
+			if ((size_t)r.user >= named.size()) named.resize(r.user + 1, false);
+			if (!named[r.user]) {
+				named[r.user] = true;
+				put(r.name.data(), r.name.size());
+			}
+		}
+	}
+}
+
+// Method to append one request to the calling thread's lane. The arrival time is taken under the
+// lane's lock, so a request the flusher misses arrived after it began (see write).
+void workloadRecorder::record(int op, int ISBN, const string& text, int user, const char* name) {
+	recordLane* l = lane();
+	lock_guard<mutex> guard(l->lock);
+	l->requests.push_back(workloadRequest());
+	workloadRequest& r = l->requests.back();
+	r.at = monotonicNs();
+	r.op = op;
+	r.ISBN = ISBN;
+	if (op == WORK_FIND || op == WORK_LINE) r.text = text;
+	r.user = workHasUser(op) ? user : -1;
+	if (r.user >= 0) r.name = name;
+	if (l->requests.size() >= WORKLOAD_LANE && !full.exchange(true)) wake.notify_one(); // A busy spell: write now rather than grow
+}
+
+// Method to write every request that arrived before cut, merged across the lanes by arrival time.
+// cut is read before any lane is locked, so a request that is not in a lane yet arrives after it;
+// requests at or after cut wait in held for the next round, and the file stays in arrival order.
+void workloadRecorder::write(long long cut) {
+	vector<workloadRequest> taken; // Everything recorded so far
+	taken.swap(held);
+	{
+		lock_guard<mutex> guard(lanesLock);
+		for (recordLane* l : lanes) {
+			lock_guard<mutex> laneGuard(l->lock);
+			for (workloadRequest& r : l->requests) taken.push_back(move(r));
+			l->requests.clear();
+		}
+	}
+	full = false;
+	stable_sort(taken.begin(), taken.end(), [](const workloadRequest& a, const workloadRequest& b) { return a.at < b.at; });
+	size_t n = 0;                 // Requests written this round
+	while (n < taken.size() && taken[n].at < cut) encode(taken[n++]);
+	held.assign(make_move_iterator(taken.begin() + n), make_move_iterator(taken.end()));
+	fwrite(out.data(), 1, out.size(), f);
+	fflush(f);
+	out.clear();
+}
+
+// Body of the flusher thread: write the lanes out every WORKLOAD_FLUSH_MS, or sooner once one
+// fills. Only this thread writes (until the destructor), and recording carries on while it does.
+void workloadRecorder::flushLoop() {
+	unique_lock<mutex> guard(lanesLock);
+	while (!stopping) {
+		wake.wait_for(guard, chrono::milliseconds(WORKLOAD_FLUSH_MS), [this] { return stopping || full.load(); });
+		guard.unlock();
+		write(monotonicNs());
+		guard.lock();
+	}
+}
+
+// Reads a workload trace back one request at a time
+class workloadReader {
+private:
+	FILE* f;                      // Trace file
+	long long at;                 // Arrival time of the last request read
+	vector<string> names;         // User names by trace id ("" until one appears)
+	vector<string> state;         // Snapshot lines of the state the trace starts from (none for LMSWORK1)
+
+	bool get(unsigned long long& v); // Method to read a varint
+	bool get(string& s);          // Method to read a length prefixed string
+
+public:
+	workloadReader();             // Constructor for a reader with no file yet
+	~workloadReader();            // Destructor that closes the file
+	bool open(const char* path);  // Method to open a trace and read its starting state, false if missing or not a trace
+	const vector<string>& start() const; // Method to get the starting state's snapshot lines (empty: the catalog as loaded)
+	bool next(workloadRequest& r); // Method to read the next request, false at the end (or a cut off record)
+};
+
+// Constructor for a reader that has not opened its file yet
+workloadReader::workloadReader() : f(nullptr), at(0) {}
+
+// Destructor that closes the trace file
+workloadReader::~workloadReader() {
+	if (f) fclose(f);
+}
+
+// Method to open a trace, check its magic and read the state it starts from
+bool workloadReader::open(const char* path) {
+	f = fopen(path, "rb");
+	if (!f) return false;
+	char magic[9];
+	if (fread(magic, 1, 9, f) != 9) return false;
+	if (memcmp(magic, "LMSWORK1\n", 9) == 0) return true; // Older trace: no state
+	if (memcmp(magic, "LMSWORK2\n", 9) != 0) return false;
+	string line;
+	while (true) {                // Snapshot lines up to END
+		int c = getc(f);
+		if (c == EOF) return false; // Cut off before the state was complete
+		if (c != '\n') {
+			line += (char)c;
+			continue;
+		}
+		state.push_back(line);
+		if (line == "END") return true;
+		line.clear();
+	}
+}
+
+// Method to get the snapshot lines of the state the trace starts from
+const vector<string>& workloadReader::start() const {
+	return state;
+}
+
+// Method to read a varint, false at end of file
+bool workloadReader::get(unsigned long long& v) {
+	v = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		int c = getc(f);
+		if (c == EOF) return false;
+		v |= (unsigned long long)(c & 0x7f) << shift;
+		if (!(c & 0x80)) return true;
+	}
+	return false;                 // Too long to be one of ours
+}
+
+// Method to read a length prefixed string, false at end of file
+bool workloadReader::get(string& s) {
+	unsigned long long n;
+	if (!get(n) || n > (1 << 20)) return false;
+	s.resize(n);
+	return fread(&s[0], 1, n, f) == n;
+}
+
+// Method to read the next request; a record the recorder never finished ends the trace
+bool workloadReader::next(workloadRequest& r) {
+	int op = getc(f);
+	unsigned long long gap, v;
+	if (op == EOF || op >= WORK_OPS || !get(gap)) return false;
+	at += gap;
+	r.at = at;
+	r.op = op;
+	r.ISBN = 0;
+	r.text.clear();
+	r.user = -1;
+	r.name.clear();
+	if (workHasISBN(op)) {
+		if (!get(v)) return false;
+		r.ISBN = (int)(unsigned)v;
+	}
+	if ((op == WORK_FIND || op == WORK_LINE) && !get(r.text)) return false;
+	if (workHasUser(op)) {
+		if (!get(v)) return false;
+		r.user = (int)v - 1;
+		if (r.user >= 0) {
+			if ((size_t)r.user >= names.size()) names.resize(r.user + 1);
+			if (names[r.user].empty() && !get(names[r.user])) return false; // First appearance: the name follows
+			r.name = names[r.user];
+		}
+	}
+	return true;
+}
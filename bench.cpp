@@ -0,0 +1,474 @@
+/*
+Library Management System benchmarks
+- Usage: bench [--max-books <n>] [--ops <n>] [--seed <n>]
+	- Builds synthetic catalogs of 1e3, 1e4, ... up to --max-books books (default 1e7)
+	- Times each container operation the library is built on: hashTable::insert/get,
+	  AVL::insert/retrieve/remove, priceIndex::insert/forEachIn, sortedList::get, Q::enqueue/dequeue,
+	  stack::push/pop, and loading the CSV catalog in LMS::LMS()
+	- sortedList::get searches one list of the whole catalog (uniform, Zipf and miss, like the hash
+	  table's gets); a walk is linear, so it does fewer ops (--ops or 1e9 / books, whichever is less)
+	- Lookups pick books uniformly or by a Zipf distribution (exponent BENCH_ZIPF_S), --ops of each,
+	  and then look for ISBNs and titles the catalog does not have ("access":"miss": misspelled
+	  titles share all but their last character with a real one)
+	- Price searches ask for in-stock books between two random prices $20 apart: the first
+	  SEARCH_LIMIT of them, as PRICE INSTOCK lists ("access":"page"), or all of them counted
+	  ("access":"count", fewer ops since each visits a fifth of the catalog or so)
+	- Prints one JSON object per line, so runs can be diffed or loaded into anything:
+	  {"op":"hashTable::get","books":1000,"access":"zipf","ops":1000000,"ns_per_op":41.2,
+	   "ops_per_sec":24271844,"p50_ns":39.1,"p90_ns":44.0,"p99_ns":61.5,"p999_ns":180.2}
+	  Percentiles are over batches of BENCH_BATCH operations (one clock read per batch, so the
+	  clock's own cost does not swamp operations that take a few nanoseconds)
+	- A benchmark that takes longer than BENCH_BUDGET_SECONDS at one size is skipped at larger ones
+	- Where Linux lets this process read hardware counters (perf_event_open), each line also has
+	  per-operation averages of cycles, instructions, L1 data cache, last level cache, branch and
+	  data TLB misses ("cycles_per_op", ...). They count user space only, over the timed code.
+	  Counters the kernel or CPU does not offer are left out and named once on stderr.
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "LMS.h"
+#include "Stack.h"
+using namespace std;
+
+const int BENCH_BATCH = 64;                 // Operations timed together as one sample
+const double BENCH_ZIPF_S = 0.99;           // Skew of the Zipf access pattern
+const double BENCH_BUDGET_SECONDS = 30;     // Time one benchmark may take at one size before larger sizes are skipped
+
+// One hardware counter: what JSON calls it, and how perf_event_open names it
+struct counterKind {
+	const char* name;                       // Reported as <name>_per_op
+	unsigned int type;                      // perf_event_attr::type
+	unsigned long long config;              // perf_event_attr::config
+};
+
+// Helper function to name a cache event for perf_event_open: which cache, read accesses, misses
+constexpr unsigned long long cacheMisses(unsigned long long cache) {
+	return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+const int COUNTERS = 6;                     // Hardware counters read around each benchmark
+const counterKind counterKinds[COUNTERS] = {
+	{ "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	{ "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	{ "l1d_misses", PERF_TYPE_HW_CACHE, cacheMisses(PERF_COUNT_HW_CACHE_L1D) },
+	{ "llc_misses", PERF_TYPE_HW_CACHE, cacheMisses(PERF_COUNT_HW_CACHE_LL) },
+	{ "branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+	{ "dtlb_misses", PERF_TYPE_HW_CACHE, cacheMisses(PERF_COUNT_HW_CACHE_DTLB) }
+};
+
+// Hardware counters of this thread (Linux perf_event_open). Each is opened on its own, so one the
+// CPU lacks does not take the others down; the kernel may time-share them, and counts are scaled
+// up by how long each was actually running.
+class perfCounters {
+private:
+	int fds[COUNTERS];                      // One per counter (-1 if unavailable)
+
+public:
+	perfCounters();                         // Constructor that opens whatever counters it can
+	~perfCounters();                        // Destructor that closes them
+	bool has(int i);                        // Method to check whether counter i is being read
+	void reset();                           // Method to zero every counter
+	void enable();                          // Method to start counting
+	void disable();                         // Method to stop counting
+	double read(int i);                     // Method to read counter i since the last reset
+};
+
+// Constructor that opens each counter for this thread, user space only, stopped
+perfCounters::perfCounters() {
+	string missing;                         // Counters we could not get, for one note on stderr
+	for (int i = 0; i < COUNTERS; i++) {
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = counterKinds[i].type;
+		attr.config = counterKinds[i].config;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;            // Allowed without privileges, and the containers run in user space
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		fds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+		if (fds[i] < 0) missing += string(missing.empty() ? "" : ", ") + counterKinds[i].name + " (" + strerror(errno) + ")";
+	}
+	if (!missing.empty()) fprintf(stderr, "Hardware counters not reported: %s\n", missing.c_str());
+}
+
+// Destructor that closes every counter
+perfCounters::~perfCounters() {
+	for (int fd : fds) if (fd >= 0) close(fd);
+}
+
+// Method to check whether counter i could be opened
+bool perfCounters::has(int i) {
+	return fds[i] >= 0;
+}
+
+// Method to zero every counter (and its enabled and running times)
+void perfCounters::reset() {
+	for (int fd : fds) if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+}
+
+// Method to start counting
+void perfCounters::enable() {
+	for (int fd : fds) if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+// Method to stop counting
+void perfCounters::disable() {
+	for (int fd : fds) if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+}
+
+// Method to read counter i, scaled up for the time it was switched out (-1 if unavailable)
+double perfCounters::read(int i) {
+	unsigned long long v[3];                // Value, time enabled, time running
+	if (fds[i] < 0 || ::read(fds[i], v, sizeof(v)) != (ssize_t)sizeof(v)) return -1;
+	if (v[2] == 0) return v[2] == v[1] ? 0 : -1; // Never got onto the PMU
+	return (double)v[0] * v[1] / v[2];
+}
+
+perfCounters counters;                      // Read around every benchmark
+
+// Timing of one benchmark at one catalog size
+struct benchResult {
+	long long ops;                          // Operations timed
+	double seconds;                         // Total time they took
+	vector<double> samples;                 // Nanoseconds per operation, one per batch
+	double counted[COUNTERS];               // Hardware counter totals over the timed code (-1 if unavailable)
+};
+
+// Helper function to collect the counters' totals into a result (they were reset before it ran)
+void readCounters(benchResult& r) {
+	for (int i = 0; i < COUNTERS; i++) r.counted[i] = counters.read(i);
+}
+
+// Helper function to time run over [0, ops) in batches of BENCH_BATCH; run(first, last) does operations first..last-1
+benchResult timeBatches(long long ops, const function<void(long long, long long)>& run) {
+	benchResult r;
+	r.ops = ops;
+	r.samples.reserve(ops / BENCH_BATCH + 1);
+	counters.reset();
+	counters.enable();
+	long long start = monotonicNs();
+	for (long long first = 0; first < ops; first += BENCH_BATCH) {
+		long long last = min(ops, first + BENCH_BATCH);
+		long long t0 = monotonicNs();
+		run(first, last);
+		r.samples.push_back((double)(monotonicNs() - t0) / (last - first));
+	}
+	r.seconds = (monotonicNs() - start) / 1e9;
+	counters.disable();
+	readCounters(r);
+	return r;
+}
+
+// Helper function to print one result as a JSON line
+void report(const char* op, long long books, const char* access, benchResult& r) {
+	sort(r.samples.begin(), r.samples.end());
+	function<double(double)> at = [&](double p) { // Percentile p of the per-batch samples
+		return r.samples.empty() ? 0 : r.samples[(size_t)(p * (r.samples.size() - 1))];
+	};
+	double nsPerOp = r.ops ? r.seconds * 1e9 / r.ops : 0;
+	printf("{\"op\":\"%s\",\"books\":%lld,\"access\":\"%s\",\"ops\":%lld,\"ns_per_op\":%.1f,\"ops_per_sec\":%.0f,"
+		"\"p50_ns\":%.1f,\"p90_ns\":%.1f,\"p99_ns\":%.1f,\"p999_ns\":%.1f",
+		op, books, access, r.ops, nsPerOp, r.seconds > 0 ? r.ops / r.seconds : 0, at(0.5), at(0.9), at(0.99), at(0.999));
+	for (int i = 0; i < COUNTERS; i++) {
+		if (counters.has(i) && r.counted[i] >= 0 && r.ops) printf(",\"%s_per_op\":%.2f", counterKinds[i].name, r.counted[i] / r.ops);
+	}
+	printf("}\n");
+	fflush(stdout);
+}
+
+// Helper function to print that a benchmark was skipped at a size
+void reportSkipped(const char* op, long long books) {
+	printf("{\"op\":\"%s\",\"books\":%lld,\"skipped\":\"over %.0f s at a smaller size\"}\n", op, books, BENCH_BUDGET_SECONDS);
+	fflush(stdout);
+}
+
+// Helper function to draw count book indexes in [0, n), uniformly or Zipf distributed. Zipf ranks
+// are mapped through a random permutation, so popular books are spread over the catalog.
+vector<int> accessPattern(int n, long long count, bool zipf, mt19937_64& rng) {
+	vector<int> picks(count);
+	if (!zipf) {
+		uniform_int_distribution<int> pick(0, n - 1);
+		for (int& p : picks) p = pick(rng);
+		return picks;
+	}
+	vector<double> cdf(n);                  // Cumulative probability of ranks 0..i
+	double total = 0;
+	for (int i = 0; i < n; i++) cdf[i] = total += 1.0 / pow(i + 1.0, BENCH_ZIPF_S);
+	vector<int> book(n);                    // Rank -> book index
+	for (int i = 0; i < n; i++) book[i] = i;
+	shuffle(book.begin(), book.end(), rng);
+	uniform_real_distribution<double> u(0, total);
+	for (int& p : picks) {
+		int rank = (int)(lower_bound(cdf.begin(), cdf.end(), u(rng)) - cdf.begin());
+		p = book[min(rank, n - 1)];
+	}
+	return picks;
+}
+
+// Helper function to make n books with distinct ISBNs and titles
+vector<bookInfo*> makeCatalog(int n, mt19937_64& rng) {
+	const char* words[] = { "The", "Garden", "Winter", "River", "Secret", "History", "Last", "House", "Night", "Letters",
+		"Light", "Stone", "Journey", "Silent", "City", "Children", "Empire", "Island", "Summer", "Promise" };
+	uniform_int_distribution<int> word(0, 19), length(1, 4), copies(0, 9);
+	vector<int> ISBNs(n);                   // Distinct, at most 9 digits like the real catalog's
+	for (int i = 0; i < n; i++) ISBNs[i] = 1000000 + 13 * i;
+	shuffle(ISBNs.begin(), ISBNs.end(), rng);
+
+	vector<bookInfo*> books(n);
+	for (int i = 0; i < n; i++) {
+		string title;                       // A few words and a unique number
+		for (int w = length(rng); w > 0; w--) title += string(words[word(rng)]) + " ";
+		title += to_string(i);
+		bookInfo* b = new bookInfo;
+		b->ISBN = ISBNs[i];
+		b->title = new char[title.size() + 1];
+		strcpy(b->title, title.c_str());
+		b->author = new char[16];
+		snprintf(b->author, 16, "Author %d", i % 1000);
+		b->price = 5 + i % 95;
+		b->quantity = copies(rng);
+		books[i] = b;
+	}
+	return books;
+}
+
+// Helper function to free a catalog made by makeCatalog
+void freeCatalog(vector<bookInfo*>& books) {
+	for (bookInfo* b : books) {
+		delete[] b->title;
+		delete[] b->author;
+		delete b;
+	}
+	books.clear();
+}
+
+// Helper function to time loading a catalog of these books from CSV with LMS::LMS(), which reads
+// "Book Dataset.csv" from the working directory (a scratch directory here)
+benchResult timeLoad(const vector<bookInfo*>& books) {
+	char dir[] = "/tmp/lmsbenchXXXXXX";
+	benchResult r;
+	r.ops = books.size();
+	r.seconds = 0;
+	for (double& c : r.counted) c = -1;
+	char* home = getcwd(nullptr, 0);
+	if (!mkdtemp(dir) || chdir(dir) != 0) {
+		free(home);
+		return r;
+	}
+	FILE* f = fopen("Book Dataset.csv", "w");
+	fprintf(f, "ISBN,Title,Author,Price,Quantity\n");
+	for (bookInfo* b : books) fprintf(f, "%d,%s,%s,%.2f,%d\n", b->ISBN, b->title, b->author, b->price, b->quantity.load());
+	fclose(f);
+
+	counters.reset();
+	counters.enable();
+	long long t0 = monotonicNs();
+	{
+		LMS library;                        // Load and throw away
+	}
+	r.seconds = (monotonicNs() - t0) / 1e9;
+	counters.disable();
+	readCounters(r);
+	r.samples.push_back(r.seconds * 1e9 / max<long long>(1, r.ops)); // One sample: the whole load
+
+	unlink("Book Dataset.csv");
+	if (chdir(home) != 0) {}
+	rmdir(dir);
+	free(home);
+	return r;
+}
+
+int main(int argc, char** argv) {
+	long long maxBooks = 10000000;	//Largest catalog
+	long long ops = 1000000;	//Lookups per access pattern
+	unsigned long long seed = 42;	//Same catalogs and access streams on every run
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "--max-books") == 0) maxBooks = atoll(argv[i + 1]);
+		else if (strcmp(argv[i], "--ops") == 0) ops = atoll(argv[i + 1]);
+		else if (strcmp(argv[i], "--seed") == 0) seed = strtoull(argv[i + 1], nullptr, 10);
+		else {
+			fprintf(stderr, "Usage: bench [--max-books <n>] [--ops <n>] [--seed <n>]\n");
+			return 1;
+		}
+	}
+
+	vector<string> overBudget;	//Benchmarks too slow to run at larger sizes
+	function<bool(const char*, long long)> skip = [&](const char* op, long long n) {
+		if (find(overBudget.begin(), overBudget.end(), op) == overBudget.end()) return false;
+		reportSkipped(op, n);
+		return true;
+	};
+	function<void(const char*, long long, const char*, benchResult&)> record = [&](const char* op, long long n, const char* access, benchResult& r) {
+		report(op, n, access, r);
+		if (r.seconds > BENCH_BUDGET_SECONDS) overBudget.push_back(op);
+	};
+
+	for (long long n = 1000; n <= maxBooks; n *= 10) {
+		mt19937_64 rng(seed + n);
+		vector<bookInfo*> books = makeCatalog((int)n, rng);
+
+		hashTable byISBN((int)n);	//Sized for the catalog, as the library sizes it
+		benchResult r = timeBatches(n, [&](long long first, long long last) {
+			for (long long i = first; i < last; i++) byISBN.insert(books[i]);
+		});
+		record("hashTable::insert", n, "build", r);
+
+		AVL byTitle;
+		r = timeBatches(n, [&](long long first, long long last) {
+			for (long long i = first; i < last; i++) byTitle.insert(books[i]);
+		});
+		record("AVL::insert", n, "build", r);
+
+		for (int zipf = 0; zipf < 2; zipf++) {
+			const char* access = zipf ? "zipf" : "uniform";
+			vector<int> picks = accessPattern((int)n, ops, zipf, rng);
+			volatile long long sink = 0;	//Keeps lookups from being optimized away
+
+			r = timeBatches(ops, [&](long long first, long long last) {
+				long long sum = 0;
+				for (long long i = first; i < last; i++) sum += byISBN.get(books[picks[i]]->ISBN)->quantity.load(memory_order_relaxed);
+				sink = sink + sum;	//One volatile write per batch
+			});
+			record("hashTable::get", n, access, r);
+
+			r = timeBatches(ops, [&](long long first, long long last) {
+				long long sum = 0;
+				for (long long i = first; i < last; i++) sum += byTitle.retrieve(books[picks[i]]->title)->ISBN;
+				sink = sink + sum;	//One volatile write per batch
+			});
+			record("AVL::retrieve", n, access, r);
+
+			if (!skip("AVL::remove", n)) {	//Each batch is put back (untimed) so the tree keeps its size
+				benchResult removed;
+				removed.ops = 0;
+				removed.seconds = 0;
+				long long removeOps = min(ops, n * 10);
+				counters.reset();
+				for (long long first = 0; first < removeOps; first += BENCH_BATCH) {
+					long long last = min(removeOps, first + BENCH_BATCH);
+					counters.enable();  // Count the removals, not putting them back
+					long long t0 = monotonicNs();
+					for (long long i = first; i < last; i++) byTitle.remove(books[picks[i]]->title);
+					long long took = monotonicNs() - t0;
+					counters.disable();
+					for (long long i = first; i < last; i++) byTitle.insert(books[picks[i]]);
+					removed.samples.push_back((double)took / (last - first));
+					removed.seconds += took / 1e9;
+					removed.ops += last - first;
+				}
+				readCounters(removed);
+				record("AVL::remove", n, access, removed);
+			}
+		}
+
+		{
+			vector<int> picks = accessPattern((int)n, ops, false, rng);
+			vector<int> missingISBNs(ops);	//Between the catalog's ISBNs, which are 13 apart
+			vector<string> missingTitles(ops);	//A real title with a character added
+			for (long long i = 0; i < ops; i++) {
+				missingISBNs[i] = books[picks[i]]->ISBN + 1 + (int)(i % 12);
+				missingTitles[i] = string(books[picks[i]]->title) + "?";
+			}
+			volatile long long sink = 0;	//Keeps lookups from being optimized away
+			r = timeBatches(ops, [&](long long first, long long last) {
+				long long sum = 0;
+				for (long long i = first; i < last; i++) sum += byISBN.get(missingISBNs[i]) != nullptr;
+				sink = sink + sum;	//One volatile write per batch
+			});
+			record("hashTable::get", n, "miss", r);
+			r = timeBatches(ops, [&](long long first, long long last) {
+				long long sum = 0;
+				for (long long i = first; i < last; i++) sum += byTitle.retrieve(missingTitles[i].c_str()) != nullptr;
+				sink = sink + sum;	//One volatile write per batch
+			});
+			record("AVL::retrieve", n, "miss", r);
+		}
+
+		{
+			priceIndex byPrice;
+			r = timeBatches(n, [&](long long first, long long last) {
+				for (long long i = first; i < last; i++) byPrice.insert(books[i]);
+			});
+			record("priceIndex::insert", n, "build", r);
+			uniform_int_distribution<int> from(0, 80);	//Catalog prices run from $5 to $99
+			vector<int> lows(ops);
+			for (long long i = 0; i < ops; i++) lows[i] = from(rng);
+			volatile long long sink = 0;
+			r = timeBatches(ops, [&](long long first, long long last) {
+				long long sum = 0;
+				for (long long i = first; i < last; i++) {
+					int listed = 0;
+					byPrice.forEachIn(lows[i], lows[i] + 20, true, [&](bookInfo* b) { sum += b->ISBN; return ++listed < SEARCH_LIMIT; });
+				}
+				sink = sink + sum;	//One volatile write per batch
+			});
+			record("priceIndex::forEachIn", n, "page", r);
+			r = timeBatches(min(ops, 1000000000LL / n), [&](long long first, long long last) {
+				long long sum = 0;
+				for (long long i = first; i < last; i++) byPrice.forEachIn(lows[i], lows[i] + 20, true, [&](bookInfo*) { sum += 1; return true; });
+				sink = sink + sum;	//One volatile write per batch
+			});
+			record("priceIndex::forEachIn", n, "count", r);
+			for (bookInfo* b : books) b->stockMirror = nullptr;	//The index is going; the books stay
+		}
+
+		if (!skip("sortedList::get", n)) {	//The whole catalog in one list: a hash table slot's walk, n long
+			vector<bookInfo*> sorted(books);
+			sort(sorted.begin(), sorted.end(), [](bookInfo* a, bookInfo* b) { return a->ISBN > b->ISBN; });
+			sortedList byISBNList;
+			for (bookInfo* b : sorted) byISBNList.insert(b);	//Highest ISBN first, so each insert is at the head
+			long long listOps = min(ops, 1000000000LL / n);	//Each get walks half the list or so
+			const char* accesses[] = { "uniform", "zipf", "miss" };
+			volatile long long sink = 0;	//Keeps lookups from being optimized away
+			for (int a = 0; a < 3; a++) {
+				vector<int> picks = accessPattern((int)n, listOps, a == 1, rng);
+				vector<int> keys(listOps);	//Catalog ISBNs, or (miss) ones between them
+				for (long long i = 0; i < listOps; i++) keys[i] = books[picks[i]]->ISBN + (a == 2 ? 1 + (int)(i % 12) : 0);
+				r = timeBatches(listOps, [&](long long first, long long last) {
+					long long sum = 0;
+					for (long long i = first; i < last; i++) sum += byISBNList.get(keys[i]) != nullptr;
+					sink = sink + sum;	//One volatile write per batch
+				});
+				record("sortedList::get", n, accesses[a], r);
+			}
+		}
+
+		Q reservations;	//Queue and stack don't look anything up, so they only run in order
+		r = timeBatches(n, [&](long long first, long long last) {
+			for (long long i = first; i < last; i++) reservations.enqueue((int)i);
+		});
+		record("Q::enqueue", n, "sequential", r);
+		r = timeBatches(n, [&](long long first, long long last) {
+			for (long long i = first; i < last; i++) reservations.dequeue();
+		});
+		record("Q::dequeue", n, "sequential", r);
+
+		stack recent;
+		r = timeBatches(n, [&](long long first, long long last) {
+			for (long long i = first; i < last; i++) recent.push(books[i]);
+		});
+		record("stack::push", n, "sequential", r);
+		r = timeBatches(n, [&](long long first, long long last) {
+			for (long long i = first; i < last; i++) recent.pop();
+		});
+		record("stack::pop", n, "sequential", r);
+
+		if (!skip("LMS::LMS", n)) {
+			r = timeLoad(books);
+			record("LMS::LMS", n, "csv", r);
+		}
+		freeCatalog(books);
+	}
+	return 0;
+}
@@ -1,5 +1,17 @@
 #pragma once
+#include <atomic>
+#include <mutex>
 #include "Queue.h"
+#include "ConcurrentQueue.h"
+
+// Reservation queue type; build with LMS_CONCURRENT_RESERVATIONS for the ticket-ordered queue that
+// needs no book lock (ConcurrentQueue.h). It is opt-in: its producers and consumers wait their turn
+// by spinning, which beats the lock only while there are cores for everyone waiting.
+#ifdef LMS_CONCURRENT_RESERVATIONS
+typedef cQ reservationQueue;
+#else
+typedef Q reservationQueue;
+#endif
 
 // Structure for book information
 struct bookInfo {
@@ -7,8 +19,10 @@ struct bookInfo {
 	char* title;                    // Character pointer for the book title
 	char* author;                   // Character pointer for the book author
 	double price;                   // Double for the price of the book
-	int quantity;                   // Integer for the quantity of the book
-	Q reservations;                 // Queue for reservation requests
+	atomic<int> quantity;           // Copies on the shelf (changed without locks by takeCopy/putCopy)
+	atomic<int>* stockMirror;       // The price index's copy of quantity (PriceIndex.h), changed just after it, so briefly stale (nullptr if not indexed)
+	reservationQueue reservations;  // Queue for reservation requests
+	mutex lock;                     // Guards reservations (unless their queue orders itself) and hand-offs of returned copies
 
 	bookInfo() {                    // Default constructor
 		ISBN = -1;                  // Set default ISBN to -1
@@ -16,6 +30,37 @@ struct bookInfo {
 		author = nullptr;           // Set default author to null
 		price = -1;                 // Set default price to -1
 		quantity = 0;               // Set default quantity to 0
+		stockMirror = nullptr;      // Not in a price index yet
+	}
+
+	bool takeCopy() {               // Method to take a copy off the shelf if one is there
+		int q = quantity.load();    // Copies we think are left
+		while (q > 0) {             // Retry until we take one or none are left
+			if (quantity.compare_exchange_weak(q, q - 1)) {
+				if (stockMirror) stockMirror->fetch_sub(1, memory_order_relaxed);
+				return true;
+			}
+		}
+		return false;               // Out of stock
+	}
+
+	void putCopy() {                // Method to put a copy back on the shelf
+		quantity.fetch_add(1);      // Available to the next borrower at once
+		if (stockMirror) stockMirror->fetch_add(1, memory_order_relaxed);
+	}
+
+	void addCopies(int n) {         // Method to add (or, if n < 0, take) copies whatever is on the shelf (log replay)
+		quantity.fetch_add(n);
+		if (stockMirror) stockMirror->fetch_add(n, memory_order_relaxed);
+	}
+
+	void setQuantity(int n) {       // Method to set the copies on the shelf (snapshot restore)
+		quantity = n;
+		if (stockMirror) stockMirror->store(n, memory_order_relaxed);
+	}
+
+	unique_lock<mutex> reservationGuard() { // Method to lock the reservations if their queue needs it
+		return reservationQueue::selfOrdered ? unique_lock<mutex>() : unique_lock<mutex>(lock);
 	}
 
 	void print() {                  // Method to print book information
@@ -0,0 +1,57 @@
+/*
+Library Management System client
+- Usage: client <address> [request ...]
+	- address is a Unix socket path, a TCP port on this machine, or host:port
+	- Sends each request given on the command line, or each line of stdin if there are none
+	- Prints each response (see Protocol.h for the commands)
+*/
+#include <iostream>
+#include <string>
+#include "Server.h"
+using namespace std;
+
+// Helper function to send one request and print its response; returns false if the server went away
+bool ask(int fd, const string& request, string& pending) {
+	string line = request + "\n";
+	if (send(fd, line.data(), line.size(), MSG_NOSIGNAL) != (ssize_t)line.size()) return false;
+
+	char buf[4096];                // Read buffer
+	while (true) {
+		size_t end = pending.find("\n\n"); // A blank line ends the response
+		if (end != string::npos) {
+			cout << pending.substr(0, end + 1);
+			pending.erase(0, end + 2);
+			return true;
+		}
+		ssize_t n = recv(fd, buf, sizeof(buf), 0);
+		if (n <= 0) return false;  // Server closed the connection
+		pending.append(buf, n);
+	}
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		cerr << "Usage: " << argv[0] << " <socket path | port | host:port> [request ...]" << endl;
+		return 2;
+	}
+	int fd = dialAddress(argv[1]);	//Connect to the server
+	if (fd < 0) {
+		cerr << "Could not connect to " << argv[1] << endl;
+		return 1;
+	}
+
+	string pending;	//Response bytes not printed yet
+	bool ok = true;
+	if (argc > 2) {	//Requests on the command line
+		for (int i = 2; ok && i < argc; i++) ok = ask(fd, argv[i], pending);
+	}
+	else {	//Requests on stdin, one per line
+		string line;
+		while (ok && getline(cin, line)) {
+			if (!line.empty()) ok = ask(fd, line, pending);
+		}
+	}
+	close(fd);
+	if (!ok) cerr << "Connection lost" << endl;
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,247 @@
+/*
+Synthetic catalog generator
+- Usage: gencatalog [--books <n>] [--seed <n>] [--duplicate-titles <fraction>] [--isbn13]
+                    [--snapshot <path> [--patrons <n>]] [--out <file>]
+	- Writes a catalog in the schema of "Book Dataset.csv" (to stdout unless --out is given);
+	  the same seed always gives the same catalog
+	- Titles have a long-tailed number of words, some with subtitles, commas (quoted) or
+	  quotation marks ("" inside quotes); --duplicate-titles of them (default 0.02) repeat an
+	  earlier title, like new editions of a book
+	- Authors are drawn Zipf-like from a pool, so a few write many books and most write one
+	- ISBNs are distinct 9 digit numbers, the widest the library keeps (an ISBN-13 less its
+	  978 prefix and check digit); --isbn13 writes the full ISBN-13s instead, for other tools
+	- --snapshot also writes a checkpoint in the format LMS::writeSnapshot uses, with --patrons
+	  patrons (default 0) borrowing popular books and queueing for those out of stock. Name it
+	  <log>.snap and start the library with --log <log> to load it.
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <cmath>
+#include <random>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <unordered_set>
+#include "LMS.h"
+using namespace std;
+
+const long long ISBN_SPACE = 900000000;    // 9 digit ISBNs: 100000000 + [0, ISBN_SPACE)
+const int RECENT_TITLES = 4096;            // Titles a duplicate may copy
+
+// Words titles are made of, most common first
+const char* titleWords[] = { "The", "of", "and", "A", "in", "to", "Life", "Love", "World", "History", "Story", "Book", "Guide",
+	"New", "Last", "Night", "House", "Time", "Secret", "Man", "Woman", "Girl", "Boy", "War", "Day", "Little", "Dark",
+	"Heart", "City", "Home", "Light", "Death", "Great", "Art", "Summer", "Winter", "Family", "Garden", "River", "Road",
+	"Lost", "Blood", "Fire", "King", "Queen", "Children", "Sea", "Water", "Island", "Mountain", "Journey", "Dream",
+	"Shadow", "Star", "Moon", "Sun", "Letters", "Stone", "Empire", "Promise", "Silent", "Wild", "Golden", "Black",
+	"White", "Red", "Blue", "Green", "Cooking", "Kitchen", "Food", "Science", "Mind", "Power", "Business", "Money",
+	"Canada", "England", "America", "Paris", "London", "Ocean", "Forest", "Bird", "Dog", "Cat", "Horse", "Christmas",
+	"Music", "Dance", "Poems", "Tales", "Voices", "Memoir", "Encyclopedia", "Handbook", "Introduction", "Adventures",
+	"Mystery", "Murder", "Ghost", "Spirit", "Angel", "Devil", "Truth", "Lies", "Freedom", "Courage", "Wonder" };
+const char* firstNames[] = { "John", "Mary", "James", "Helen", "Robert", "Margaret", "Michael", "Judith", "David", "Susan",
+	"William", "Alice", "Richard", "Carol", "Thomas", "Anne", "Charles", "Ruth", "Stephen", "Elizabeth", "Peter", "Jane",
+	"George", "Sarah", "Paul", "Emily", "Mark", "Laura", "Kenneth", "Joan", "Geoffrey", "Lawrence", "Rohinton", "Yann",
+	"Timothy", "Alistair", "Miriam", "Farley", "Lucy" };
+const char* lastNames[] = { "Smith", "Brown", "Wilson", "Taylor", "Johnson", "White", "Martin", "Anderson", "Thompson",
+	"Walker", "Harris", "Young", "King", "Wright", "Scott", "Green", "Baker", "Adams", "Nelson", "Hill", "Campbell",
+	"Mitchell", "Roberts", "Carter", "Phillips", "Evans", "Turner", "Torres", "Parker", "Collins", "Edwards", "Stewart",
+	"Morris", "Murphy", "Cook", "Rogers", "Morgan", "Cooper", "Peterson", "Kerr", "Fry", "Forrester", "Atwood", "Mistry",
+	"Munro", "Findley", "Ondaatje", "Richler", "Davies", "Laurence", "McGoogan", "Wansell", "Shields", "MacLeod" };
+
+// Table for drawing ranks 0..n-1 with probability proportional to 1 / (rank + 1)^s
+class zipfTable {
+private:
+	vector<double> cdf;            // Cumulative weight of ranks 0..i
+
+public:
+	zipfTable(int n, double s);    // Constructor that builds the table
+	int draw(mt19937_64& rng);     // Method to draw one rank
+};
+
+// Constructor that sums the weights of every rank
+zipfTable::zipfTable(int n, double s) : cdf(max(n, 1)) {
+	double total = 0;
+	for (size_t i = 0; i < cdf.size(); i++) cdf[i] = total += 1.0 / pow(i + 1.0, s);
+}
+
+// Method to draw a rank by binary search on the cumulative weights
+int zipfTable::draw(mt19937_64& rng) {
+	uniform_real_distribution<double> u(0, cdf.back());
+	return min((int)(lower_bound(cdf.begin(), cdf.end(), u(rng)) - cdf.begin()), (int)cdf.size() - 1);
+}
+
+// Helper function to write a CSV field, quoting it if it holds a comma or a quote
+void writeField(FILE* f, const string& s) {
+	if (s.find_first_of(",\"") == string::npos) {
+		fputs(s.c_str(), f);
+		return;
+	}
+	fputc('"', f);
+	for (char c : s) {
+		if (c == '"') fputc('"', f); // A quote inside quotes is doubled
+		fputc(c, f);
+	}
+	fputc('"', f);
+}
+
+// Helper function to make the 9 digit body of book i's ISBN; an affine map with a multiplier
+// coprime to ISBN_SPACE is a permutation, so bodies are distinct and scattered
+long long isbnBody(long long i, long long mul, long long add) {
+	return 100000000 + (i * mul + add) % ISBN_SPACE;
+}
+
+// Helper function to make a full ISBN-13 (978, the body, and the check digit)
+string isbn13(long long body) {
+	string digits = "978" + to_string(body);
+	int sum = 0;
+	for (int i = 0; i < 12; i++) sum += (digits[i] - '0') * (i % 2 ? 3 : 1);
+	return digits + char('0' + (10 - sum % 10) % 10);
+}
+
+// Helper function to make a title of a long-tailed number of words
+string makeTitle(mt19937_64& rng, zipfTable& words) {
+	lognormal_distribution<double> length(1.3, 0.45); // Median about 4 words, now and then 10 or more
+	uniform_real_distribution<double> u(0, 1);
+	int n = max(1, min(30, (int)length(rng)));
+	string title;
+	int last = -1;                 // Previous word, not repeated back to back
+	for (int i = 0; i < n; i++) {
+		int w = words.draw(rng);
+		if (w == last) w = (w + 1 + rng() % 20) % (sizeof(titleWords) / sizeof(*titleWords));
+		title += string(i ? " " : "") + titleWords[w];
+		last = w;
+	}
+	double style = u(rng);
+	if (style < 0.25) {            // Subtitle
+		title += ": ";
+		int m = max(1, min(12, (int)length(rng)));
+		for (int i = 0; i < m; i++) title += string(i ? " " : "") + titleWords[words.draw(rng)];
+	}
+	else if (style < 0.33) title += string(", ") + titleWords[words.draw(rng)]; // Comma, so it is quoted
+	else if (style < 0.34) title = "The \"" + title + "\" Years"; // Quotation marks, doubled in the file
+	title[0] = toupper((unsigned char)title[0]);
+	return title;
+}
+
+// Helper function to make author k of the pool (the same k always gives the same name)
+string makeAuthor(long long k) {
+	int firsts = sizeof(firstNames) / sizeof(*firstNames), lasts = sizeof(lastNames) / sizeof(*lastNames);
+	string name = firstNames[k % firsts];
+	if (k / firsts % 3 == 0) name += string(" ") + char('A' + k % 26) + "."; // Middle initial
+	name += string(" ") + lastNames[k / firsts % lasts];
+	if (k >= (long long)firsts * lasts) name += " " + to_string(k / ((long long)firsts * lasts) + 1); // Keeps names distinct in big pools
+	if (k % 97 == 96) name += " (editor)";
+	return name;
+}
+
+int main(int argc, char** argv) {
+	long long books = 100000;	//Catalog size
+	unsigned long long seed = 1;	//Same catalog on every run
+	double duplicates = 0.02;	//Share of titles repeating an earlier one
+	bool longISBNs = false;	//Write ISBN-13s
+	long long patrons = 0;	//Patrons in the snapshot
+	const char* outPath = nullptr;	//CSV file (stdout if none)
+	const char* snapPath = nullptr;	//Snapshot file (none if not given)
+	for (int i = 1; i < argc; i++) {
+		string opt = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (opt == "--isbn13") longISBNs = true;
+		else if (opt == "--books" && hasValue) books = atoll(argv[++i]);
+		else if (opt == "--seed" && hasValue) seed = strtoull(argv[++i], nullptr, 10);
+		else if (opt == "--duplicate-titles" && hasValue) duplicates = atof(argv[++i]);
+		else if (opt == "--patrons" && hasValue) patrons = atoll(argv[++i]);
+		else if (opt == "--out" && hasValue) outPath = argv[++i];
+		else if (opt == "--snapshot" && hasValue) snapPath = argv[++i];
+		else {
+			fprintf(stderr, "Usage: gencatalog [--books <n>] [--seed <n>] [--duplicate-titles <fraction>] [--isbn13]\n"
+				"                  [--snapshot <path> [--patrons <n>]] [--out <file>]\n");
+			return 2;
+		}
+	}
+	if (books < 1 || books > ISBN_SPACE) {
+		fprintf(stderr, "--books must be between 1 and %lld\n", ISBN_SPACE);
+		return 2;
+	}
+
+	mt19937_64 rng(seed);
+	long long mul = rng() % ISBN_SPACE | 1;	//Odd, and not a multiple of 3 or 5, so coprime to ISBN_SPACE
+	while (mul % 3 == 0 || mul % 5 == 0) mul += 2;
+	long long add = rng() % ISBN_SPACE;
+	zipfTable words(sizeof(titleWords) / sizeof(*titleWords), 0.7);
+	zipfTable authors((int)min(books / 4 + 1, 2000000LL), 0.9);	//About four books per author
+	lognormal_distribution<double> price(3.0, 0.6);	//Median near $20
+	geometric_distribution<int> copies(0.3);	//Mostly a few copies, now and then many
+	uniform_real_distribution<double> u(0, 1);
+
+	FILE* out = outPath ? fopen(outPath, "w") : stdout;
+	if (!out) {
+		perror(outPath);
+		return 1;
+	}
+	vector<string> recent;	//Titles a duplicate may copy
+	vector<unsigned char> quantity(books);	//Copies of each book, for the snapshot
+	fprintf(out, "ISBN,Title,Author,Price,Quantity\n");
+	for (long long i = 0; i < books; i++) {
+		string title;
+		if (!recent.empty() && u(rng) < duplicates) title = recent[rng() % recent.size()];
+		else {
+			title = makeTitle(rng, words);
+			if (recent.size() < RECENT_TITLES) recent.push_back(title);
+			else recent[rng() % RECENT_TITLES] = title;
+		}
+		long long body = isbnBody(i, mul, add);
+		quantity[i] = (unsigned char)min(copies(rng), 50);
+		if (longISBNs) fputs(isbn13(body).c_str(), out);
+		else fprintf(out, "%lld", body);
+		fputc(',', out);
+		writeField(out, title);
+		fputc(',', out);
+		writeField(out, makeAuthor(authors.draw(rng)));
+		fprintf(out, ",%.2f,%d\n", floor(max(1.0, min(price(rng), 500.0))) + 0.99, quantity[i]);
+	}
+	if (outPath && fclose(out) != 0) {
+		perror(outPath);
+		return 1;
+	}
+	if (!snapPath) return 0;
+
+	FILE* snap = fopen(snapPath, "w");	//Same format LMS::dumpState writes
+	if (!snap) {
+		perror(snapPath);
+		return 1;
+	}
+	long long now = time(nullptr);
+	fprintf(snap, "SNAPSHOT 0 %lld\n", now);
+	zipfTable popular((int)min(books, 10000000LL), 0.9);	//Patrons mostly want the popular books
+	vector<long long> order(min(books, 10000000LL));	//Rank -> book, so popularity is scattered over the catalog
+	for (size_t r = 0; r < order.size(); r++) order[r] = r;
+	shuffle(order.begin(), order.end(), rng);
+	vector<string> waiting;	//QUEUE lines, in the order patrons joined
+	vector<int> inLine(order.size(), 0);	//Patrons queued for each book
+	for (long long p = 0; p < patrons; p++) {
+		string name = "patron" + to_string(p);
+		unordered_set<long long> has;	//Books this patron already has out or is queued for
+		int wants = 1 + (int)(rng() % MAX_LOANS);
+		for (int k = 0; k < wants; k++) {
+			long long b = order[popular.draw(rng)];
+			if (!has.insert(b).second) continue;
+			long long body = isbnBody(b, mul, add);
+			if (quantity[b] > 0) {
+				quantity[b]--;
+				long long due = now + LOAN_SECONDS - (long long)(rng() % (LOAN_SECONDS + 7 * 24 * 3600)); // Some overdue
+				fprintf(snap, "LOAN %lld %lld %s\n", due, body, name.c_str());
+			}
+			else waiting.push_back("QUEUE " + to_string(inLine[b]++) + " " + to_string(body) + " " + name);
+		}
+	}
+	for (string& w : waiting) fprintf(snap, "%s\n", w.c_str());
+	for (long long i = 0; i < books; i++) fprintf(snap, "STOCK %d %lld\n", quantity[i], isbnBody(i, mul, add));
+	fprintf(snap, "END\n");
+	if (fclose(snap) != 0) {
+		perror(snapPath);
+		return 1;
+	}
+	return 0;
+}
@@ -12,12 +12,164 @@ Library Management System
 - Any one search mechanism and state it (e.g. binary search, linear search)
 
 Learning Outcome: Understanding how different data structures may be used
+
+Usage:
+	Project1                              Interactive session for one user
+	Project1 --serve <address> [workers]  Serve the request protocol (Protocol.h) on a
+	                                      Unix socket path or TCP port; see client.cpp
+	Project1 --serve-async <address> [threads]
+	                                      Same protocol, served by coroutine sessions on
+	                                      event loop threads (needs a C++20 build)
+	Project1 --batch [file]               Run protocol requests from a file (or stdin)
+	                                      without prompts and print every response
+	Project1 --shard <k>/<n> <address> [workers]
+	                                      Serve shard k of n: only the books ownerShard()
+	                                      gives it (Protocol.h)
+	Project1 --router <address> <shard 0 address> ... <shard n-1 address>
+	                                      Serve the protocol by forwarding to the shards
+	Any mode but --router also takes --log <file>: changes are written ahead to the file
+	(replayed first if it exists), so loans, holds and reservations survive a restart.
+	Every so often the library is snapshotted to <file>.snap in the background and the
+	log it covers is deleted, so a restart only replays changes since the last snapshot.
+	Any mode but --router and --replica also takes --replicate <address>: the process is a
+	primary, and replicas connecting on that address get a copy of its state and then
+	every change as it happens (Replication.h).
+	Project1 --replica <primary's replication address> <address> [workers]
+	                                      Follow a primary and serve its data read only
+	Any mode but --router also takes --trace <file>: in a build with -DLMS_TRACE, the
+	containers' recent probes go to the file as a Chrome trace on a TRACE request and
+	when a batch or interactive session ends (Trace.h).
+	Any mode but --router also takes --record <file>: every request is written to the file as
+	a compact workload trace (Workload.h) that replay.cpp can play back against any build. The
+	trace starts with the library's state once the log (or the primary) has been caught up on,
+	so a replay starts where the recording did.
 */
 #include "LMS.h"
+#include "Server.h"
+#include "AsyncServer.h"
+#include "Batch.h"
+#include "Router.h"
+
+int main(int argc, char** argv) {
+	const char* logPath = nullptr;	//Write-ahead log (none unless --log is given)
+	const char* replicateOn = nullptr;	//Where replicas connect (none unless --replicate is given)
+	const char* tracePath = nullptr;	//Where the containers' trace goes (none unless --trace is given)
+	const char* recordPath = nullptr;	//Where every request is recorded (none unless --record is given)
+	for (int i = 1; i + 1 < argc; i++) {
+		const char** option = strcmp(argv[i], "--log") == 0 ? &logPath : strcmp(argv[i], "--replicate") == 0 ? &replicateOn :
+			strcmp(argv[i], "--trace") == 0 ? &tracePath : strcmp(argv[i], "--record") == 0 ? &recordPath : nullptr;
+		if (option) {
+			*option = argv[i + 1];
+			for (int j = i; j + 2 <= argc; j++) argv[j] = argv[j + 2];	//Remove it so the other options see their usual positions
+			argc -= 2;
+			i--;	//Look at whatever moved into this position
+		}
+	}
+
+	if (argc >= 4 && strcmp(argv[1], "--router") == 0) {	//Router mode: no catalog of its own
+		shardRouter router(vector<string>(argv + 3, argv + argc));	//Shards in order
+		workStealingPool relays(2 * (argc - 3));	//Enough threads to keep every shard busy
+		lmsServer server(router, relays);
+		if (!server.listenOn(argv[2])) {
+			cerr << "Could not listen on " << argv[2] << endl;
+			return 1;
+		}
+		server.run();	//Serve until killed
+		return 0;
+	}
+
+	int shard = 0, shards = 1;	//Which part of the catalog to load (all of it by default)
+	if (argc >= 4 && strcmp(argv[1], "--shard") == 0) {	//Shard mode
+		if (sscanf(argv[2], "%d/%d", &shard, &shards) != 2 || shards < 1 || shard < 0 || shard >= shards) {
+			cerr << "Expected --shard <k>/<n> with 0 <= k < n" << endl;
+			return 1;
+		}
+		argv[2] = argv[1];	//From here on it is served like --serve <address> [workers]
+		argv++;
+		argc--;
+	}
+	LMS SMU_CS_Library(nullptr, shard, shards);	//Open a library
+	if (tracePath) SMU_CS_Library.traceTo(tracePath);	//TRACE requests (and leaving batch or interactive mode) write here
+	bool replica = argc >= 4 && strcmp(argv[1], "--replica") == 0;	//Replica mode: the primary supplies every change
+	if (replica && !SMU_CS_Library.follow(argv[2])) {
+		cerr << "Could not copy the primary at " << argv[2] << endl;
+		return 1;
+	}
+	if (!replica && logPath && !SMU_CS_Library.openLog(logPath)) {	//Bring back everything that changed since the catalog was written
+		cerr << "Could not open log " << logPath << endl;
+		return 1;
+	}
+	if (!replica && replicateOn && !SMU_CS_Library.serveReplicas(replicateOn)) {	//Ship every change from here on
+		cerr << "Could not listen for replicas on " << replicateOn << endl;
+		return 1;
+	}
+	if (recordPath && !SMU_CS_Library.recordTo(recordPath)) {	//Keep every request for replay.cpp, starting from the state reached above
+		cerr << "Could not create " << recordPath << endl;
+		return 1;
+	}
+
+	if (replica) {
+		workStealingPool workers(argc >= 5 ? atoi(argv[4]) : 4);	//Threads for requests and the catalog-wide scans they start
+		SMU_CS_Library.useWorkers(&workers);
+		lmsServer server(SMU_CS_Library, workers);	//Reads scale out across replicas
+		if (!server.listenOn(argv[3])) {
+			cerr << "Could not listen on " << argv[3] << endl;
+			return 1;
+		}
+		server.run();	//Serve until killed
+		return 0;
+	}
+
+	if (argc >= 3 && (strcmp(argv[1], "--serve") == 0 || strcmp(argv[1], "--shard") == 0)) {	//Server mode
+		workStealingPool workers(argc >= 4 ? atoi(argv[3]) : 4);	//Threads for requests and the catalog-wide scans they start
+		SMU_CS_Library.useWorkers(&workers);
+		lmsServer server(SMU_CS_Library, workers);	//Share the library with every client
+		if (!server.listenOn(argv[2])) {
+			cerr << "Could not listen on " << argv[2] << endl;
+			return 1;
+		}
+		server.run();	//Serve until killed
+		return 0;
+	}
+
+	if (argc >= 3 && strcmp(argv[1], "--serve-async") == 0) {	//Coroutine server mode
+#if defined(__cpp_impl_coroutine)
+		workStealingPool scanners;	//Threads for catalog-wide scans
+		SMU_CS_Library.useWorkers(&scanners);
+		asyncServer server(SMU_CS_Library, argc >= 4 ? atoi(argv[3]) : 2);	//A few threads for every client
+		if (!server.listenOn(argv[2])) {
+			cerr << "Could not listen on " << argv[2] << endl;
+			return 1;
+		}
+		server.run();	//Serve until killed
+		return 0;
+#else
+		cerr << "--serve-async needs a C++20 build (-std=c++20)" << endl;
+		return 1;
+#endif
+	}
+
+	if (argc >= 2 && strcmp(argv[1], "--batch") == 0) {	//Batch mode
+		workStealingPool workers;	//Threads for runs of queries and catalog-wide scans
+		SMU_CS_Library.useWorkers(&workers);
+		if (argc >= 3) {	//Requests from a file
+			ifstream requests(argv[2]);
+			if (!requests.is_open()) {
+				cerr << "Could not open " << argv[2] << endl;
+				return 1;
+			}
+			runBatch(SMU_CS_Library, requests, stdout, &workers);
+		}
+		else {	//Requests from stdin
+			ios::sync_with_stdio(false);	//Let cin read in large blocks
+			runBatch(SMU_CS_Library, cin, stdout, &workers);
+		}
+		SMU_CS_Library.dumpTrace();	//Everything the run did (if tracing)
+		return 0;
+	}
 
-int main() {
-	LMS SMU_CS_Library;	//Open a library
 	SMU_CS_Library.interface();	//Interact with the library
+	SMU_CS_Library.dumpTrace();	//Everything the session did (if tracing)
 
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,152 @@
+/*
+Library Management System workload replay
+- Usage: replay <trace> [--threads <n>] [--speed <x>]
+	- Plays a workload trace (written by Project1 --record <file>, see Workload.h) against a
+	  freshly loaded library, so the same day's traffic can be timed on every build. The library
+	  first takes on the state the trace starts from (whatever the recording one had caught up on
+	  from its log or primary), on a clock set back to when recording began, so holds and loans
+	  fall due at the same points in the traffic as they did
+	- --threads splits the requests across n threads (default 1); a user's requests all go to
+	  the same thread, so each user's borrows, returns and reservations keep their order
+	- --speed 0 (the default) sends every request as soon as the last one is answered; --speed 1
+	  keeps the recorded gaps, 2 halves them, and so on. When paced, a request sent late has its
+	  latency measured from when it was due, so falling behind shows up as latency
+	- Prints one JSON object per line: one per kind of request, then the totals:
+	  {"op":"borrow","requests":1200,"err_responses":31,"p50_ns":2303,"p99_ns":9471,"p999_ns":20735,"max_ns":40959}
+	  {"op":"all","requests":50000,...,"threads":4,"speed":0,"seconds":0.21,"requests_per_sec":238095}
+	  Percentiles are taken from latency histograms (Stats.h), so each is within about 3%
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include "LMS.h"
+using namespace std;
+
+// Requests one thread replays, and what it saw
+struct replayer {
+	vector<workloadRequest> requests; // In recorded order
+	vector<string> lines;          // Request lines, rebuilt before the clock starts
+	latencyHistogram latency[WORK_OPS]; // Latency of each kind of request
+	long long errors[WORK_OPS];    // Responses that were "ERR ..."
+	thread worker;                 // Thread sending them
+};
+
+// Helper function to send one thread's requests, paced or flat out
+void replay(LMS& library, replayer& r, long long start, double speed) {
+	string out;                    // Response to the current request
+	for (size_t i = 0; i < r.requests.size(); i++) {
+		long long t0 = monotonicNs();
+		if (speed > 0) {           // Wait for the request's time; if already late, count latency from then
+			long long due = start + (long long)(r.requests[i].at / speed);
+			if (due > t0) {
+				this_thread::sleep_for(chrono::nanoseconds(due - t0));
+				t0 = monotonicNs(); // Oversleeping is not the library's doing
+			}
+			else t0 = due;
+		}
+		out.clear();
+		library.handle(r.lines[i].c_str(), out);
+		r.latency[r.requests[i].op].record(monotonicNs() - t0);
+		if (out.compare(0, 3, "ERR") == 0) r.errors[r.requests[i].op]++;
+	}
+}
+
+// Helper function to find the latency a fraction p of the requests came in under
+long long percentile(const vector<unsigned long long>& buckets, unsigned long long n, double p) {
+	unsigned long long rank = (unsigned long long)(p * n + 0.999999); // Requests at or below the percentile
+	if (rank < 1) rank = 1;
+	unsigned long long seen = 0;
+	for (int b = 0; b < LATENCY_BUCKETS; b++) {
+		seen += buckets[b];
+		if (seen >= rank) return latencyHistogram::bucketTop(b);
+	}
+	return 0;
+}
+
+// Helper function to print one kind of request's line (without its closing brace)
+void report(const char* op, const vector<unsigned long long>& buckets, long long errors) {
+	unsigned long long n = 0;
+	for (unsigned long long c : buckets) n += c;
+	printf("{\"op\":\"%s\",\"requests\":%llu,\"err_responses\":%lld,\"p50_ns\":%lld,\"p99_ns\":%lld,\"p999_ns\":%lld,\"max_ns\":%lld",
+		op, n, errors, percentile(buckets, n, 0.5), percentile(buckets, n, 0.99), percentile(buckets, n, 0.999), percentile(buckets, n, 1.0));
+}
+
+int main(int argc, char** argv) {
+	int threads = 1;	//Threads sending requests
+	double speed = 0;	//Multiple of the recorded pace (0 = as fast as possible)
+	for (int i = 2; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "--threads") == 0) threads = max(1, atoi(argv[i + 1]));
+		else if (strcmp(argv[i], "--speed") == 0) speed = atof(argv[i + 1]);
+		else argc = 0;	//Unknown option
+	}
+	if (argc < 2 || argc % 2) {
+		fprintf(stderr, "Usage: replay <trace> [--threads <n>] [--speed <x>]\n");
+		return 1;
+	}
+
+	workloadReader trace;	//Recorded requests
+	if (!trace.open(argv[1])) {
+		fprintf(stderr, "Could not read a workload trace from %s\n", argv[1]);
+		return 1;
+	}
+	vector<replayer*> replayers;	//One per thread
+	for (int t = 0; t < threads; t++) {
+		replayers.push_back(new replayer);
+		fill(replayers[t]->errors, replayers[t]->errors + WORK_OPS, 0);
+	}
+	workloadRequest r;
+	long long total = 0;	//Requests in the trace
+	while (trace.next(r)) {
+		replayer* to = replayers[(r.user >= 0 ? r.user : total) % threads];	//Users stay on one thread
+		to->lines.push_back(r.line());
+		to->requests.push_back(r);
+		total++;
+	}
+
+	long long gen, then = 0;	//When recording began (by the recording library's clock)
+	if (!trace.start().empty() && sscanf(trace.start()[0].c_str(), "SNAPSHOT %lld %lld", &gen, &then) != 2) {
+		fprintf(stderr, "%s starts with a damaged state\n", argv[1]);
+		return 1;
+	}
+	shiftedClock clock(then ? then : (long long)time(nullptr));	//Reads as it did when recording began
+	LMS library(&clock);	//Fresh library loaded from the catalog
+	size_t at = 0;	//Next line of the starting state
+	if (!trace.start().empty() && library.loadState([&](string& line) {
+		if (at == trace.start().size()) return false;
+		line = trace.start()[at++];
+		return true;
+	}) < 0) {
+		fprintf(stderr, "%s starts with a damaged state\n", argv[1]);
+		return 1;
+	}
+	long long start = monotonicNs();
+	for (replayer* p : replayers) p->worker = thread(replay, ref(library), ref(*p), start, speed);
+	for (replayer* p : replayers) p->worker.join();
+	double seconds = (monotonicNs() - start) / 1e9;
+
+	vector<unsigned long long> all(LATENCY_BUCKETS, 0);	//Every request's latency
+	long long allErrors = 0;
+	for (int op = 0; op < WORK_OPS; op++) {
+		vector<unsigned long long> buckets(LATENCY_BUCKETS, 0);
+		long long errors = 0;
+		for (replayer* p : replayers) {
+			p->latency[op].addTo(buckets);
+			errors += p->errors[op];
+		}
+		for (int b = 0; b < LATENCY_BUCKETS; b++) all[b] += buckets[b];
+		allErrors += errors;
+		bool any = false;
+		for (unsigned long long c : buckets) any = any || c;
+		if (!any) continue;	//Kind the trace never used
+		report(workNames[op], buckets, errors);
+		printf("}\n");
+	}
+	report("all", all, allErrors);
+	printf(",\"threads\":%d,\"speed\":%g,\"seconds\":%.3f,\"requests_per_sec\":%.0f}\n", threads, speed, seconds, seconds > 0 ? total / seconds : 0);
+
+	for (replayer* p : replayers) delete p;
+	return 0;
+}
@@ -0,0 +1,51 @@
+# Coroutine server (--serve-async, C++20 builds only): the same protocol as --serve over a Unix
+# socket and TCP loopback, pipelined requests, clients changing one book at once, and with --log
+# every change it answered OK is still there after a kill -9 and restart.
+# Builds: Project1-c20
+. tests/lib.sh
+
+I=913154                                 # The Way Things Work (6 copies)
+PORT=$((20000 + ($$ + 7) % 20000))       # TCP port on loopback
+copies() { ask "$1" "ISBN $I" | tail -1 | cut -f5; }
+
+expect "a C++17 build refuses --serve-async" "1" "$("$BIN/Project1" --serve-async "$WORK/no.sock" 2> /dev/null; echo $?)"
+
+start "$LMS" --serve-async "$WORK/lms.sock" 2
+wait_for "$WORK/lms.sock"
+start "$LMS" --serve-async $PORT 2
+wait_for $PORT
+
+expect "lookup over a Unix socket" "6" "$(copies "$WORK/lms.sock")"
+expect "lookup over TCP" "6" "$(copies $PORT)"
+expect "borrow" "OK borrowed; 5 left" "$(ask "$WORK/lms.sock" "BORROW $I ann")"
+expect "account after borrowing" "You have 1 of 10 books borrowed and 0 on hold." "$(ask "$WORK/lms.sock" "ACCOUNT ann" | sed -n 2p)"
+expect "return" "OK returned" "$(ask "$WORK/lms.sock" "RETURN $I ann")"
+expect "account after returning" "You have 0 of 10 books borrowed and 0 on hold." "$(ask "$WORK/lms.sock" "ACCOUNT ann" | sed -n 2p)"
+expect "borrow over TCP" "OK borrowed; 5 left" "$(ask $PORT "BORROW $I bob")"
+
+# 500 requests written in one go come back as 500 responses, in order
+got=$(for i in $(seq 1 250); do echo "BORROW $I pipe"; echo "RETURN $I pipe"; done | ask "$WORK/lms.sock" | uniq -c | awk '{print $1}' | sort -u)
+expect "pipelined responses stay in request order" "1" "$got"
+
+# Clients borrowing and returning at the same time leave every copy where it started
+for k in 1 2 3 4 5 6 7 8; do
+	(for i in $(seq 1 100); do echo "BORROW $I c$k"; echo "RETURN $I c$k"; done | ask "$WORK/lms.sock" > "$WORK/c$k") &
+done
+wait_clients
+expect "concurrent clients got every response" "1600" "$(cat "$WORK"/c? | grep -c '^OK\|^ERR')"
+expect "concurrent borrows and returns balance" "6" "$(copies "$WORK/lms.sock")"
+
+# With a log, a session answers only once its change is durable, so nothing acknowledged is lost
+start "$LMS" --serve-async "$WORK/logged.sock" 2 --log "$WORK/lms.log"
+LOGGED=$LAST
+wait_for "$WORK/logged.sock"
+for k in 1 2 3 4; do
+	(ask "$WORK/logged.sock" "BORROW $I d$k" > "$WORK/d$k") &
+done
+wait_clients
+crash $LOGGED
+start "$LMS" --serve-async "$WORK/logged.sock" 2 --log "$WORK/lms.log"
+wait_for "$WORK/logged.sock"
+expect "acknowledged borrows survive a restart" "$((6 - $(cat "$WORK"/d? | grep -c '^OK borrowed')))" "$(copies "$WORK/logged.sock")"
+expect "a restored loan can be returned" "OK returned" "$(ask "$WORK/logged.sock" "RETURN $I d1")"
+finish
@@ -0,0 +1,111 @@
+/*
+Batch mode (Batch.h, --batch): a workload of queries and changes, with comments, blank lines and
+CRLF line ends, gives one response per request, each ended by a blank line and the same as
+handle() gives for it, and the same output whether runs of queries are answered in parallel on
+a pool or one at a time. The clock is moved on before the batch, so its first queries also
+expire holds, as prepare() does for a run in file order. Exit status is the number of failed checks.
+*/
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include "../LMS.h"
+#include "../Batch.h"
+using namespace std;
+
+int failed = 0;                          // Checks that failed so far
+
+// Helper function to compare what a check got with what it expected
+void expect(const char* what, const string& expected, const string& got) {
+	if (expected == got) printf("ok: %s\n", what);
+	else {
+		printf("FAIL: %s\n  expected: %s\n  got:      %s\n", what, expected.substr(0, 200).c_str(), got.substr(0, 200).c_str());
+		failed++;
+	}
+}
+
+// Helper function to put a library in the state every run starts from: every copy of a book out,
+// a queue for it, and a copy returned, so a hold is waiting when the clock moves on
+void setUp(LMS& library, manualClock& clock) {
+	const string I = "913154";           // The Way Things Work (6 copies)
+	string out;
+	for (int k = 0; k < 6; k++) library.handle(("BORROW " + I + " reader" + to_string(k)).c_str(), out);
+	library.handle(("RESERVE " + I + " ann").c_str(), out);
+	library.handle(("RESERVE " + I + " bob").c_str(), out);
+	library.handle(("RETURN " + I + " reader0").c_str(), out);
+	clock.advance(HOLD_PICKUP_SECONDS + 60); // Ann's hold has lapsed, though nothing has noticed yet
+}
+
+// Helper function to run a batch, returning its output and setting count to the requests it ran
+string runOnce(const string& requests, workStealingPool* pool, long long& count) {
+	manualClock clock(1700000000);
+	LMS library(&clock);
+	setUp(library, clock);
+	if (pool) library.useWorkers(pool);
+	istringstream in(requests);
+	FILE* out = tmpfile();
+	count = runBatch(library, in, out, pool);
+	string text;
+	rewind(out);
+	for (int c; (c = fgetc(out)) != EOF; ) text += (char)c;
+	fclose(out);
+	return text;
+}
+
+int main() {
+	vector<string> ISBNs, titles, authors; // From the catalog
+	ifstream catalog("Book Dataset.csv");
+	vector<string> fields;
+	for (string line; getline(catalog, line) && line[0] != ','; ) {
+		splitCSV(line, fields);
+		if (fields.size() < 5 || fields[0].empty() || !isdigit((unsigned char)fields[0][0])) continue;
+		ISBNs.push_back(fields[0]);
+		titles.push_back(fields[1]);
+		authors.push_back(fields[2]);
+	}
+
+	mt19937 random(33);
+	vector<string> requests = { "ACCOUNT ann", "ACCOUNT bob" }; // The workload, one request per line
+	for (int i = 2; i < 3000; i++) {
+		int n = random() % ISBNs.size();
+		string user = "u" + to_string(random() % 40);
+		bool change = i % 100 >= 80;     // Runs of 80 queries, then 20 changes
+		int k = random() % 4;
+		if (change) requests.push_back((k == 0 ? "BORROW " : k == 1 ? "RETURN " : k == 2 ? "RESERVE " : "BORROW 913154 ") + (k == 3 ? user : ISBNs[n] + " " + user));
+		else if (k == 0) requests.push_back(random() % 2 ? "ISBN " + ISBNs[n] : "FIND " + titles[n]);
+		else if (k == 1) requests.push_back(random() % 2 ? "PREFIX " + titles[n].substr(0, 3) : "AUTHOR " + authors[n]);
+		else if (k == 2) requests.push_back("PRICE " + to_string(random() % 50) + " " + to_string(50 + random() % 50) + (random() % 2 ? " INSTOCK" : ""));
+		else requests.push_back(random() % 3 == 0 ? "POPULAR" : random() % 2 ? "ACCOUNT ann" : "ACCOUNT " + user);
+	}
+	string file;                         // The batch file: CRLF ends, comments and blank lines mixed in
+	for (size_t i = 0; i < requests.size(); i++) {
+		if (i % 500 == 0) file += "# part " + to_string(i / 500) + "\n\n";
+		file += requests[i] + (i % 2 ? "\r\n" : "\n");
+	}
+
+	long long sequentialCount, parallelCount;
+	string sequential = runOnce(file, nullptr, sequentialCount);
+	workStealingPool pool(4);
+	string parallel = runOnce(file, &pool, parallelCount);
+
+	string expected;                     // What handle() says to each request, one at a time
+	{
+		manualClock clock(1700000000);
+		LMS library(&clock);
+		setUp(library, clock);
+		for (const string& r : requests) {
+			string out;
+			library.handle(r.c_str(), out);
+			expected += out + "\n";
+		}
+	}
+	expect("every request is counted, comments and blank lines are not", to_string(requests.size()), to_string(sequentialCount));
+	expect("one response per request, each ended by a blank line", expected, sequential);
+	size_t end = sequential.find("\n\n");  // Responses to the first two requests
+	string first = sequential.substr(0, end), second = sequential.substr(end + 2, sequential.find("\n\n", end + 2) - end - 2);
+	expect("the first query sees the lapsed hold gone", "1", first.find("You have 0 of 10 books borrowed and 0 on hold.") != string::npos ? "1" : "0");
+	expect("and the copy held for the next in line", "1", second.find("(ready for pickup)") != string::npos ? "1" : "0");
+	expect("answering runs of queries in parallel gives the same count", to_string(sequentialCount), to_string(parallelCount));
+	expect("and the same output", sequential, parallel);
+	return failed;
+}
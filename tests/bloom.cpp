@@ -0,0 +1,125 @@
+/*
+AVL (BST.h) behind its blocked Bloom filter (Bloom.h), against a std::multimap doing the same
+random inserts and removals: retrieve and retrieveAll agree on every key, present or not, as the
+tree grows well past what the filter was sized for (so it is rebuilt bigger) and shrinks until
+most of its bits are stale (so it is rebuilt again). The filter must also turn some lookups away,
+or it is not doing its job. Exit status is the number of failed checks.
+*/
+#include <cstdio>
+#include <map>
+#include <random>
+#include <vector>
+#include "../BST.h"
+using namespace std;
+
+const int KEYS = 4000;                   // Keys are drawn from 0..KEYS-1
+const int OPS = 200000;                  // Random operations
+
+// A value stored in the tree: its key and an id unique among values
+struct entry {
+	int k;
+	int id;
+	bool operator==(const entry& o) const { return k == o.k && id == o.id; }
+};
+
+// Extractor for an entry's key
+struct keyOfEntry {
+	static int of(const entry& e) { return e.k; }
+};
+
+long long resets = 0;                    // Times the filter was emptied (sized, or rebuilt)
+long long turnedAway = 0;                // Lookups the filter answered on its own
+
+// The library's filter, counting what it does
+struct countingBloom : blockedBloom<int, intMix> {
+	void reset(long long expected) { resets++; blockedBloom<int, intMix>::reset(expected); }
+	bool mayContain(const int& k) {
+		bool may = blockedBloom<int, intMix>::mayContain(k);
+		if (!may) turnedAway++;
+		return may;
+	}
+};
+
+typedef basicAVL<int, entry, keyOfEntry, threeWay<int>, noTrace, allocator<entry>, countingBloom> tree;
+
+int failed = 0;                          // Checks that failed so far
+
+// Helper function to report one check
+void expect(const char* what, bool ok) {
+	printf("%s: %s\n", ok ? "ok" : "FAIL", what);
+	if (!ok) failed++;
+}
+
+// Helper function to check one key: retrieveAll lists the multimap's values in insertion order,
+// and retrieve returns the first of them (or an empty entry)
+bool agrees(tree& t, const multimap<int, int>& m, int k) {
+	auto all = m.equal_range(k);
+	tree::range got = t.retrieveAll(k);
+	size_t i = 0;
+	for (auto it = all.first; it != all.second; ++it, ++i) {
+		if (i >= got.size() || !(got[i] == entry{ k, it->second })) return false;
+	}
+	if (i != got.size()) return false;
+	entry first = t.retrieve(k);
+	return got.empty() ? first == entry() : first == got[0];
+}
+
+int main() {
+	tree t;
+	multimap<int, int> m;                // The same values, key -> id in insertion order
+	mt19937 random(48);
+	int nextId = 1;
+	int mismatches = 0;                  // Keys where the tree and the multimap disagreed
+	long long resetsGrowing = 0;         // Resets once the tree has grown to its largest
+
+	for (int op = 0; op < OPS; op++) {
+		bool growing = op < OPS / 2;     // First half mostly inserts, second half mostly removes
+		int r = random() % 100;
+		int k = random() % KEYS;
+		if (r < (growing ? 60 : 15)) {   // Insert a new value under k
+			t.insert(entry{ k, nextId });
+			m.insert(make_pair(k, nextId++));
+		}
+		else if (r < 75) {               // Remove one value under k, from anywhere in its list
+			auto all = m.equal_range(k);
+			int n = distance(all.first, all.second);
+			if (n == 0) {
+				if (t.remove(k, entry{ k, -1 })) mismatches++; // Nothing to remove
+			}
+			else {
+				auto it = all.first;
+				advance(it, random() % n);
+				if (!t.remove(k, entry{ k, it->second })) mismatches++;
+				m.erase(it);
+			}
+		}
+		else if (r < 80) {               // Remove k with every value under it
+			t.remove(k);
+			m.erase(k);
+		}
+		if (!agrees(t, m, random() % KEYS)) mismatches++; // A lookup somewhere
+		if (!agrees(t, m, k)) mismatches++;              // And where it just changed
+		if (op == OPS / 2) resetsGrowing = resets;
+	}
+	for (int k = 0; k < KEYS; k++) {
+		if (!agrees(t, m, k)) mismatches++;
+	}
+	for (int k = KEYS; k < 2 * KEYS; k++) {  // Never inserted
+		if (!agrees(t, m, k)) mismatches++;
+	}
+
+	bool ordered = true;                 // forEachFrom walks the keys in order, values in insertion order
+	auto it = m.lower_bound(KEYS / 2);
+	t.forEachFrom(KEYS / 2, [&](const entry& e) {
+		ordered = ordered && it != m.end() && e == entry{ it->first, it->second };
+		++it;
+		return true;
+	});
+	expect("retrieve and retrieveAll agree with a multimap throughout", mismatches == 0);
+	expect("forEachFrom visits the same values in the same order", ordered && it == m.end());
+	expect("the filter was rebuilt bigger as the tree grew", resetsGrowing > 1);
+	expect("and rebuilt again as keys were removed", resets > resetsGrowing);
+	expect("the filter turned lookups away", turnedAway > 0);
+	printf("  (%lld resets, %lld lookups turned away, %zu values left)\n", resets, turnedAway, m.size());
+	return failed;
+}
@@ -0,0 +1,145 @@
+/*
+Checkpoints (Checkpoint.h, LMS::checkpoint) taken while other threads borrow, return and reserve:
+each one succeeds and deletes the log segments its snapshot covers, and a restart loads the same
+state from the snapshot plus the log. So does one from the files a crash between closing off a
+segment and deleting it leaves behind: the snapshot, a segment it already covers (skipped and
+deleted), a segment it does not (replayed) and the live log. Exit status is the number of failed checks.
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <sys/stat.h>
+#include "../LMS.h"
+using namespace std;
+
+const int THREADS = 4;                   // Threads changing the library during checkpoints
+const int CHECKPOINTS = 3;               // Checkpoints taken while they do
+
+int failed = 0;                          // Checks that failed so far
+
+// Helper function to compare what a check got with what it expected
+void expect(const char* what, const string& expected, const string& got) {
+	if (expected == got) printf("ok: %s\n", what);
+	else {
+		printf("FAIL: %s\n  expected: %s\n  got:      %s\n", what, expected.c_str(), got.c_str());
+		failed++;
+	}
+}
+
+// Helper function to read a whole file
+string contents(const string& path) {
+	ifstream in(path, ios::binary);
+	return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+}
+
+// Helper function to write a whole file
+void overwrite(const string& path, const string& text) {
+	ofstream(path, ios::binary) << text;
+}
+
+// Helper function to start taking a library's state: its snapshot lines go to path (written out
+// when the library is deleted) and the merged POPULAR answer is returned
+string state(LMS& library, const string& path) {
+	library.recordTo(path.c_str());
+	string out;
+	library.handle("POPULAR", out);
+	return out;
+}
+
+// Helper function to finish taking a state in a form that does not depend on the order users
+// registered in: the snapshot lines, sorted, without the header or the per-shard popularity
+// counters (users land in other shards after a restart), after the POPULAR answer
+string stateLines(const string& popular, const string& path) {
+	ifstream in(path);
+	vector<string> lines;
+	for (string line; getline(in, line) && line != "END"; ) {
+		if (line.compare(0, 9, "SNAPSHOT ") != 0 && line.compare(0, 9, "BORROWED ") != 0 && line.compare(0, 9, "RESERVED ") != 0) lines.push_back(line);
+	}
+	sort(lines.begin(), lines.end());
+	string all = popular;
+	for (const string& line : lines) all += line + "\n";
+	return all;
+}
+
+// Helper function to list the closed-off segments of a log, as "1 2 3"
+string segments(const string& log) {
+	string list;
+	for (long long g : closedSegments(log)) list += (list.empty() ? "" : " ") + to_string(g);
+	return list;
+}
+
+int main() {
+	string dir = getenv("WORK") ? getenv("WORK") : "/tmp";
+	string log = dir + "/lms.log";
+	vector<int> books;                   // ISBNs the threads use (the first 30 in the catalog) and five more
+	ifstream catalog("Book Dataset.csv");
+	for (string line; getline(catalog, line) && books.size() < 35; ) {
+		if (isdigit((unsigned char)line[0])) books.push_back(atoi(line.c_str()));
+	}
+	manualClock clock(1700000000);
+
+	string before, popularBefore;        // State just before the first library goes away
+	long long generation;                // Generation of its last snapshot
+	{
+		LMS library(&clock);
+		expect("the log opens", "1", library.openLog(log.c_str()) ? "1" : "0");
+		atomic<bool> done(false);
+		vector<thread> threads;
+		for (int k = 0; k < THREADS; k++) threads.push_back(thread([&, k] {
+			mt19937 random(k);
+			string out;
+			for (int n = 0; !done || n < 200; n++) {
+				string name = "t" + to_string(k) + "u" + to_string(random() % 8);
+				string ISBN = to_string(books[random() % 30]);
+				int pick = random() % 10;
+				const char* cmd = pick < 5 ? "BORROW " : pick < 8 ? "RETURN " : "RESERVE ";
+				library.handle((cmd + ISBN + " " + name).c_str(), out);
+				if (n % 50 == 0) this_thread::yield(); // Let the checkpoint in on one core
+			}
+		}));
+		int taken = 0;
+		for (int c = 0; c < CHECKPOINTS; c++) {
+			this_thread::sleep_for(chrono::milliseconds(20));
+			if (library.checkpoint()) taken++;
+		}
+		done = true;
+		for (thread& t : threads) t.join();
+		expect("every checkpoint under load succeeds", to_string(CHECKPOINTS), to_string(taken));
+		expect("the segments the checkpoints cover are deleted", "", segments(log));
+
+		string out;                      // Changes after the last checkpoint are in the live log only
+		for (int i = 0; i < 5; i++) library.handle(("BORROW " + to_string(books[30 + i]) + " late").c_str(), out);
+		popularBefore = state(library, dir + "/before.state");
+	}
+	before = stateLines(popularBefore, dir + "/before.state");
+	sscanf(contents(log + ".snap").c_str(), "SNAPSHOT %lld", &generation);
+	expect("the live log has the changes since the snapshot", "1", contents(log).find(" late") != string::npos ? "1" : "0");
+
+	LMS* library = new LMS(&clock);      // A restart from the snapshot and the live log
+	library->openLog(log.c_str());
+	string popular = state(*library, dir + "/restart.state");
+	delete library;
+	expect("a restart has the same state", before, stateLines(popular, dir + "/restart.state"));
+
+	string image = dir + "/image";       // What a crash mid-checkpoint leaves
+	mkdir(image.c_str(), 0755);
+	string crashed = image + "/lms.log";
+	overwrite(crashed + ".snap", contents(log + ".snap"));
+	overwrite(segmentPath(crashed, generation - 1), "BORROW 1700000000 " + to_string(books[0]) + " stale\n"); // Already in the snapshot
+	overwrite(segmentPath(crashed, generation), contents(log)); // Closed off, not yet in a snapshot
+	overwrite(crashed, "");
+	library = new LMS(&clock);
+	library->openLog(crashed.c_str());
+	expect("a segment the snapshot covers is deleted on restart", to_string(generation), segments(crashed));
+	string account;
+	library->handle("ACCOUNT stale", account);
+	expect("a segment the snapshot covers is not replayed", "OK\nYou have 0 of 10 books borrowed and 0 on hold.\n", account);
+	popular = state(*library, dir + "/image.state");
+	expect("a checkpoint after the restart succeeds", "1", library->checkpoint() ? "1" : "0");
+	expect("and deletes the replayed segment", "", segments(crashed));
+	delete library;
+	expect("snapshot plus segments has the same state", before, stateLines(popular, dir + "/image.state"));
+	return failed;
+}
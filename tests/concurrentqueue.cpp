@@ -0,0 +1,100 @@
+/*
+The ticket-ordered reservation queue (ConcurrentQueue.h) with several producers and consumers:
+every id comes out once, each producer's ids in the order it queued them, length() is exact
+once the threads are done, and the inOrder steps run in queue order (what the log relies on).
+Exit status is the number of failed checks.
+*/
+#include <cstdio>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include "../ConcurrentQueue.h"
+using namespace std;
+
+const int PRODUCERS = 4;                 // Threads queueing
+const int CONSUMERS = 3;                 // Threads taking from the front
+const int EACH = 20000;                  // Ids each producer queues
+
+int failed = 0;                          // Checks that failed so far
+
+// Helper function to report one check
+void expect(const char* what, bool ok) {
+	printf("%s: %s\n", ok ? "ok" : "FAIL", what);
+	if (!ok) failed++;
+}
+
+// Helper function to check that every producer's ids appear in the order it queued them
+bool inProducerOrder(const vector<int>& ids) {
+	vector<int> last(PRODUCERS, -1);     // Last sequence number seen from each producer
+	for (int id : ids) {
+		int p = id / EACH, i = id % EACH;
+		if (i <= last[p]) return false;
+		last[p] = i;
+	}
+	return true;
+}
+
+// Helper function to add up ids
+long long sum(const vector<int>& ids) {
+	long long s = 0;
+	for (int id : ids) s += id;
+	return s;
+}
+
+int main() {
+	const long long total = (long long)PRODUCERS * EACH;
+	const long long expectedSum = total * (total - 1) / 2; // Ids are 0..total-1
+
+	{                                    // Producers alone, then one consumer
+		cQ q;
+		vector<int> logged;              // Ids in the order their enqueue inOrder steps ran
+		vector<long long> tickets(total);
+		vector<thread> threads;
+		for (int p = 0; p < PRODUCERS; p++) threads.push_back(thread([&, p] {
+			for (int i = 0; i < EACH; i++) {
+				int id = p * EACH + i;
+				tickets[id] = q.enqueue(id, [&, id] { logged.push_back(id); });
+			}
+		}));
+		for (thread& t : threads) t.join();
+		expect("length() counts every queued id", q.length() == total);
+		vector<long long> sorted(tickets);
+		sort(sorted.begin(), sorted.end());
+		bool distinct = true;
+		for (long long t = 0; t < total; t++) distinct = distinct && sorted[t] == t;
+		expect("tickets are 0, 1, 2, ... with none repeated", distinct);
+		expect("ahead() of a ticket is its place in line", q.ahead(tickets[logged[total / 2]]) == total / 2);
+
+		vector<int> out;
+		for (int id; (id = q.dequeue()) >= 0; ) out.push_back(id);
+		expect("every id comes out once", out.size() == (size_t)total && sum(out) == expectedSum);
+		expect("ids come out in the order inOrder logged them", out == logged);
+		expect("each producer's ids stay in order", inProducerOrder(out));
+		expect("the queue is empty after", q.isEmpty() && q.length() == 0);
+	}
+
+	{                                    // Producers and consumers at once
+		cQ q;
+		vector<int> out;                 // Ids in the order their dequeue inOrder steps ran
+		atomic<int> producing(PRODUCERS);
+		vector<thread> threads;
+		for (int p = 0; p < PRODUCERS; p++) threads.push_back(thread([&, p] {
+			for (int i = 0; i < EACH; i++) q.enqueue(p * EACH + i);
+			producing--;
+		}));
+		for (int c = 0; c < CONSUMERS; c++) threads.push_back(thread([&] {
+			while (true) {
+				int id = q.dequeue([&](int v) { out.push_back(v); });
+				if (id >= 0) continue;
+				if (producing == 0 && q.isEmpty()) return;
+				this_thread::yield();    // Nothing published yet: let a producer run
+			}
+		}));
+		for (thread& t : threads) t.join();
+		expect("concurrent: every id comes out once", out.size() == (size_t)total && sum(out) == expectedSum);
+		expect("concurrent: each producer's ids stay in order", inProducerOrder(out));
+		expect("concurrent: length() is 0 once drained", q.length() == 0 && q.dequeue() == -1);
+	}
+	return failed;
+}
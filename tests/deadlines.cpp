@@ -0,0 +1,102 @@
+/*
+Hold pickup windows and loan due dates, driven by a manualClock instead of the wall clock:
+a copy returned to a book with a queue is held for the first in line, lapses to the next one
+after HOLD_PICKUP_SECONDS (and back to the shelf after the last), and a loan kept past
+LOAN_SECONDS is overdue in the next snapshot. Exit status is the number of failed checks.
+*/
+#include <cstdio>
+#include <fstream>
+#include <unistd.h>
+#include "../LMS.h"
+using namespace std;
+
+int failed = 0;                          // Checks that failed so far
+
+// Helper function to compare what a check got with what it expected
+void expect(const char* what, const string& expected, const string& got) {
+	if (expected == got) printf("ok: %s\n", what);
+	else {
+		printf("FAIL: %s\n  expected: %s\n  got:      %s\n", what, expected.c_str(), got.c_str());
+		failed++;
+	}
+}
+
+// Helper function to send one request and return its response
+string ask(LMS& library, const string& request) {
+	string out;
+	library.handle(request.c_str(), out);
+	return out;
+}
+
+// Helper function to get the copies on the shelf from an ISBN response
+string shelf(LMS& library, int ISBN) {
+	string r = ask(library, "ISBN " + to_string(ISBN));
+	r.pop_back();                        // Trailing newline
+	return r.substr(r.rfind('\t') + 1);
+}
+
+// Helper function to check whether a user's account shows a copy ready for them
+bool ready(LMS& library, const string& user) {
+	return ask(library, "ACCOUNT " + user).find("(ready for pickup)") != string::npos;
+}
+
+int main() {
+	const int I = 913154;                // The Way Things Work (6 copies)
+	manualClock clock(1700000000);
+	{
+		LMS library(&clock);
+		for (int k = 0; k < 6; k++) ask(library, "BORROW " + to_string(I) + " reader" + to_string(k));
+		expect("every copy is out", "0", shelf(library, I));
+		expect("first in line", "OK reserved; 0 ahead\n", ask(library, "RESERVE " + to_string(I) + " ann"));
+		expect("second in line", "OK reserved; 1 ahead\n", ask(library, "RESERVE " + to_string(I) + " bob"));
+
+		ask(library, "RETURN " + to_string(I) + " reader0");
+		expect("a returned copy is held for the first in line", "yes", ready(library, "ann") ? "yes" : "no");
+		expect("and not put on the shelf", "0", shelf(library, I));
+		expect("nobody else can borrow it", "ERR unavailable\n", ask(library, "BORROW " + to_string(I) + " cy"));
+
+		clock.advance(HOLD_PICKUP_SECONDS - DEADLINE_TICK_SECONDS);
+		expect("the hold lasts until its window closes", "yes", ready(library, "ann") ? "yes" : "no");
+		clock.advance(2 * DEADLINE_TICK_SECONDS);
+		expect("then it lapses", "no", ready(library, "ann") ? "yes" : "no");
+		expect("and passes to the next in line", "yes", ready(library, "bob") ? "yes" : "no");
+		expect("who can pick it up", "OK picked up hold\n", ask(library, "BORROW " + to_string(I) + " bob"));
+
+		ask(library, "RESERVE " + to_string(I) + " dee");
+		ask(library, "RETURN " + to_string(I) + " reader1");
+		clock.advance(HOLD_PICKUP_SECONDS + DEADLINE_TICK_SECONDS);
+		expect("a lapsed hold with nobody in line goes back on the shelf", "1", shelf(library, I));
+	}
+
+	// A loan past its due date is written as overdue (due 0) in a snapshot
+	char dir[] = "/tmp/lms-deadlines-XXXXXX";
+	if (!mkdtemp(dir)) return 1;
+	string log = string(dir) + "/lms.log";
+	{
+		LMS library(&clock);
+		library.openLog(log.c_str());
+		long long borrowed = clock.now();
+		ask(library, "BORROW " + to_string(I) + " ann");
+		ask(library, "BORROW " + to_string(I) + " bob");
+		clock.advance(LOAN_SECONDS - DEADLINE_TICK_SECONDS);
+		ask(library, "RETURN " + to_string(I) + " bob"); // Any request runs the expiry sweep
+		library.checkpoint();
+		ifstream snap(log + ".snap");
+		string line, loan;
+		while (getline(snap, line)) if (line.compare(0, 5, "LOAN ") == 0) loan = line;
+		long long due = 0;
+		sscanf(loan.c_str(), "LOAN %lld", &due);
+		bool onTime = due >= borrowed + LOAN_SECONDS && due < borrowed + LOAN_SECONDS + DEADLINE_TICK_SECONDS; // Timers round up to a tick
+		expect("a loan inside its period is due LOAN_SECONDS after it began", "yes", onTime ? "yes" : "no");
+
+		clock.advance(2 * DEADLINE_TICK_SECONDS);
+		ask(library, "ISBN " + to_string(I));
+		library.checkpoint();
+		ifstream later(log + ".snap");
+		loan.clear();
+		while (getline(later, line)) if (line.compare(0, 5, "LOAN ") == 0) loan = line;
+		expect("past its due date it is overdue", "LOAN 0 " + to_string(I) + " ann", loan);
+	}
+	if (system(("rm -rf " + string(dir)).c_str()) != 0) return 1;
+	return failed;
+}
@@ -0,0 +1,46 @@
+# Write-ahead log (--log) through the server: clients borrowing at once while the server is
+# killed with -9, after which every borrow it answered OK is back on restart; and a record the
+# crash left half written, which the restart skips and cuts off before logging carries on.
+. tests/lib.sh
+
+I=913154                                 # The Way Things Work (6 copies), left to the torn record
+ISBNS=$(sed 1,2d "Book Dataset.csv" | cut -d, -f1 | head -40) # Books the clients borrow
+loans() { ask "$WORK/lms.sock" "ACCOUNT $1" | sed -n 2p | awk '{print $3}'; }
+
+start_server() {
+	start "$LMS" --serve "$WORK/lms.sock" 2 --log "$WORK/lms.log"
+	SERVER=$LAST
+	wait_for "$WORK/lms.sock"
+}
+start_server
+
+# Eight clients, each borrowing one book after another under a name per book, until the crash
+for k in 1 2 3 4 5 6 7 8; do
+	(for i in $ISBNS; do
+		echo "$i u${k}x$i $(ask "$WORK/lms.sock" "BORROW $i u${k}x$i" 2> /dev/null)"
+	done > "$WORK/c$k") &
+done
+sleep 0.3
+crash $SERVER
+wait_clients
+start_server
+
+acked=$(cat "$WORK"/c? | grep -c 'OK borrowed')
+kept=0
+for u in $(cat "$WORK"/c? | grep 'OK borrowed' | cut -d' ' -f2); do
+	[ "$(loans "$u")" = "1" ] && kept=$((kept + 1))
+done
+expect "the crash came while clients were borrowing" "1" "$([ "$acked" -gt 0 ] && echo 1)"
+expect "every acknowledged borrow survives the crash" "$acked" "$kept"
+
+# A half written record at the end of the log is skipped, and the next change starts a fresh line
+crash $SERVER
+printf 'BORROW 1700000000 %s tor' $I >> "$WORK/lms.log"
+start_server
+expect "a torn record is not replayed" "0" "$(loans tor)"
+expect "borrow after the torn record" "OK borrowed; 5 left" "$(ask "$WORK/lms.sock" "BORROW $I after")"
+crash $SERVER
+start_server
+expect "a change logged after the torn record survives" "1" "$(loans after)"
+expect "the earlier changes are still there" "$kept" "$(for u in $(cat "$WORK"/c? | grep 'OK borrowed' | cut -d' ' -f2); do loans "$u"; done | grep -c '^1$')"
+finish
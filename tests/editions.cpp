@@ -0,0 +1,119 @@
+/*
+Titles with several editions in AVL (BST.h): the first edition sits in the title's node and a
+second moves both to an array, grown as editions arrive; retrieveAll lists them in the order they
+were added, remove(title, edition) takes one from the middle and keeps the rest in order, and the
+array goes back to the allocator once one edition is left, and the node once none is.
+Exit status is the number of failed checks.
+*/
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "../bookInfo.h"
+#include "../BST.h"
+using namespace std;
+
+long long arrays = 0;                    // Edition arrays allocated and not yet freed
+
+// Allocator that counts the arrays of editions (the tree's nodes come from it too, uncounted)
+template <class T>
+struct countingAlloc : allocator<T> {
+	template <class U> struct rebind { typedef countingAlloc<U> other; };
+	countingAlloc() {}
+	template <class U> countingAlloc(const countingAlloc<U>&) {}
+	T* allocate(size_t n) {
+		if (is_same<T, bookInfo*>::value) arrays++;
+		return allocator<T>::allocate(n);
+	}
+	void deallocate(T* p, size_t n) {
+		if (is_same<T, bookInfo*>::value) arrays--;
+		allocator<T>::deallocate(p, n);
+	}
+};
+
+typedef basicAVL<titlePrefix, bookInfo*, titleOf, prefixOrder, noTrace, countingAlloc<bookInfo*>, blockedBloom<titlePrefix, titleMix>> tree; // AVL as the library builds it, counting arrays
+
+int failed = 0;                          // Checks that failed so far
+
+// Helper function to compare what a check got with what it expected
+void expect(const char* what, const string& expected, const string& got) {
+	if (expected == got) printf("ok: %s\n", what);
+	else {
+		printf("FAIL: %s\n  expected: %s\n  got:      %s\n", what, expected.c_str(), got.c_str());
+		failed++;
+	}
+}
+
+// Helper function to list the ISBNs stored under a title, as "1 2 3"
+string editions(tree& t, const char* title) {
+	char copy[128];                      // Looked up by a copy, as a request's title is
+	strcpy(copy, title);
+	string list;
+	for (bookInfo* b : t.retrieveAll(copy)) list += (list.empty() ? "" : " ") + to_string(b->ISBN);
+	return list;
+}
+
+int main() {
+	const char* titles[] = { "Dune", "Dune Messiah", "Dun", "The Way Things Work: A", "The Way Things Work: B" };
+	vector<bookInfo*> books;             // Every book made
+	bookInfo* dune[10];                  // Editions of Dune by ISBN (1-9)
+	{
+		tree t;
+		auto add = [&](const char* title, int ISBN) {
+			bookInfo* b = new bookInfo;
+			b->ISBN = ISBN;
+			b->title = strdup(title);    // Each edition has its own copy of the title
+			books.push_back(b);
+			t.insert(b);
+			return b;
+		};
+		bookInfo* messiah = add(titles[1], 10);
+		add(titles[2], 11);
+		dune[1] = add(titles[0], 1);
+		expect("one edition", "1", editions(t, "Dune"));
+		expect("one edition needs no array", "0", to_string(arrays));
+		dune[2] = add(titles[0], 2);
+		expect("a second edition moves both to an array", "1 2", editions(t, "Dune"));
+		expect("one array", "1", to_string(arrays));
+		t.insert(dune[2]);
+		expect("the same edition again is ignored", "1 2", editions(t, "Dune"));
+		for (int i = 3; i <= 9; i++) dune[i] = add(titles[0], i);
+		expect("editions stay in the order they were added", "1 2 3 4 5 6 7 8 9", editions(t, "Dune"));
+		expect("growing the array frees the old one", "1", to_string(arrays));
+		expect("neighbouring titles keep their own", "10", editions(t, "Dune Messiah"));
+		expect("a title that is a prefix of it too", "11", editions(t, "Dun"));
+
+		expect("remove an edition from the middle", "1", to_string(t.remove(dune[5]->title, dune[5]) ? 1 : 0));
+		expect("the others stay in order", "1 2 3 4 6 7 8 9", editions(t, "Dune"));
+		expect("remove one that is not there", "0", to_string(t.remove(dune[5]->title, dune[5]) ? 1 : 0));
+		expect("remove one with another title", "0", to_string(t.remove(titles[0], messiah) ? 1 : 0));
+		t.remove(titles[0], dune[1]);    // The first edition
+		expect("retrieve gives the first edition left", "2", to_string(t.retrieve(titles[0])->ISBN));
+		for (int i = 9; i >= 6; i--) t.remove(titles[0], dune[i]);
+		t.remove(titles[0], dune[4]);
+		expect("down to two editions", "2 3", editions(t, "Dune"));
+		expect("still one array", "1", to_string(arrays));
+		t.remove(titles[0], dune[2]);
+		expect("one edition left", "3", editions(t, "Dune"));
+		expect("it moves back into the node", "0", to_string(arrays));
+		t.remove(titles[0], dune[3]);
+		expect("removing the last edition removes the title", "", editions(t, "Dune"));
+		expect("retrieve finds nothing", "1", to_string(t.retrieve(titles[0]) == nullptr ? 1 : 0));
+		expect("the neighbours are still there", "10 / 11", editions(t, "Dune Messiah") + " / " + editions(t, "Dun"));
+
+		add(titles[3], 20);              // Titles that differ only after their first 8 bytes
+		add(titles[4], 30);
+		add(titles[3], 21);
+		add(titles[4], 31);
+		expect("long titles sharing a prefix keep their own editions", "20 21 / 30 31", editions(t, titles[3]) + " / " + editions(t, titles[4]));
+		t.remove(titles[3]);
+		expect("removing a title removes every edition", "", editions(t, titles[3]));
+		expect("and frees its array", "1", to_string(arrays));
+	}
+	expect("the tree frees every array it had", "0", to_string(arrays));
+	for (bookInfo* b : books) {
+		free(b->title);
+		delete b;
+	}
+	return failed;
+}
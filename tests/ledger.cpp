@@ -0,0 +1,93 @@
+/*
+The loan ledger (Ledger.h): copies of one book come back oldest first (each with its own due
+date timer), a fired timer is forgotten for just its copy, users with the same book are kept
+apart, and each user's recent borrows are a ring of the last RECENT_LOANS, newest first.
+Exit status is the number of failed checks.
+*/
+#include <cstdio>
+#include <string>
+#include "../bookInfo.h"
+#include "../Ledger.h"
+using namespace std;
+
+int failed = 0;                          // Checks that failed so far
+
+// Helper function to compare what a check got with what it expected
+void expect(const char* what, const string& expected, const string& got) {
+	if (expected == got) printf("ok: %s\n", what);
+	else {
+		printf("FAIL: %s\n  expected: %s\n  got:      %s\n", what, expected.c_str(), got.c_str());
+		failed++;
+	}
+}
+
+timerNode timers[8];                     // Due date timers; only their addresses matter here
+
+// Helper function to name a timer by its place in timers ("-" for none)
+string timerName(timerNode* t) {
+	return t ? "t" + to_string(t - timers) : "-";
+}
+
+// Helper function to check in one copy, as "ISBN/timer", or "none" if the user has no copy
+string checkin(loanLedger& ledger, int user, int ISBN) {
+	bookInfo* b = nullptr;
+	timerNode* due = nullptr;
+	if (!ledger.checkin(user, ISBN, b, due)) return "none";
+	return to_string(b->ISBN) + "/" + timerName(due);
+}
+
+// Helper function to list a user's recent borrows, newest first
+string recent(loanLedger& ledger, int user) {
+	string out;
+	for (int i = 0; i < ledger.recentCount(user); i++) out += (i ? " " : "") + to_string(ledger.recentAt(user, i));
+	return out;
+}
+
+int main() {
+	bookInfo a, b;
+	a.ISBN = 100;
+	b.ISBN = 200;
+	loanLedger ledger;
+
+	ledger.checkout(1, &a, &timers[0]);
+	ledger.checkout(1, &a, &timers[1]);
+	ledger.checkout(1, &a, &timers[2]);
+	ledger.checkout(2, &a, &timers[3]);
+	ledger.checkout(1, &b, &timers[4]);
+	expect("has the books borrowed", "1 1 1 0", to_string(ledger.has(1, 100)) + " " + to_string(ledger.has(1, 200)) + " " + to_string(ledger.has(2, 100)) + " " + to_string(ledger.has(2, 200)));
+
+	string loans;                        // forEachLoan lists every copy, oldest first per book
+	ledger.forEachLoan([&](int user, bookInfo* book, timerNode* due) {
+		if (user == 1 && book == &a) loans += timerName(due) + " ";
+	});
+	expect("every copy is listed, oldest first", "t0 t1 t2 ", loans);
+
+	ledger.dueFired(1, 100, &timers[1]); // The middle copy is overdue
+	ledger.dueFired(1, 100, &timers[7]); // A timer it never had
+	ledger.dueFired(3, 100, &timers[0]); // A user with no such loan
+	expect("checkin returns the oldest copy first", "100/t0", checkin(ledger, 1, 100));
+	expect("then the one whose timer fired", "100/-", checkin(ledger, 1, 100));
+	expect("another user's copy of the same book is separate", "100/t3", checkin(ledger, 2, 100));
+	expect("then the last copy", "100/t2", checkin(ledger, 1, 100));
+	expect("the book is no longer out", "0", to_string(ledger.has(1, 100)));
+	expect("checkin of a book not out", "none", checkin(ledger, 1, 100));
+	expect("other books are untouched", "200/t4", checkin(ledger, 1, 200));
+
+	expect("recent borrows, newest first", "200 100 100 100", recent(ledger, 1));
+	expect("returning does not forget them", "100", recent(ledger, 2));
+	ledger.restore(2, &b, &timers[5]);   // Restored loans are not new borrows
+	expect("a restored loan is out", "1", to_string(ledger.has(2, 200)));
+	expect("but not a recent borrow", "100", recent(ledger, 2));
+	for (int i = 1; i <= RECENT_LOANS + 3; i++) ledger.remember(3, i);
+	string last;                         // The last RECENT_LOANS borrows, newest first
+	for (int i = RECENT_LOANS + 3; i > 3; i--) last += (last.empty() ? "" : " ") + to_string(i);
+	expect("the ring keeps only the last RECENT_LOANS", last, recent(ledger, 3));
+	string oldestFirst, expected;
+	for (int i = 4; i <= RECENT_LOANS + 3; i++) expected += to_string(i) + " ";
+	ledger.forEachRecent([&](int user, int ISBN) {
+		if (user == 3) oldestFirst += to_string(ISBN) + " ";
+	});
+	expect("forEachRecent lists them oldest first", expected, oldestFirst);
+	expect("a user with no history", "", recent(ledger, 9));
+	return failed;
+}
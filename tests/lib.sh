@@ -0,0 +1,74 @@
+# Helpers shared by the test scripts (sourced, not run). run.sh sets BIN to the directory holding
+# the Project1 and client builds and LMS to the server build under test, and runs each script
+# from the repository root, where the catalog is; each script gets a scratch directory in WORK.
+
+PIDS=""                                  # Processes a script started, killed when it ends
+FAILED=0                                 # Checks that failed so far
+
+# Function to start a process in the background and remember it for clean up
+start() {
+	"$@" > /dev/null 2>> "$WORK/stderr" &
+	PIDS="$PIDS $!"
+	LAST=$!
+}
+
+# Function to stop one process started with start
+stop() {
+	kill "$1" 2> /dev/null
+	wait "$1" 2> /dev/null
+}
+
+# Function to kill a process started with start the way a crash would (no chance to clean up)
+crash() {
+	{ kill -9 "$1"; wait "$1"; } 2> /dev/null
+}
+
+# Function to stop everything this script started
+cleanup() {
+	for p in $PIDS; do stop "$p"; done
+}
+trap cleanup EXIT
+
+# Function to wait (up to 10 s) until a server answers on an address
+wait_for() {
+	for i in $(seq 1 100); do
+		"$BIN/client" "$1" STATS > /dev/null 2>&1 && return 0
+		sleep 0.1
+	done
+	echo "FAIL: nothing answers on $1"
+	exit 1
+}
+
+# Function to wait for the background jobs a script started itself (not the servers)
+wait_clients() {
+	for j in $(jobs -p); do
+		case " $PIDS " in
+		*" $j "*) ;;
+		*) wait "$j" ;;
+		esac
+	done
+}
+
+# Function to send requests to an address and print the responses
+ask() {
+	local addr=$1
+	shift
+	"$BIN/client" "$addr" "$@"
+}
+
+# Function to compare what a check got with what it expected
+expect() {
+	if [ "$2" = "$3" ]; then
+		echo "ok: $1"
+	else
+		echo "FAIL: $1"
+		echo "  expected: $(printf '%s' "$2" | head -5)"
+		echo "  got:      $(printf '%s' "$3" | head -5)"
+		FAILED=$((FAILED + 1))
+	fi
+}
+
+# Function to end a script with the number of failed checks as its status
+finish() {
+	exit $FAILED
+}
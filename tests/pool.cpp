@@ -0,0 +1,107 @@
+/*
+The work-stealing pool (Executor.h): parallelFor runs its body on every index exactly once, in
+pieces no longer than the grain; invoke nests (a recursive sum far deeper than POOL_MAX_NESTING,
+and parallelFor inside parallelFor and inside submitted work) without losing or repeating work;
+threads outside the pool can fork at the same time; and submitted work runs in submission order
+on one worker, all of it before the pool's destructor returns. A hang fails by alarm.
+Exit status is the number of failed checks.
+*/
+#include <cstdio>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <unistd.h>
+#include "../Executor.h"
+using namespace std;
+
+int failed = 0;                          // Checks that failed so far
+
+// Helper function to report one check
+void expect(const char* what, bool ok) {
+	printf("%s: %s\n", ok ? "ok" : "FAIL", what);
+	if (!ok) failed++;
+}
+
+// Helper function to check that parallelFor(begin, end, grain) covers every index once, in
+// pieces no longer than grain (when grain is given)
+bool coversOnce(workStealingPool& pool, long long begin, long long end, long long grain) {
+	vector<atomic<int>> hits(end > begin ? end - begin : 0);
+	atomic<bool> small(true);            // No piece longer than the grain
+	pool.parallelFor(begin, end, grain, [&](long long first, long long last) {
+		if (grain > 0 && last - first > grain) small = false;
+		for (long long i = first; i < last; i++) hits[i - begin]++;
+	});
+	for (atomic<int>& h : hits) {
+		if (h != 1) return false;
+	}
+	return small;
+}
+
+// Helper function to add up 1..n by splitting the range with invoke, nesting about log2(n) deep
+long long sum(workStealingPool& pool, long long low, long long high) {
+	if (high - low < 4) {
+		long long s = 0;
+		for (long long i = low; i <= high; i++) s += i;
+		return s;
+	}
+	long long mid = (low + high) / 2, left = 0, right = 0;
+	pool.invoke([&] { left = sum(pool, low, mid); }, [&] { right = sum(pool, mid + 1, high); });
+	return left + right;
+}
+
+// Helper function to fork depth levels deep in a chain, each level leaving one task for others
+long long chain(workStealingPool& pool, int depth) {
+	if (depth == 0) return 0;
+	long long below = 0, beside = 0;
+	pool.invoke([&] { below = chain(pool, depth - 1); }, [&] { beside = 1; });
+	return below + beside;
+}
+
+int main() {
+	alarm(120);                          // A deadlock ends the test instead of the run
+	workStealingPool pool(4);
+	expect("the pool has the threads asked for", pool.size() == 4);
+	expect("parallelFor covers a range once with a small grain", coversOnce(pool, 0, 100000, 7));
+	expect("with the grain left to it", coversOnce(pool, 0, 100000, 0));
+	expect("from an offset", coversOnce(pool, 5000, 12345, 100));
+	expect("one index", coversOnce(pool, 3, 4, 10));
+	expect("an empty range runs nothing", coversOnce(pool, 10, 10, 1) && coversOnce(pool, 10, 5, 1));
+
+	expect("nested invoke adds up 1..1000000", sum(pool, 1, 1000000) == 500000500000LL);
+	expect("a chain of invokes past POOL_MAX_NESTING", chain(pool, 10 * POOL_MAX_NESTING) == 10 * POOL_MAX_NESTING);
+
+	atomic<long long> cells(0);          // parallelFor inside parallelFor: a 300 x 300 grid
+	pool.parallelFor(0, 300, 3, [&](long long r0, long long r1) {
+		for (long long r = r0; r < r1; r++) {
+			pool.parallelFor(0, 300, 10, [&](long long c0, long long c1) { cells += c1 - c0; });
+		}
+	});
+	expect("parallelFor nests inside parallelFor", cells == 300 * 300);
+
+	vector<long long> totals(8, 0);      // Threads outside the pool forking at once
+	vector<thread> outside;
+	for (int t = 0; t < 8; t++) outside.push_back(thread([&, t] { totals[t] = sum(pool, 1, 100000 + t); }));
+	for (thread& t : outside) t.join();
+	bool right = true;
+	for (int t = 0; t < 8; t++) right = right && totals[t] == (100000LL + t) * (100001LL + t) / 2;
+	expect("threads outside the pool can fork at the same time", right);
+
+	atomic<long long> inside(0);         // Submitted work that forks
+	atomic<int> submittedDone(0);
+	for (int s = 0; s < 20; s++) pool.submit([&] {
+		pool.parallelFor(0, 1000, 50, [&](long long a, long long b) { inside += b - a; });
+		submittedDone++;
+	});
+	while (submittedDone < 20) this_thread::yield();
+	expect("submitted work can fork", inside == 20 * 1000);
+
+	vector<int> order;                   // One worker runs submitted work oldest first
+	{
+		workStealingPool one(1);
+		for (int s = 0; s < 1000; s++) one.submit([&order, s] { order.push_back(s); });
+	}                                    // The destructor lets it finish first
+	bool inOrder = order.size() == 1000;
+	for (int s = 0; inOrder && s < 1000; s++) inOrder = order[s] == s;
+	expect("submitted work all runs, in submission order, before the pool goes", inOrder);
+	return failed;
+}
@@ -0,0 +1,114 @@
+/*
+The price index (PriceIndex.h) against a brute-force filter over the same books: every search,
+with and without INSTOCK, lists the same books in the same order (cheapest first, books at one
+price in the order they were added). Bounds are inclusive to the cent, many books share a price
+so runs of it span block splits, and the catalogs are sized to leave the last block partly filled.
+run.sh builds it once per Build: line below, so each of match()'s paths is tested.
+Build: scalar -U__SSE2__ -U__AVX2__
+Build: sse2
+Build: avx2 -mavx2
+Exit status is the number of failed checks.
+*/
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "../PriceIndex.h"
+using namespace std;
+
+int failed = 0;                          // Checks that failed so far
+
+// Helper function to report one check
+void expect(const string& what, bool ok) {
+	printf("%s: %s\n", ok ? "ok" : "FAIL", what.c_str());
+	if (!ok) failed++;
+}
+
+// Helper function to list what the index finds, as ISBNs
+vector<int> search(priceIndex& index, double low, double high, bool inStock, size_t most = (size_t)-1) {
+	vector<int> found;
+	index.forEachIn(low, high, inStock, [&](bookInfo* b) {
+		found.push_back(b->ISBN);
+		return found.size() < most;
+	});
+	return found;
+}
+
+// Helper function to list what a search should find, by looking at every book; books is in the
+// order they were added, so a stable sort by price gives the index's order
+vector<int> bruteForce(const vector<bookInfo*>& books, double low, double high, bool inStock) {
+	long long lo = llround(low * 100), hi = llround(high * 100);
+	vector<bookInfo*> in;
+	for (bookInfo* b : books) {
+		long long c = llround(b->price * 100);
+		if (c >= lo && c <= hi && (!inStock || b->quantity > 0)) in.push_back(b);
+	}
+	stable_sort(in.begin(), in.end(), [](bookInfo* a, bookInfo* b) { return llround(a->price * 100) < llround(b->price * 100); });
+	vector<int> found;
+	for (bookInfo* b : in) found.push_back(b->ISBN);
+	return found;
+}
+
+int main() {
+#if defined(__AVX2__)
+	printf("match() path: AVX2\n");
+#elif defined(__SSE2__)
+	printf("match() path: SSE2\n");
+#else
+	printf("match() path: scalar\n");
+#endif
+	mt19937 random(50);
+	const int sizes[] = { 1, 63, 64, 65, 130, 1000, 3001 }; // Full blocks, and last blocks partly filled
+	for (int n : sizes) {
+		priceIndex index;
+		vector<bookInfo*> books;         // In the order they were added
+		vector<int> prices;              // Prices in use, in cents
+		for (int i = 0; i < n; i++) {
+			bookInfo* b = new bookInfo;
+			b->ISBN = i;
+			int cents = i % 3 == 0 ? 1999 : 1000 + random() % 3000; // A third of them at $19.99
+			b->price = cents / 100.0;
+			b->quantity = random() % 3;
+			books.push_back(b);
+			prices.push_back(cents);
+			index.insert(b);
+		}
+
+		int mismatches = 0;              // Searches where the index and the brute force disagree
+		int searches = 0;
+		auto compare = [&](double low, double high) {
+			for (int inStock = 0; inStock < 2; inStock++) {
+				searches++;
+				if (search(index, low, high, inStock) != bruteForce(books, low, high, inStock)) mismatches++;
+			}
+		};
+		compare(-1, 1e9);                // Everything
+		compare(19.99, 19.99);           // Only the run that spans blocks
+		compare(19.98, 19.98);           // Next to it, to the cent
+		compare(20.00, 20.00);
+		compare(19.985, 19.994);         // Ends rounded to the cent
+		compare(25, 15);                 // Empty range
+		for (int q = 0; q < 300; q++) {
+			int a = prices[random() % n], b = prices[random() % n]; // Ends exactly at prices in use
+			if (a > b) swap(a, b);
+			int edge = random() % 3 - 1; // Or a cent either side of them
+			compare((a + edge) / 100.0, (b - edge) / 100.0);
+		}
+		for (int q = 0; q < 200; q++) {  // Stock changes go through the mirrors
+			bookInfo* b = books[random() % n];
+			int k = random() % 3;
+			if (k == 0) b->takeCopy();
+			else if (k == 1) b->putCopy();
+			else b->setQuantity(random() % 2);
+			int a = prices[random() % n];
+			compare(a / 100.0 - 5, a / 100.0 + 5);
+		}
+		vector<int> all = bruteForce(books, 0, 1e9, false);
+		vector<int> first = search(index, 0, 1e9, false, 5);
+		bool prefix = first.size() == min<size_t>(5, all.size()) && equal(first.begin(), first.end(), all.begin());
+		expect(to_string(n) + " books: " + to_string(searches) + " searches agree with the brute force", mismatches == 0);
+		expect(to_string(n) + " books: a search stops when visit says so", prefix);
+		for (bookInfo* b : books) delete b;
+	}
+	return failed;
+}
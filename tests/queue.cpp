@@ -0,0 +1,98 @@
+/*
+The reservation queue (Queue.h) against a std::deque doing the same random enqueues and dequeues:
+the ring wraps round many times and grows while wrapped, values come out in order, and ahead()
+of every ticket still queued is its place in line (-1 once it has left, or if never issued).
+The buffer doubles only when full. Exit status is the number of failed checks.
+*/
+#include <cstdio>
+#include <deque>
+#include <random>
+#include <utility>
+#include "../Queue.h"
+using namespace std;
+
+long long allocations = 0;               // Buffers the queue has taken
+
+// Allocator that counts the buffers a queue takes
+template <class T>
+struct countingAlloc : allocator<T> {
+	template <class U> struct rebind { typedef countingAlloc<U> other; };
+	countingAlloc() {}
+	template <class U> countingAlloc(const countingAlloc<U>&) {}
+	T* allocate(size_t n) {
+		allocations++;
+		return allocator<T>::allocate(n);
+	}
+};
+
+typedef basicQ<int, noTrace, -1, countingAlloc<int>> queue; // Q as the library builds it, counting buffers
+
+int failed = 0;                          // Checks that failed so far
+
+// Helper function to report one check
+void expect(const char* what, bool ok) {
+	printf("%s: %s\n", ok ? "ok" : "FAIL", what);
+	if (!ok) failed++;
+}
+
+int main() {
+	queue q;
+	deque<pair<long long, int>> model;   // (ticket, value) front to back
+	long long issued = 0;                // Tickets handed out so far
+	long long mostQueued = 0;            // Longest the queue has been
+	bool inOrder = true, tickets = true, places = true, empty = true;
+	mt19937 random(26);
+
+	expect("an empty queue has no buffer", allocations == 0);
+	expect("dequeue of an empty queue", q.dequeue() == -1 && q.isEmpty() && q.length() == 0);
+	bool threw = false;
+	try {
+		q.front();
+	}
+	catch (const runtime_error&) {
+		threw = true;
+	}
+	expect("front of an empty queue throws", threw);
+
+	for (int op = 0; op < 200000; op++) {
+		int target = (op / 20000) % 2 ? 600 : 20; // Long stretches short, then long: it grows while wrapped
+		if ((int)model.size() < target ? random() % 4 != 0 : random() % 4 == 0) {
+			int v = random() % 100000;
+			long long t = q.enqueue(v);
+			tickets = tickets && t == issued;
+			model.push_back(make_pair(issued++, v));
+		}
+		else {
+			int v = q.dequeue();
+			if (model.empty()) empty = empty && v == -1;
+			else {
+				inOrder = inOrder && v == model.front().second;
+				model.pop_front();
+			}
+		}
+		mostQueued = max(mostQueued, (long long)model.size());
+		if (q.length() != (int)model.size() || (!model.empty() && q.front() != model.front().second)) inOrder = false;
+		if (op % 97 == 0) {              // Every ticket still queued, and some that are not
+			for (size_t i = 0; i < model.size(); i++) places = places && q.ahead(model[i].first) == (int)i;
+			long long gone = model.empty() ? issued - 1 : model.front().first - 1;
+			places = places && (gone < 0 || q.ahead(gone) == -1) && q.ahead(issued) == -1 && q.ahead(issued + 5) == -1;
+		}
+	}
+	vector<int> visited, expected;       // forEach walks front to back
+	q.forEach([&](const int& v) { visited.push_back(v); });
+	for (const pair<long long, int>& e : model) expected.push_back(e.second);
+	long long doublings = 0;             // Buffers needed to hold mostQueued, starting at 4
+	for (long long cap = 4; ; cap *= 2) {
+		doublings++;
+		if (cap >= mostQueued) break;
+	}
+
+	expect("values come out in the order they went in", inOrder);
+	expect("dequeue of an empty queue returns none", empty);
+	expect("tickets are 0, 1, 2, ... across wraps", tickets);
+	expect("ahead() is each queued ticket's place, -1 for others", places);
+	expect("forEach visits front to back", visited == expected);
+	expect("the buffer only doubles when full", allocations == doublings);
+	printf("  (%lld values queued, at most %lld at once, %lld buffers)\n", issued, mostQueued, allocations);
+	return failed;
+}
@@ -0,0 +1,61 @@
+# Replication (--replicate, --replica): a primary and two replicas on one host. Changes made
+# on the primary show up on the replicas, which refuse changes of their own; a replica that
+# joins late gets a copy of the whole state. When the primary goes down the replicas keep
+# answering reads until they turn stale, and a restarted primary (a new run) tells them to
+# RESYNC, while a fresh replica copies it, log replayed, as before.
+. tests/lib.sh
+
+I=913154                                 # The Way Things Work (6 copies)
+copies() { ask "$1" "ISBN $I" | tail -1 | cut -f5; }
+
+# Function to wait (up to 5 s) until a replica shows a number of copies
+wait_copies() {
+	for i in $(seq 1 50); do
+		[ "$(copies "$1")" = "$2" ] && return 0
+		sleep 0.1
+	done
+	return 1
+}
+
+start_primary() {
+	start "$LMS" --serve "$WORK/primary.sock" 2 --log "$WORK/lms.log" --replicate "$WORK/ship.sock"
+	PRIMARY=$LAST
+	wait_for "$WORK/primary.sock"
+}
+start_primary
+for r in 1 2; do
+	start "$LMS" --replica "$WORK/ship.sock" "$WORK/replica$r.sock" 2
+	wait_for "$WORK/replica$r.sock"
+done
+
+expect "borrow on the primary" "OK borrowed; 5 left" "$(ask "$WORK/primary.sock" "BORROW $I ann")"
+ask "$WORK/primary.sock" "RESERVE 2111314 bob" > /dev/null
+for r in 1 2; do
+	wait_copies "$WORK/replica$r.sock" 5
+	expect "replica $r has the borrow" "5" "$(copies "$WORK/replica$r.sock")"
+	expect "replica $r has the account" "$(ask "$WORK/primary.sock" "ACCOUNT ann")" "$(ask "$WORK/replica$r.sock" "ACCOUNT ann")"
+done
+expect "replicas refuse changes" "ERR read-only replica" "$(ask "$WORK/replica1.sock" "RETURN $I ann")"
+
+ask "$WORK/primary.sock" "RETURN $I ann" "BORROW $I cy" "BORROW $I dee" > /dev/null
+start "$LMS" --replica "$WORK/ship.sock" "$WORK/late.sock" 2
+wait_for "$WORK/late.sock"
+expect "a late replica gets the whole state" "4" "$(copies "$WORK/late.sock")"
+expect "a late replica gets the accounts" "$(ask "$WORK/primary.sock" "ACCOUNT dee")" "$(ask "$WORK/late.sock" "ACCOUNT dee")"
+wait_copies "$WORK/replica2.sock" 4
+expect "a running replica keeps up" "4" "$(copies "$WORK/replica2.sock")"
+
+stop $PRIMARY
+expect "replicas answer reads while the primary is down" "4" "$(copies "$WORK/replica1.sock")"
+sleep 6                                  # REPLICA_MAX_LAG_SECONDS, and a reconnect attempt or two
+expect "replicas turn stale" "ERR replica stale" "$(ask "$WORK/replica1.sock" "ISBN $I")"
+
+start_primary                            # A new run of the primary, its state replayed from the log
+expect "the restarted primary replayed its log" "4" "$(copies "$WORK/primary.sock")"
+sleep 2                                  # Replicas retry every second
+expect "old replicas are told to RESYNC" "yes" "$(grep -q 'no longer has the changes' "$WORK/stderr" && echo yes)"
+start "$LMS" --replica "$WORK/ship.sock" "$WORK/fresh.sock" 2
+wait_for "$WORK/fresh.sock"
+expect "a fresh replica copies the restarted primary" "4" "$(copies "$WORK/fresh.sock")"
+expect "and its accounts" "$(ask "$WORK/primary.sock" "ACCOUNT cy")" "$(ask "$WORK/fresh.sock" "ACCOUNT cy")"
+finish
@@ -0,0 +1,58 @@
+#!/bin/sh
+# Runs the tests: builds Project1 and client into a scratch directory, then runs every
+# tests/*.sh script and tests/*.cpp program from the repository root (they need the catalog).
+# A script runs against the server build in LMS, once per build its "# Builds:" line names
+# (Project1 when it has none); Project1-concurrent has the opt-in ticket-ordered reservation queue
+# and Project1-c20 is a C++20 build, the only kind with the coroutine server. A program is built
+# once per "Build: <name> <flags>" line in it (once, as is, when it has none); a build whose -m
+# flags ask for an instruction set this CPU lacks is skipped.
+# Usage: sh tests/run.sh [test name ...]    Exit status is the number of tests that failed.
+cd "$(dirname "$0")/.." || exit 1
+CXX=${CXX:-g++}
+FLAGS="-std=c++17 -pthread -O2"
+BIN=$(mktemp -d)
+export BIN
+trap 'rm -rf "$BIN"' EXIT
+$CXX $FLAGS main.cpp -o "$BIN/Project1" && $CXX $FLAGS client.cpp -o "$BIN/client" || exit 1
+$CXX $FLAGS -DLMS_CONCURRENT_RESERVATIONS main.cpp -o "$BIN/Project1-concurrent" || exit 1
+$CXX $FLAGS -std=c++20 main.cpp -o "$BIN/Project1-c20" || exit 1
+
+failed=0
+names=${*:-$(ls tests/*.sh tests/*.cpp | grep -v 'tests/run.sh\|tests/lib.sh' | sed 's|tests/||; s|\.[a-z]*$||' | sort -u)}
+for name in $names; do
+	if [ -f "tests/$name.cpp" ]; then   # Builds as name:flag:flag..., so each is one word
+		builds=$(sed -n 's/^Build: *//p' "tests/$name.cpp" | tr ' ' ':' | grep . || echo "-")
+	else
+		builds=$(sed -n 's/^# Builds://p' "tests/$name.sh" | grep . || echo Project1)
+	fi
+	for build in $builds; do
+		WORK=$(mktemp -d)
+		LMS="$BIN/$build"
+		export WORK LMS
+		if [ -f "tests/$name.cpp" ]; then
+			extra=$(echo "$build" | cut -s -d: -f2- | tr ':' ' ')
+			missing=$(for f in $extra; do case $f in -m*) grep -qw "${f#-m}" /proc/cpuinfo || echo "${f#-m}" ;; esac; done)
+			if [ "$build" = "-" ]; then
+				echo "== $name"
+			elif [ -n "$missing" ]; then
+				echo "== $name (${build%%:*}) skipped: this CPU has no $missing"
+				rm -rf "$WORK"
+				continue
+			else
+				echo "== $name (${build%%:*})"
+			fi
+			$CXX $FLAGS $extra "tests/$name.cpp" -o "$BIN/$name" && "$BIN/$name"
+		else
+			echo "== $name ($build)"
+			bash "tests/$name.sh"
+		fi
+		status=$?
+		if [ $status -ne 0 ]; then
+			failed=$((failed + 1))
+			[ -s "$WORK/stderr" ] && sed 's/^/  stderr: /' "$WORK/stderr"
+		fi
+		rm -rf "$WORK"
+	done
+done
+echo "$failed failed"
+exit $failed
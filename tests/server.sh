@@ -0,0 +1,46 @@
+# Socket server (--serve): request and response over a Unix socket and TCP loopback, many
+# requests pipelined on one connection, and several clients changing one book at once.
+# Builds: Project1 Project1-concurrent
+. tests/lib.sh
+
+I=913154                                 # The Way Things Work (6 copies)
+R=2111314                                # A book with 2 copies, for reservations
+PORT=$((20000 + $$ % 20000))             # TCP port on loopback
+start "$LMS" --serve "$WORK/lms.sock" 4
+wait_for "$WORK/lms.sock"
+start "$LMS" --serve $PORT 2
+wait_for $PORT
+
+expect "lookup over a Unix socket" "6" "$(ask "$WORK/lms.sock" "ISBN $I" | tail -1 | cut -f5)"
+expect "lookup over TCP" "6" "$(ask $PORT "ISBN $I" | tail -1 | cut -f5)"
+expect "borrow" "OK borrowed; 5 left" "$(ask "$WORK/lms.sock" "BORROW $I ann")"
+expect "account after borrowing" "You have 1 of 10 books borrowed and 0 on hold." "$(ask "$WORK/lms.sock" "ACCOUNT ann" | sed -n 2p)"
+expect "return" "OK returned" "$(ask "$WORK/lms.sock" "RETURN $I ann")"
+expect "unknown command" "ERR unknown command" "$(ask "$WORK/lms.sock" "FROB")"
+
+# 500 requests written in one go come back as 500 responses, in order
+got=$(for i in $(seq 1 250); do echo "BORROW $I pipe"; echo "RETURN $I pipe"; done | ask "$WORK/lms.sock" | uniq -c | awk '{print $1}' | sort -u)
+expect "pipelined responses stay in request order" "1" "$got"
+
+# Clients borrowing and returning at the same time leave every copy where it started
+for k in 1 2 3 4 5 6 7 8; do
+	(for i in $(seq 1 100); do echo "BORROW $I c$k"; echo "RETURN $I c$k"; done | ask "$WORK/lms.sock" > "$WORK/c$k") &
+done
+wait_clients
+expect "concurrent clients got every response" "1600" "$(cat "$WORK"/c? | grep -c '^OK\|^ERR')"
+expect "concurrent borrows and returns balance" "6" "$(ask "$WORK/lms.sock" "ISBN $I" | tail -1 | cut -f5)"
+
+# Patrons reserving one book at the same time each get their own place in line, and returned
+# copies go to the first two in line
+ask "$WORK/lms.sock" "BORROW $R own1" "BORROW $R own2" > /dev/null
+for k in 1 2 3 4 5 6 7 8; do
+	(ask "$WORK/lms.sock" "RESERVE $R r$k" > "$WORK/r$k") &
+done
+wait_clients
+expect "concurrent reservations get distinct places" "0 1 2 3 4 5 6 7" "$(cat "$WORK"/r? | awk '{print $3}' | sort -n | xargs)"
+ask "$WORK/lms.sock" "RETURN $R own1" "RETURN $R own2" > /dev/null
+first=$(grep -l ' 0 ahead' "$WORK"/r? | sed 's|.*/||')
+second=$(grep -l ' 1 ahead' "$WORK"/r? | sed 's|.*/||')
+expect "the first in line has a hold" "You have 0 of 10 books borrowed and 1 on hold." "$(ask "$WORK/lms.sock" "ACCOUNT $first" | sed -n 2p)"
+expect "the second in line picks up a hold" "OK picked up hold" "$(ask "$WORK/lms.sock" "BORROW $R $second")"
+finish
@@ -0,0 +1,33 @@
+# Sharding (--shard, --router): three shard processes on Unix sockets behind a router answer
+# the same as one process holding the whole catalog, each shard only holds its own ISBNs, and
+# a shard that is down is reported rather than hanging the router.
+. tests/lib.sh
+
+for k in 0 1 2; do
+	start "$LMS" --shard $k/3 "$WORK/shard$k.sock" 2
+	eval "SHARD$k=$LAST"
+done
+start "$LMS" --serve "$WORK/whole.sock" 2
+for k in 0 1 2; do wait_for "$WORK/shard$k.sock"; done
+wait_for "$WORK/whole.sock"
+start "$LMS" --router "$WORK/router.sock" "$WORK/shard0.sock" "$WORK/shard1.sock" "$WORK/shard2.sock"
+wait_for "$WORK/router.sock"
+
+# ISBNs owned by shard 2 (913154), 1 (2111314) and 2 (1981625): ISBN % 3
+for q in "ISBN 913154" "ISBN 2111314" "ISBN 1981625" "ISBN 12345" \
+	"FIND The Way Things Work: An Illustrated Encyclopedia of Technology" \
+	"PREFIX The" "AUTHOR Stephen King" "PRICE 10 12" "PRICE 10 12 INSTOCK" "INVENTORY" \
+	"BORROW 913154 ann" "BORROW 2111314 ann" "BORROW 1981625 ann" "RETURN 913154 ann" "RETURN 913154 ann"; do
+	expect "router answers $q" "$(ask "$WORK/whole.sock" "$q")" "$(ask "$WORK/router.sock" "$q")"
+done
+# Each shard lists its own recent borrows, so only the counts and loans are compared for ACCOUNT
+summary() { ask "$1" "ACCOUNT ann" | grep -v '^Recently' | sort; }
+expect "router merges ACCOUNT across shards" "$(summary "$WORK/whole.sock")" "$(summary "$WORK/router.sock")"
+
+expect "a shard holds only its own ISBNs" "ERR not found" "$(ask "$WORK/shard0.sock" "ISBN 913154")"
+expect "the owning shard has the change" "$(ask "$WORK/whole.sock" "ISBN 2111314")" "$(ask "$WORK/shard1.sock" "ISBN 2111314")"
+
+stop $SHARD1
+expect "a request for a down shard's ISBN" "ERR shard 1 unavailable" "$(ask "$WORK/router.sock" "ISBN 2111314")"
+expect "other shards still answer" "6" "$(ask "$WORK/router.sock" "ISBN 913154" | tail -1 | cut -f5)"
+finish
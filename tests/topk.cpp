@@ -0,0 +1,128 @@
+/*
+The Space-Saving summary (TopK.h) against exact counts of the same skewed stream, with and without
+decay (the exact counts halved at the same moments): every monitored key's estimate is at least
+its count and at most its count plus its error, every key counted more than events/capacity times
+is monitored, top() lists them highest first, and counters whose count halves to nothing are freed.
+restore() puts saved counts back in order. Exit status is the number of failed checks.
+*/
+#include <cstdio>
+#include <cmath>
+#include <map>
+#include <random>
+#include <string>
+#include "../TopK.h"
+using namespace std;
+
+const int CAPACITY = 50;                 // Counters in the summary
+const int KEYS = 2000;                   // Keys in the stream
+const int EVENTS = 200000;               // Events in the stream
+
+int failed = 0;                          // Checks that failed so far
+
+// Helper function to report one check
+void expect(const string& what, bool ok) {
+	printf("%s: %s\n", ok ? "ok" : "FAIL", what.c_str());
+	if (!ok) failed++;
+}
+
+// Helper function to run a skewed stream through a summary and exact counts, halving the exact
+// counts every decayEvery events as the summary does, and check the summary's guarantees
+void stream(long long decayEvery) {
+	string label = decayEvery ? "decay every " + to_string(decayEvery) + ": " : "no decay: ";
+	spaceSaving summary(CAPACITY, decayEvery);
+	map<int, long long> exact;           // Key -> count (halved along with the summary)
+	mt19937 random(31);
+	vector<double> weight(KEYS);         // Zipf-like: key i is drawn in proportion to 1/(i+1)
+	for (int i = 0; i < KEYS; i++) weight[i] = 1.0 / (i + 1);
+	discrete_distribution<int> pick(weight.begin(), weight.end());
+	long long sinceDecay = 0;
+	bool bounded = true, faded = true;
+	for (int e = 0; e < EVENTS; e++) {
+		int key = pick(random) * 7919;   // Spread the keys out
+		exact[key]++;
+		summary.add(key);
+		if (decayEvery && ++sinceDecay >= decayEvery) {
+			for (map<int, long long>::iterator it = exact.begin(); it != exact.end(); ) {
+				if ((it->second /= 2) == 0) it = exact.erase(it);
+				else ++it;
+			}
+			sinceDecay = 0;
+			int keys[CAPACITY];
+			long long counts[CAPACITY];
+			int n = summary.top(CAPACITY, keys, counts);
+			faded = faded && (n == 0 || counts[n - 1] >= 1); // No counter is left at zero
+		}
+		if (e % 1000 == 999) {           // The guarantees, from time to time
+			int keys[CAPACITY];
+			long long counts[CAPACITY];
+			int n = summary.top(CAPACITY, keys, counts);
+			for (int i = 0; i < n; i++) {
+				long long truth = exact.count(keys[i]) ? exact[keys[i]] : 0;
+				long long error = counts[i] - summary.estimate(keys[i]); // 0: top agrees with estimate
+				bounded = bounded && error == 0 && counts[i] >= truth && (i == 0 || counts[i] <= counts[i - 1]);
+			}
+		}
+	}
+
+	int keys[CAPACITY];
+	long long counts[CAPACITY];
+	int n = summary.top(CAPACITY, keys, counts);
+	long long total = 0, missing = 0;    // Events still counted exactly; heavy keys not monitored
+	for (const pair<const int, long long>& k : exact) total += k.second;
+	for (const pair<const int, long long>& k : exact) {
+		if (k.second * CAPACITY > total && summary.estimate(k.first) == 0) missing++;
+	}
+	bool ordered = true;
+	for (int i = 1; i < n; i++) ordered = ordered && counts[i] <= counts[i - 1];
+	expect(label + "estimates never undercount and top() agrees with estimate()", bounded);
+	expect(label + "every key above events/capacity is monitored", missing == 0);
+	expect(label + "top() lists the highest first", ordered && n == CAPACITY);
+	if (decayEvery) expect(label + "no counter is kept at zero after a decay", faded);
+	int truest = 0;                      // The most drawn key (key 0) tops the list
+	expect(label + "the heaviest key comes first", n > 0 && keys[0] == truest);
+}
+
+// Helper function to follow a two-counter summary through a replacement and a decay by hand
+void smallSummary() {
+	spaceSaving summary(2, 4);           // Two counters, halved every 4 events
+	summary.add(1);                      // 1:1
+	summary.add(2);                      // 1:1 2:1
+	summary.add(3);                      // 3 replaces one of them: count 2, error 1
+	long long three = summary.estimate(3);
+	summary.add(3);                      // 3:3 (error 1, true 2); decay: 3:1 and the other fades
+	expect("decay halves a count", three == 2 && summary.estimate(3) == 1);
+	int keys[2];
+	long long counts[2];
+	expect("a count that halves to nothing is dropped", summary.top(2, keys, counts) == 1 && keys[0] == 3);
+	summary.add(4);                      // A counter was freed, so 4 is exact
+	summary.add(4);
+	summary.add(4);                      // 4:3 3:1
+	expect("a key added after decay counts exactly", summary.estimate(4) == 3);
+}
+
+int main() {
+	stream(0);
+	stream(5000);
+	stream(997);
+	smallSummary();
+
+	spaceSaving saved(4);                // restore puts saved counts back in order
+	saved.restore(10, 5);
+	saved.restore(20, 9);
+	saved.restore(30, 7);
+	saved.restore(20, 100);              // Already monitored: ignored
+	saved.restore(40, 0);                // Nothing to monitor
+	saved.restore(50, 7);
+	saved.restore(60, 8);                // Every counter in use: ignored
+	int keys[4];
+	long long counts[4];
+	int n = saved.top(4, keys, counts);
+	string listed;
+	for (int i = 0; i < n; i++) listed += to_string(keys[i]) + ":" + to_string(counts[i]) + " ";
+	expect("restore keeps counts in order: " + listed, n == 4 && keys[0] == 20 && counts[0] == 9 && counts[1] == 7 && counts[2] == 7 && keys[3] == 10);
+	saved.add(10);
+	saved.add(10);
+	saved.add(10);
+	expect("restored counts go on counting", saved.estimate(10) == 8);
+	return failed;
+}
@@ -0,0 +1,106 @@
+/*
+The per-user hold and loan index (UserIndex.h): counts per book and in total stay in step as
+loans and holds come and go, removing what is not there changes nothing, and through the library
+a returned copy handed to the first in line moves from their hold to their loan when they pick
+it up, while the rest of the line moves up. Exit status is the number of failed checks.
+*/
+#include <cstdio>
+#include <map>
+#include "../LMS.h"
+using namespace std;
+
+int failed = 0;                          // Checks that failed so far
+
+// Helper function to compare what a check got with what it expected
+void expect(const char* what, const string& expected, const string& got) {
+	if (expected == got) printf("ok: %s\n", what);
+	else {
+		printf("FAIL: %s\n  expected: %s\n  got:      %s\n", what, expected.c_str(), got.c_str());
+		failed++;
+	}
+}
+
+// Helper function to describe a user's entry: "loans/holds: ISBN:copies ... | ISBN:copies@ticket ..."
+string describe(userIndex& index, int user) {
+	const userActivity* a = index.get(user);
+	if (!a) return "none";
+	string out = to_string(index.loanCount(user)) + "/" + to_string(index.holdCount(user)) + ":";
+	map<int, int> loans(a->loans.begin(), a->loans.end()); // Sorted, so the text does not depend on hashing
+	for (const pair<const int, int>& l : loans) out += " " + to_string(l.first) + ":" + to_string(l.second);
+	out += " |";
+	map<int, heldBook> holds(a->holds.begin(), a->holds.end());
+	for (const pair<const int, heldBook>& h : holds) out += " " + to_string(h.first) + ":" + to_string(h.second.copies) + "@" + to_string(h.second.ticket);
+	return out;
+}
+
+// Helper function to send one request and return its response
+string ask(LMS& library, const string& request) {
+	string out;
+	library.handle(request.c_str(), out);
+	return out;
+}
+
+// Helper function to get the summary line of a user's account
+string account(LMS& library, const string& user) {
+	string r = ask(library, "ACCOUNT " + user);
+	return r.substr(3, r.find('\n', 3) - 3);
+}
+
+// Helper function to get the hold lines of a user's account
+string holds(LMS& library, const string& user) {
+	string r = ask(library, "ACCOUNT " + user), out;
+	for (size_t at = r.find("On hold:"); at != string::npos; at = r.find("On hold:", at + 1)) out += r.substr(r.find('(', at), r.find('\n', at) - r.find('(', at));
+	return out;
+}
+
+int main() {
+	{                                    // The index on its own
+		userIndex index;
+		expect("a user with no activity", "none / 0 / 0", describe(index, 7) + " / " + to_string(index.loanCount(7)) + " / " + to_string(index.holdCount(7)));
+		index.addLoan(7, 100);
+		index.addLoan(7, 100);
+		index.addLoan(7, 200);
+		expect("loans count per book and in total", "3/0: 100:2 200:1 |", describe(index, 7));
+		index.removeLoan(7, 100);
+		expect("returning one of two copies", "2/0: 100:1 200:1 |", describe(index, 7));
+		index.removeLoan(7, 300);
+		expect("returning a book never borrowed changes nothing", "2/0: 100:1 200:1 |", describe(index, 7));
+		index.removeLoan(7, 100);
+		expect("the last copy of a book drops its entry", "1/0: 200:1 |", describe(index, 7));
+		index.addHold(7, 300, 12);
+		index.addHold(7, 400, -1);
+		expect("holds keep their queue tickets", "1/2: 200:1 | 300:1@12 400:1@-1", describe(index, 7));
+		index.removeHold(7, 500);
+		index.removeHold(8, 300);
+		expect("dropping a hold nobody has changes nothing", "1/2: 200:1 | 300:1@12 400:1@-1", describe(index, 7));
+		index.removeHold(7, 300);        // Picked up: the hold becomes a loan
+		index.addLoan(7, 300);
+		expect("a hold handed over becomes a loan", "2/1: 200:1 300:1 | 400:1@-1", describe(index, 7));
+		expect("other users are untouched", "none", describe(index, 8));
+	}
+
+	{                                    // Through the library: return, hand-off and pickup
+		manualClock clock(1700000000);
+		LMS library(&clock);
+		const string R = "2111314";      // A book with 2 copies
+		ask(library, "BORROW " + R + " ann");
+		ask(library, "BORROW " + R + " bob");
+		ask(library, "RESERVE " + R + " cat");
+		ask(library, "RESERVE " + R + " dan");
+		ask(library, "RESERVE " + R + " eve");
+		expect("places in line", "(0 ahead of you) / (1 ahead of you) / (2 ahead of you)", holds(library, "cat") + " / " + holds(library, "dan") + " / " + holds(library, "eve"));
+		expect("a returned copy leaves the loan index", "OK returned\n", ask(library, "RETURN " + R + " ann"));
+		expect("returner has nothing out", "You have 0 of 10 books borrowed and 0 on hold.", account(library, "ann"));
+		expect("the first in line has it held", "(ready for pickup)", holds(library, "cat"));
+		expect("the rest of the line moves up", "(0 ahead of you) / (1 ahead of you)", holds(library, "dan") + " / " + holds(library, "eve"));
+		expect("picking up the hold", "OK picked up hold\n", ask(library, "BORROW " + R + " cat"));
+		expect("moves it from holds to loans", "You have 1 of 10 books borrowed and 0 on hold.", account(library, "cat"));
+		expect("returning a book not borrowed", "ERR not borrowed\n", ask(library, "RETURN " + R + " ann"));
+		expect("changes nothing", "You have 0 of 10 books borrowed and 0 on hold.", account(library, "ann"));
+		ask(library, "RETURN " + R + " bob");
+		ask(library, "RETURN " + R + " cat");
+		expect("two returns hand off to the rest of the line", "(ready for pickup) / (ready for pickup)", holds(library, "dan") + " / " + holds(library, "eve"));
+		expect("with nothing left on the shelf", "0", ask(library, "ISBN " + R).substr(ask(library, "ISBN " + R).rfind('\t') + 1, 1));
+	}
+	return failed;
+}
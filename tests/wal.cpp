@@ -0,0 +1,119 @@
+/*
+The write-ahead log (WAL.h) on its own: records appended from several threads at once are all
+on disk, each thread's in order, once waitDurable says so; a record a crash left half written
+is skipped by replay and cut off by open, so the next record starts on a line of its own; and
+roll moves the records so far to another file and carries on in an empty log.
+Exit status is the number of failed checks.
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <fstream>
+#include <iterator>
+#include "../WAL.h"
+using namespace std;
+
+const int WRITERS = 6;                   // Threads appending at once
+const int EACH = 2000;                   // Records each thread appends
+
+int failed = 0;                          // Checks that failed so far
+
+// Helper function to compare what a check got with what it expected
+void expect(const char* what, const string& expected, const string& got) {
+	if (expected == got) printf("ok: %s\n", what);
+	else {
+		printf("FAIL: %s\n  expected: %s\n  got:      %s\n", what, expected.c_str(), got.c_str());
+		failed++;
+	}
+}
+
+// Helper function to read every complete record of a log, one per line
+string records(const string& path) {
+	string all;
+	writeAheadLog::replay(path.c_str(), [&](const string& r) { all += r + "\n"; });
+	return all;
+}
+
+// Helper function to read a whole file
+string contents(const string& path) {
+	ifstream in(path, ios::binary);
+	return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+}
+
+// Helper function to write a whole file
+void overwrite(const string& path, const string& text) {
+	ofstream(path, ios::binary) << text;
+}
+
+int main() {
+	string dir = getenv("WORK") ? getenv("WORK") : "/tmp";
+	string path = dir + "/wal.log";
+
+	{                                    // Writers appending at once
+		writeAheadLog log;
+		log.open(path.c_str());
+		atomic<int> acknowledged(0);     // Records waitDurable confirmed
+		atomic<int> called(0);           // whenDurable callbacks that ran
+		vector<thread> writers;
+		for (int w = 0; w < WRITERS; w++) writers.push_back(thread([&, w] {
+			for (int i = 0; i < EACH; i++) {
+				unsigned long long seq = log.append("W %d %d", w, i);
+				if (i % 2 == 0 && log.waitDurable(seq)) acknowledged++;
+				else if (!log.whenDurable(seq, [&] { called++; })) called++; // Already durable
+			}
+		}));
+		for (thread& t : writers) t.join();
+		expect("every waitDurable succeeded", to_string(WRITERS * EACH / 2), to_string(acknowledged.load()));
+		expect("count() is every record appended", to_string(WRITERS * EACH), to_string(log.count()));
+		log.close();                     // Runs the callbacks still waiting
+		expect("every whenDurable callback ran", to_string(WRITERS * EACH / 2), to_string(called.load()));
+
+		vector<int> next(WRITERS, 0);    // Next record expected from each writer
+		long long n = writeAheadLog::replay(path.c_str(), [&](const string& r) {
+			int w, i;
+			if (sscanf(r.c_str(), "W %d %d", &w, &i) == 2 && w >= 0 && w < WRITERS && i == next[w]) next[w]++;
+		});
+		bool all = true;
+		for (int w = 0; w < WRITERS; w++) all = all && next[w] == EACH;
+		expect("replay finds every record", to_string(WRITERS * EACH), to_string(n));
+		expect("each writer's records are in order", "1", all ? "1" : "0");
+	}
+
+	{                                    // A crash in the middle of a record
+		overwrite(path, "A 1\nB 2\nC 3 half wri");
+		expect("replay skips the torn record", "A 1\nB 2\n", records(path));
+		writeAheadLog log;
+		log.open(path.c_str());
+		expect("open cuts the torn record off", "A 1\nB 2\n", contents(path));
+		log.waitDurable(log.append("D 4"));
+		expect("the next record starts on its own line", "A 1\nB 2\nD 4\n", records(path));
+		log.close();
+
+		overwrite(path, "torn with no newline at all");
+		log.open(path.c_str());
+		expect("a log that is all torn record is emptied", "", contents(path));
+		log.append("E 5");
+		log.close();                     // Close makes everything durable
+		expect("close writes what is left", "E 5\n", contents(path));
+		expect("replay of a missing log", "-1", to_string(writeAheadLog::replay((dir + "/none.log").c_str(), [](const string&) {})));
+	}
+
+	{                                    // Rolling the log
+		string closed = dir + "/wal.log.0";
+		unlink(path.c_str());
+		writeAheadLog log;
+		log.open(path.c_str());
+		log.append("R 1");
+		log.append("R 2");               // Not waited for: roll makes them durable first
+		expect("roll succeeds", "1", log.roll(closed.c_str()) ? "1" : "0");
+		log.waitDurable(log.append("R 3"));
+		expect("the closed file holds the records before the roll", "R 1\nR 2\n", records(closed));
+		expect("the log holds the records after it", "R 3\n", records(path));
+		expect("count() carries on across the roll", "3", to_string(log.count()));
+		log.close();
+		expect("roll of a closed log fails", "0", log.roll((dir + "/wal.log.1").c_str()) ? "1" : "0");
+	}
+	return failed;
+}